@@ -0,0 +1,304 @@
+#include "DetectionEvaluation.h"
+#include <cfloat>
+#include <map>
+#include <set>
+
+float
+intersectionOverUnion(const BoundingBox& a, const BoundingBox& b)
+{
+	float iw = min(a.x + a.width, b.x + b.width) - max(a.x, b.x);
+	float ih = min(a.y + a.height, b.y + b.height) - max(a.y, b.y);
+	if(iw <= 0 || ih <= 0) return 0;
+
+	float inter = iw * ih;
+	return inter / (a.area() + b.area() - inter);
+}
+
+// ============================================================================
+// BoxAnnotations
+// ============================================================================
+
+BoxAnnotations::BoxAnnotations(const char* filename)
+{
+	load(filename);
+}
+
+void
+BoxAnnotations::load(const char* filename)
+{
+	std::ifstream f(filename);
+	if(!f.is_open()) {
+		throw CError("Could not open file %s for reading", filename);
+	}
+
+	int nItems;
+	f >> nItems;
+	if(f.fail() || nItems < 0) throw CError("Invalid annotations file %s", filename);
+
+	_filenames.resize(nItems);
+	_boxes.resize(nItems);
+
+	std::set<std::string> seen;
+	for(int i = 0; i < nItems; i++) {
+		int nBoxes;
+		f >> _filenames[i] >> nBoxes;
+		if(f.fail() || nBoxes < 0) throw CError("Invalid annotations file %s", filename);
+		if(!seen.insert(_filenames[i]).second) {
+			throw CError("Image %s is listed twice in annotations file %s", _filenames[i].c_str(), filename);
+		}
+
+		_boxes[i].resize(nBoxes);
+		for(int b = 0; b < nBoxes; b++) {
+			BoundingBox& box = _boxes[i][b];
+			f >> box.x >> box.y >> box.width >> box.height;
+		}
+		if(f.fail()) throw CError("Invalid annotations file %s", filename);
+	}
+}
+
+void
+BoxAnnotations::save(const char* filename) const
+{
+	std::ofstream f(filename);
+	if(!f.is_open()) {
+		throw CError("Could not open file %s for writing", filename);
+	}
+
+	f << _filenames.size() << "\n";
+	for(int i = 0; i < _filenames.size(); i++) {
+		f << _filenames[i] << " " << _boxes[i].size();
+		for(int b = 0; b < _boxes[i].size(); b++) {
+			const BoundingBox& box = _boxes[i][b];
+			f << " " << box.x << " " << box.y << " " << box.width << " " << box.height;
+		}
+		f << "\n";
+	}
+}
+
+int
+BoxAnnotations::getBoxesCount() const
+{
+	int count = 0;
+	for(int i = 0; i < _boxes.size(); i++) {
+		count += _boxes[i].size();
+	}
+	return count;
+}
+
+// ============================================================================
+// Detection lists
+// ============================================================================
+
+std::vector<Detection>
+loadDetections(const char* filename)
+{
+	std::ifstream f(filename);
+	if(!f.is_open()) {
+		throw CError("Could not open file %s for reading", filename);
+	}
+
+	int nItems;
+	f >> nItems;
+	if(f.fail() || nItems < 0) throw CError("Invalid detections file %s", filename);
+
+	std::vector<Detection> detections(nItems);
+	for(int i = 0; i < nItems; i++) {
+		Detection& d = detections[i];
+		f >> d.filename >> d.score >> d.box.x >> d.box.y >> d.box.width >> d.box.height;
+	}
+	if(f.fail()) throw CError("Invalid detections file %s", filename);
+
+	return detections;
+}
+
+void
+saveDetections(const char* filename, const std::vector<Detection>& detections)
+{
+	std::ofstream f(filename);
+	if(!f.is_open()) {
+		throw CError("Could not open file %s for writing", filename);
+	}
+
+	f << detections.size() << "\n";
+	for(int i = 0; i < detections.size(); i++) {
+		const Detection& d = detections[i];
+		f << d.filename << " " << d.score << " "
+		  << d.box.x << " " << d.box.y << " " << d.box.width << " " << d.box.height << "\n";
+	}
+}
+
+// ============================================================================
+// Matching
+// ============================================================================
+
+static const int gridMaxCellsPerSide = 64;
+
+// Uniform grid over the ground truth boxes of one image. Each box is stored
+// in every cell it overlaps, so only boxes sharing a cell with a query box
+// can overlap it. Cells are about as large as the average box.
+class BoxGrid
+{
+private:
+	float _x0, _y0, _cellW, _cellH;
+	int _nx, _ny;
+	std::vector<std::vector<int> > _cells;
+	std::vector<int> _lastQuery; // Avoids reporting a box once per shared cell
+	int _query;
+
+	void cellRange(const BoundingBox& box, int& cx0, int& cy0, int& cx1, int& cy1) const
+	{
+		cx0 = std::max(0, std::min(_nx - 1, int(floor((box.x - _x0) / _cellW))));
+		cy0 = std::max(0, std::min(_ny - 1, int(floor((box.y - _y0) / _cellH))));
+		cx1 = std::max(0, std::min(_nx - 1, int(floor((box.x + box.width - _x0) / _cellW))));
+		cy1 = std::max(0, std::min(_ny - 1, int(floor((box.y + box.height - _y0) / _cellH))));
+	}
+
+public:
+	BoxGrid(const std::vector<BoundingBox>& boxes):
+	_x0(0), _y0(0), _cellW(1), _cellH(1), _nx(1), _ny(1), _query(0)
+	{
+		_lastQuery.assign(boxes.size(), -1);
+		if(boxes.empty()) return;
+
+		float x1 = -FLT_MAX, y1 = -FLT_MAX, meanW = 0, meanH = 0;
+		_x0 = _y0 = FLT_MAX;
+		for(int i = 0; i < boxes.size(); i++) {
+			_x0 = min(_x0, boxes[i].x);
+			_y0 = min(_y0, boxes[i].y);
+			x1 = max(x1, boxes[i].x + boxes[i].width);
+			y1 = max(y1, boxes[i].y + boxes[i].height);
+			meanW += boxes[i].width / boxes.size();
+			meanH += boxes[i].height / boxes.size();
+		}
+
+		_nx = std::max(1, std::min(gridMaxCellsPerSide, int(ceil((x1 - _x0) / std::max(meanW, 1.0f)))));
+		_ny = std::max(1, std::min(gridMaxCellsPerSide, int(ceil((y1 - _y0) / std::max(meanH, 1.0f)))));
+		_cellW = std::max((x1 - _x0) / _nx, 1e-6f);
+		_cellH = std::max((y1 - _y0) / _ny, 1e-6f);
+
+		_cells.resize(_nx * _ny);
+		for(int i = 0; i < boxes.size(); i++) {
+			int cx0, cy0, cx1, cy1;
+			cellRange(boxes[i], cx0, cy0, cx1, cy1);
+			for(int cy = cy0; cy <= cy1; cy++) {
+				for(int cx = cx0; cx <= cx1; cx++) {
+					_cells[cy * _nx + cx].push_back(i);
+				}
+			}
+		}
+	}
+
+	// Returns in ids every box that might overlap box, each one once
+	void candidates(const BoundingBox& box, std::vector<int>& ids)
+	{
+		ids.resize(0);
+		if(_cells.empty()) return;
+
+		_query++;
+		int cx0, cy0, cx1, cy1;
+		cellRange(box, cx0, cy0, cx1, cy1);
+		for(int cy = cy0; cy <= cy1; cy++) {
+			for(int cx = cx0; cx <= cx1; cx++) {
+				const std::vector<int>& cell = _cells[cy * _nx + cx];
+				for(int k = 0; k < cell.size(); k++) {
+					if(_lastQuery[cell[k]] == _query) continue;
+					_lastQuery[cell[k]] = _query;
+					ids.push_back(cell[k]);
+				}
+			}
+		}
+	}
+};
+
+std::vector<char>
+matchDetections(const BoxAnnotations& gt, const std::vector<Detection>& detections, float iouThreshold)
+{
+	int nImages = gt.getSize();
+	std::map<std::string, int> imageIndex;
+	for(int i = 0; i < nImages; i++) {
+		imageIndex[gt.getFilename(i)] = i;
+	}
+
+	// Group detections per image, the last group holds detections in
+	// images without annotations
+	std::vector<std::vector<int> > perImage(nImages + 1);
+	for(int d = 0; d < detections.size(); d++) {
+		std::map<std::string, int>::const_iterator it = imageIndex.find(detections[d].filename);
+		perImage[it == imageIndex.end() ? nImages : it->second].push_back(d);
+	}
+
+	std::vector<char> isTruePos(detections.size(), 0);
+
+	ParallelFor(0, nImages, [&](int iBegin, int iEnd) {
+		std::vector<int> ids;
+		for(int i = iBegin; i < iEnd; i++) {
+			const std::vector<BoundingBox>& boxes = gt.getBoxes(i);
+			std::vector<int>& dets = perImage[i];
+			if(boxes.empty() || dets.empty()) continue;
+
+			std::stable_sort(dets.begin(), dets.end(), [&detections](int a, int b) {
+				return detections[a].score > detections[b].score;
+			});
+
+			BoxGrid grid(boxes);
+			std::vector<char> matched(boxes.size(), 0);
+			for(int k = 0; k < dets.size(); k++) {
+				const BoundingBox& box = detections[dets[k]].box;
+
+				float bestIoU = 0;
+				int best = -1;
+				grid.candidates(box, ids);
+				for(int c = 0; c < ids.size(); c++) {
+					float iou = intersectionOverUnion(box, boxes[ids[c]]);
+					if(iou > bestIoU) {
+						bestIoU = iou;
+						best = ids[c];
+					}
+				}
+
+				if(best >= 0 && bestIoU >= iouThreshold && !matched[best]) {
+					matched[best] = 1;
+					isTruePos[dets[k]] = 1;
+				}
+			}
+		}
+	});
+
+	return isTruePos;
+}
+
+PrecisionRecall
+evaluateDetections(const BoxAnnotations& gt, const std::vector<Detection>& detections, float iouThreshold)
+{
+	std::vector<char> isTruePos = matchDetections(gt, detections, iouThreshold);
+	int nMatched = std::count(isTruePos.begin(), isTruePos.end(), 1);
+
+	// One bin per distinct score, plus a final one where every detection is
+	// accepted and the boxes that were never found are the false negatives
+	std::vector<int> order(detections.size());
+	for(int d = 0; d < order.size(); d++) order[d] = d;
+	std::sort(order.begin(), order.end(), [&detections](int a, int b) {
+		return detections[a].score > detections[b].score;
+	});
+
+	std::vector<PrecisionRecallBin> bins;
+	for(int k = 0; k < order.size(); k++) {
+		const Detection& d = detections[order[k]];
+		if(bins.empty() || bins.back().score != d.score) {
+			PrecisionRecallBin bin;
+			bin.score = d.score;
+			bin.positives = bin.negatives = bin.unlabeled = 0;
+			bins.push_back(bin);
+		}
+		if(isTruePos[order[k]]) bins.back().positives++;
+		else bins.back().negatives++;
+	}
+
+	PrecisionRecallBin missed;
+	missed.score = -FLT_MAX;
+	missed.positives = gt.getBoxesCount() - nMatched;
+	missed.negatives = missed.unlabeled = 0;
+	bins.push_back(missed);
+
+	return PrecisionRecall(bins);
+}
@@ -0,0 +1,72 @@
+#ifndef DETECTIONEVALUATION_H
+#define DETECTIONEVALUATION_H
+
+#include "Common.h"
+#include "PrecisionRecall.h"
+
+// Axis aligned box in pixel coordinates, (x, y) is the top left corner
+struct BoundingBox
+{
+	float x, y, width, height;
+
+	BoundingBox(): x(0), y(0), width(0), height(0) {}
+	BoundingBox(float x_, float y_, float w_, float h_): x(x_), y(y_), width(w_), height(h_) {}
+
+	float area() const { return width * height; }
+};
+
+// Area of the intersection of a and b divided by the area of their union
+float intersectionOverUnion(const BoundingBox& a, const BoundingBox& b);
+
+// A scored box found by a detector in one image
+struct Detection
+{
+	std::string filename;
+	float score;
+	BoundingBox box;
+};
+
+// Ground truth bounding boxes for a set of images. The file format follows
+// ImageDatabase: the number of images, then one line per image with the
+// filename, the number of boxes and x y width height for every box. Each
+// image may be listed only once.
+class BoxAnnotations
+{
+private:
+	std::vector<std::string> _filenames;
+	std::vector<std::vector<BoundingBox> > _boxes;
+
+public:
+	BoxAnnotations() {}
+	BoxAnnotations(const char* filename);
+
+	void load(const char* filename);
+	void save(const char* filename) const;
+
+	// Accessors
+	int getSize() const { return _filenames.size(); }
+	const std::string& getFilename(int idx) const { return _filenames[idx]; }
+	const std::vector<BoundingBox>& getBoxes(int idx) const { return _boxes[idx]; }
+	int getBoxesCount() const;
+};
+
+// Detection lists are stored as the number of detections followed by one
+// line per detection with filename, score and x y width height.
+std::vector<Detection> loadDetections(const char* filename);
+void saveDetections(const char* filename, const std::vector<Detection>& detections);
+
+// PASCAL VOC style matching. Within each image, detections are visited by
+// decreasing score and each one is matched to the ground truth box it overlaps
+// most. It is a true positive if that overlap is at least iouThreshold and the
+// box was not matched before, otherwise a false positive, as are detections in
+// images without annotations. Returns 1 for the true positives, 0 otherwise.
+std::vector<char> matchDetections(const BoxAnnotations& gt, const std::vector<Detection>& detections,
+                                  float iouThreshold = 0.5f);
+
+// PASCAL VOC style evaluation of the matches above. Boxes that are never
+// matched count as missed positives. The returned curve ranks all detections by
+// score, its last point (threshold -FLT_MAX) accepts every detection.
+PrecisionRecall evaluateDetections(const BoxAnnotations& gt, const std::vector<Detection>& detections,
+                                   float iouThreshold = 0.5f);
+
+#endif // DETECTIONEVALUATION_H
@@ -5,12 +5,15 @@ FeatureExtractor::operator()(const ImageDatabase& db, FeatureSet& featureSet) co
 {
 	int n = db.getSize();
 
-	featureSet.resize(n);
+	// Each feature is moved into the set, which involves no reference
+	// counting
+	featureSet.clear();
+	featureSet.reserve(n);
 	for(int i = 0; i < n; i++) {
 		CByteImage img;
 		ReadFile(img, db.getFilename(i).c_str());
 
-		featureSet[i] = (*this)(img);
+		featureSet.emplace_back((*this)(img));
 	}
 }
 
@@ -18,21 +21,10 @@ CByteImage
 FeatureExtractor::render(const Feature& f, bool normalizeFeat) const
 {
 	if(normalizeFeat) {
-		CShape shape = f.Shape();
-		Feature fAux(shape);
-
 		float fMin, fMax;
 		f.getRangeOfValues(fMin, fMax);
 
-		for(int y = 0; y < shape.height; y++) {
-			float* fIt = (float*) f.PixelAddress(0,y,0);
-			float* fAuxIt = (float*) fAux.PixelAddress(0,y,0);
-
-			for(int x = 0; x < shape.width * shape.nBands; x++, fAuxIt++, fIt++) {
-				*fAuxIt = (*fIt) / fMax;
-			}
-		}
-
+		Feature fAux = f / fMax;
 		return this->render(fAux);
 	} else {
 		return this->render(f);
@@ -54,6 +46,14 @@ FeatureExtractorNew(const char* featureType)
 	}
 }
 
+Feature
+packedFeature(CShape shape)
+{
+	Feature feat;
+	feat.ReAllocate(shape, (float*) NULL, true, shape.width);
+	return feat;
+}
+
 // ============================================================================
 // TinyImage
 // ============================================================================
@@ -66,7 +66,7 @@ _targetW(targetWidth), _targetH(targetHeight)
 Feature 
 TinyImageFeatureExtractor::operator()(const CByteImage& img_) const
 {
-	CFloatImage tinyImg(_targetW, _targetH, 3);
+	Feature tinyImg = packedFeature(CShape(_targetW, _targetH, 1));
 	/******** BEGIN TODO ********/
 	// Compute tiny image feature, output should be _targetW by _targetH a grayscale image
 	// Steps are:
@@ -77,14 +77,12 @@ TinyImageFeatureExtractor::operator()(const CByteImage& img_) const
 	// convertRGB2GrayImage, TypeConvert, WarpGlobal
 
 	//printf("TODO: Feature.cpp:80\n"); exit(EXIT_FAILURE);
-	int width = img_.Shape().width;
-	int height = img_.Shape().height;
-	CFloatImage tempImg(width, height, 3);
-	CFloatImage temp2Img(width, height, 3);
-	TypeConvert(img_, tempImg);
-	convertRGB2GrayImage(tempImg, temp2Img);
-	CTransform3x3 trans= CTransform3x3::Scale(_targetW/((float) width), _targetH/((float) height));
-	WarpGlobal(temp2Img, tinyImg, trans.Inverse(), EWarpInterpolationMode::eWarpInterpLinear);
+	// Both steps are linear, so shrink first (area averaging keeps large
+	// downscales from aliasing and converts to float on the fly) and only
+	// convert the few remaining pixels to gray
+	CFloatImage tinyRGB(_targetW, _targetH, img_.Shape().nBands);
+	Resize(img_, tinyRGB, eResizeBox);
+	convertRGB2GrayImage(tinyRGB, tinyImg);
 	/******** END TODO ********/
 
 	return tinyImg;
@@ -206,7 +204,7 @@ HOGFeatureExtractor::operator()(const CByteImage& img_) const
 	//Third channel unused, first channel is mag, 2nd is orientation
 	CFloatImage vals=CFloatImage(img_.Shape().width, img_.Shape().height, 2);
 	//Output feature image, one channel for each bin
-	Feature out= CFloatImage((int)ceil(img_.Shape().width/(float)_cellSize), (int)ceil(img_.Shape().height/(float)_cellSize), _nAngularBins);
+	Feature out= packedFeature(CShape((int)ceil(img_.Shape().width/(float)_cellSize), (int)ceil(img_.Shape().height/(float)_cellSize), _nAngularBins));
 	float bandWidth = _unsignedGradients ? 180/(float)_nAngularBins : 360/ (float)_nAngularBins;
 	float ultimatemagnitude=-1, ultimateangle=-1;
 	vals.ClearPixels();
@@ -34,6 +34,11 @@ public:
 // calls in implementation of this function.
 FeatureExtractor* FeatureExtractorNew(const char* featureType);
 
+// Allocates a feature whose rows are tightly packed whatever the ImageLib
+// row alignment is, so that its values are one contiguous array. The SVM
+// hands such features to libsvm as they are, without copying them.
+Feature packedFeature(CShape shape);
+
 // Tiny Image feature. Converts image to grayscale and downscales it. Used
 // mostly as a baseline feature.
 class TinyImageFeatureExtractor : public FeatureExtractor
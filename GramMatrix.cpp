@@ -0,0 +1,253 @@
+#include "GramMatrix.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// The products are summed in float. Only the tiles of the lower triangle
+// are computed, and each value K(i, j), j <= i, is then copied to K(j, i)
+// (see GramMatrix::GramMatrix), which is what makes the matrix exactly
+// symmetric. The multiply is compiled for AVX2 as well (with GCC on x86-64
+// Linux), picked at load time.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define GRAM_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#define GRAM_INLINE inline __attribute__((always_inline))
+#else
+#define GRAM_TARGET_CLONES
+#define GRAM_INLINE inline
+#endif
+
+// The vectors are packed in panels of panelWidth vectors, value k of the
+// vectors next to each other, and the matrix is computed in tiles of
+// tileSize x tileSize, blockDepth values of the vectors at a time (one
+// block of a panel is 16 KB, for the L1 cache)
+static const int panelWidth = 16;
+static const int tileSize = 64;
+static const int blockDepth = 256;
+
+// ParallelFor on at most nThreads threads of the pool (0 = all of them)
+template <class F>
+static void
+parallelLoop(int begin, int end, int nThreads, F fn)
+{
+	int grain = 1;
+	if(nThreads > 0) {
+		nThreads = std::min(nThreads, ParallelNumThreads());
+		grain = (end - begin + nThreads - 1) / nThreads;
+	}
+	ParallelFor(begin, end, fn, grain);
+}
+
+// Tile pair number t of the lower triangle, t = I (I + 1) / 2 + J, J <= I
+static void
+tilePair(int t, int& I, int& J)
+{
+	I = (int) ((sqrt(8.0 * t + 1) - 1) / 2);
+	while(I * (I + 1) / 2 > t) I--;
+	while((I + 1) * (I + 2) / 2 <= t) I++;
+	J = t - I * (I + 1) / 2;
+}
+
+// acc[r][c] += sum over k < depth of a[k * panelWidth + r] * b[k * panelWidth + c],
+// r < 4 (the loops over c vectorize, the sums stay in registers)
+GRAM_INLINE void
+multiplyPanels(const float* a, const float* b, int depth, float acc[4][panelWidth])
+{
+	float acc0[panelWidth], acc1[panelWidth], acc2[panelWidth], acc3[panelWidth];
+	for(int c = 0; c < panelWidth; c++) {
+		acc0[c] = acc[0][c];
+		acc1[c] = acc[1][c];
+		acc2[c] = acc[2][c];
+		acc3[c] = acc[3][c];
+	}
+	for(int k = 0; k < depth; k++, a += panelWidth, b += panelWidth) {
+		float a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+		for(int c = 0; c < panelWidth; c++) {
+			acc0[c] += a0 * b[c];
+			acc1[c] += a1 * b[c];
+			acc2[c] += a2 * b[c];
+			acc3[c] += a3 * b[c];
+		}
+	}
+	for(int c = 0; c < panelWidth; c++) {
+		acc[0][c] = acc0[c];
+		acc[1][c] = acc1[c];
+		acc[2][c] = acc2[c];
+		acc[3][c] = acc3[c];
+	}
+}
+
+// Dot products of the vectors [i0, i1) with the vectors [j0, j1), into
+// gram[i * rowStride + j + 1]
+GRAM_TARGET_CLONES
+static void
+multiplyTile(const float* packed, int dim, int i0, int i1, int j0, int j1, float* gram, size_t rowStride)
+{
+	for(int k0 = 0; k0 < dim; k0 += blockDepth) {
+		int depth = std::min(blockDepth, dim - k0);
+		for(int j = j0; j < j1; j += panelWidth) {
+			const float* b = packed + ((size_t) (j / panelWidth) * dim + k0) * panelWidth;
+			int nCols = std::min(panelWidth, j1 - j);
+			for(int i = i0; i < i1; i += 4) {
+				const float* a = packed + ((size_t) (i / panelWidth) * dim + k0) * panelWidth + i % panelWidth;
+				int nRows = std::min(4, i1 - i);
+				float acc[4][panelWidth];
+				for(int r = 0; r < 4; r++) {
+					for(int c = 0; c < panelWidth; c++) {
+						acc[r][c] = (k0 > 0 && r < nRows && c < nCols) ? gram[(i + r) * rowStride + j + c + 1] : 0;
+					}
+				}
+				multiplyPanels(a, b, depth, acc);
+				for(int r = 0; r < nRows; r++) {
+					for(int c = 0; c < nCols; c++) {
+						gram[(i + r) * rowStride + j + c + 1] = acc[r][c];
+					}
+				}
+			}
+		}
+	}
+}
+
+GramMatrix::GramMatrix(const FeatureSet& fset, int kernelType, double gamma, int nThreads, const char* fileName):
+_size(fset.size()),
+_rowStride(0),
+_values(NULL),
+_bytes(0),
+_mapped(false)
+{
+	if(kernelType != LINEAR && kernelType != RBF) throw CError("Gram matrix of unsupported kernel type %d", kernelType);
+	if(_size == 0) throw CError("Gram matrix of an empty feature set");
+
+	CShape shape = fset[0].Shape();
+	int dim = shape.width * shape.height * shape.nBands;
+	for(int i = 0; i < _size; i++) {
+		CShape fShape = fset[i].Shape();
+		if(fShape.width * fShape.height * fShape.nBands != dim) throw CError("Feature vectors have different sizes!");
+	}
+
+	// Packed vectors, padded with zero vectors to whole tiles
+	int nTiles = (_size + tileSize - 1) / tileSize;
+	std::vector<float> packed((size_t) nTiles * tileSize * dim);
+	parallelLoop(0, (_size + panelWidth - 1) / panelWidth, nThreads, [&](int begin, int end) {
+		for(int p = begin; p < end; p++) {
+			for(int j = p * panelWidth; j < std::min(_size, (p + 1) * panelWidth); j++) {
+				float* dst = &packed[(size_t) p * dim * panelWidth + j % panelWidth];
+				for(int y = 0; y < shape.height; y++) {
+					const float* src = (const float*) fset[j].PixelAddress(0, y, 0);
+					for(int x = 0; x < shape.width * shape.nBands; x++, dst += panelWidth) {
+						*dst = src[x];
+					}
+				}
+			}
+		}
+	});
+
+	allocate(fileName);
+
+	// Lower triangle of tiles
+	int nPairs = nTiles * (nTiles + 1) / 2;
+	parallelLoop(0, nPairs, nThreads, [&](int begin, int end) {
+		for(int t = begin; t < end; t++) {
+			int I, J;
+			tilePair(t, I, J);
+			multiplyTile(&packed[0], dim, I * tileSize, std::min(_size, (I + 1) * tileSize),
+			             J * tileSize, std::min(_size, (J + 1) * tileSize), _values, _rowStride);
+		}
+	});
+
+	// Kernel values, copied to the upper triangle
+	std::vector<float> norms;
+	if(kernelType == RBF) {
+		norms.resize(_size);
+		for(int i = 0; i < _size; i++) norms[i] = (*this)(i, i);
+	}
+	parallelLoop(0, nPairs, nThreads, [&](int begin, int end) {
+		for(int t = begin; t < end; t++) {
+			int I, J;
+			tilePair(t, I, J);
+			for(int i = I * tileSize; i < std::min(_size, (I + 1) * tileSize); i++) {
+				int jEnd = (I == J) ? i + 1 : std::min(_size, (J + 1) * tileSize);
+				for(int j = J * tileSize; j < jEnd; j++) {
+					float value = _values[i * _rowStride + j + 1];
+					if(kernelType == RBF) {
+						// |x_i - x_j|^2 = |x_i|^2 + |x_j|^2 - 2 x_i . x_j
+						double distance = std::max(0.0, (double) norms[i] + norms[j] - 2.0 * value);
+						value = exp(-gamma * distance);
+					}
+					_values[i * _rowStride + j + 1] = value;
+					_values[j * _rowStride + i + 1] = value;
+				}
+			}
+		}
+	});
+
+	_rows.resize(_size);
+	for(int i = 0; i < _size; i++) {
+		_values[i * _rowStride] = i + 1;
+		_rows[i].index = SVM_DENSE_INDEX;
+		_rows[i].dim = _size + 1;
+		_rows[i].values = _values + i * _rowStride;
+	}
+}
+
+GramMatrix::~GramMatrix()
+{
+	if(!_mapped) {
+		free(_values);
+	} else {
+#if defined(_WIN32) || defined(_WIN64)
+		UnmapViewOfFile(_values);
+#else
+		munmap(_values, _bytes);
+#endif
+	}
+}
+
+void
+GramMatrix::allocate(const char* fileName)
+{
+	_rowStride = (_size + 1 + 15) & ~(size_t) 15; // Rows start on cache lines
+	_bytes = (size_t) _size * _rowStride * sizeof(float);
+	int megabytes = (int) ((_bytes + 1048575) >> 20);
+
+	if(fileName == NULL) {
+		_values = (float*) malloc(_bytes);
+		if(_values == NULL) throw CError("Not enough memory for the Gram matrix (%d MB), store it in a file", megabytes);
+		return;
+	}
+
+	// The file is deleted once the matrix is unmapped
+#if defined(_WIN32) || defined(_WIN64)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+	                          FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if(file == INVALID_HANDLE_VALUE) throw CError("Could not create file %s", fileName);
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD) ((unsigned long long) _bytes >> 32),
+	                                    (DWORD) _bytes, NULL);
+	CloseHandle(file);
+	if(mapping == NULL) throw CError("Could not allocate file %s of %d MB", fileName, megabytes);
+	_values = (float*) MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, _bytes);
+	CloseHandle(mapping);
+	if(_values == NULL) throw CError("Could not map file %s into memory", fileName);
+#else
+	int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(fd < 0) throw CError("Could not create file %s", fileName);
+	unlink(fileName);
+#ifdef __linux__
+	// Reserve the disk space now rather than fail on a write later
+	bool allocated = (posix_fallocate(fd, 0, _bytes) == 0);
+#else
+	bool allocated = (ftruncate(fd, _bytes) == 0);
+#endif
+	void* map = allocated ? mmap(NULL, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if(!allocated) throw CError("Could not allocate file %s of %d MB", fileName, megabytes);
+	if(map == MAP_FAILED) throw CError("Could not map file %s into memory", fileName);
+	_values = (float*) map;
+#endif
+	_mapped = true;
+}
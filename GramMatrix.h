@@ -0,0 +1,48 @@
+#ifndef GRAM_MATRIX_H
+#define GRAM_MATRIX_H
+
+#include "Common.h"
+#include "Feature.h"
+
+// Kernel (Gram) matrix of a set of feature vectors, K(i, j) = x_i . x_j
+// for the LINEAR kernel and exp(-gamma |x_i - x_j|^2) for RBF, computed
+// all at once with a cache blocked matrix multiply on the ImageLib thread
+// pool. Its rows are libsvm precomputed kernel rows (dense nodes, see
+// svm.h), for training a PRECOMPUTED kernel SVM without any kernel
+// evaluations inside the solver.
+//
+// The values are floats, n * (n + 1) of them for n vectors: 1 GB for
+// 16k vectors, 10 GB for 50k. They are kept in memory, or in a file that
+// is mapped into memory (and removed when the matrix is destroyed), so
+// that the operating system can page them out.
+class GramMatrix
+{
+private:
+	int _size;
+	size_t _rowStride; // Floats from one row to the next
+	float* _values;
+	size_t _bytes;
+	bool _mapped; // _values maps a file
+	std::vector<svm_dense_node> _rows;
+
+	GramMatrix(const GramMatrix&);
+	GramMatrix& operator=(const GramMatrix&);
+
+	void allocate(const char* fileName);
+
+public:
+	// Computes the kernel matrix of fset, whose features must all have
+	// the same number of values, on at most nThreads threads of the pool
+	// (0 = all of them). With fileName the matrix is stored in that file.
+	GramMatrix(const FeatureSet& fset, int kernelType = LINEAR, double gamma = 0,
+	           int nThreads = 0, const char* fileName = NULL);
+	~GramMatrix();
+
+	int size() const { return _size; }
+	float operator()(int i, int j) const { return _values[i * _rowStride + j + 1]; }
+
+	// libsvm row of vector i: values[0] = i + 1, values[j + 1] = K(i, j)
+	svm_node* row(int i) { return (svm_node*) &_rows[i]; }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "HardNegativeMining.h"
+#include <cfloat>
+#include <atomic>
+
+// Linear SVM score of a window, the same as predictSlidingWindow at its center
+static double
+windowScore(const Feature& window, const Feature& weights, double bias)
+{
+	CShape shape = weights.Shape();
+	double score = -bias;
+	for(int y = 0; y < shape.height; y++) {
+		const float* x = (const float*) window.PixelAddress(0, y, 0);
+		const float* w = (const float*) weights.PixelAddress(0, y, 0);
+		for(int k = 0; k < shape.width * shape.nBands; k++) {
+			score += x[k] * w[k];
+		}
+	}
+	return score;
+}
+
+HardExampleCache::HardExampleCache(int capacity):
+_capacity(capacity)
+{
+	if(capacity < 1) throw CError("Invalid hard example cache size %d", capacity);
+}
+
+int
+HardExampleCache::size() const
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	return _features.size();
+}
+
+float
+HardExampleCache::threshold() const
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	return ((int) _features.size() < _capacity) ? -FLT_MAX : _scores[_heap.front()];
+}
+
+int
+HardExampleCache::insert(const FeatureSet& features, const std::vector<float>& scores, const std::vector<long long>& keys)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	auto lower = [this](int a, int b) { return _scores[a] > _scores[b]; }; // Lowest score on top
+
+	int nInserted = 0;
+	for(int i = 0; i < (int) features.size(); i++) {
+		if((int) _features.size() == _capacity && scores[i] <= _scores[_heap.front()]) break;
+		if(!_keySet.insert(keys[i]).second) continue;
+		nInserted++;
+
+		if((int) _features.size() < _capacity) {
+			_features.push_back(features[i]);
+			_scores.push_back(scores[i]);
+			_trainIndex.push_back(-1);
+			_keys.push_back(keys[i]);
+			_heap.push_back(_features.size() - 1);
+			std::push_heap(_heap.begin(), _heap.end(), lower);
+			continue;
+		}
+
+		// In place of the easiest example, the others keep their position
+		std::pop_heap(_heap.begin(), _heap.end(), lower);
+		int pos = _heap.back();
+		_keySet.erase(_keys[pos]);
+		_features[pos] = features[i];
+		_scores[pos] = scores[i];
+		_trainIndex[pos] = -1;
+		_keys[pos] = keys[i];
+		std::push_heap(_heap.begin(), _heap.end(), lower);
+	}
+	return nInserted;
+}
+
+void
+HardExampleCache::rescore(const SupportVectorMachine& svm, float margin)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	Feature weights = svm.getWeights();
+	double bias = svm.getBiasTerm();
+	ParallelFor(0, _features.size(), [&](int begin, int end) {
+		for(int i = begin; i < end; i++) {
+			_scores[i] = windowScore(_features[i], weights, bias);
+		}
+	}, 64);
+
+	// Examples that became easy make room, the others keep their order
+	int n = 0;
+	for(int i = 0; i < (int) _features.size(); i++) {
+		if(_scores[i] < margin) {
+			_keySet.erase(_keys[i]);
+			continue;
+		}
+		_features[n] = _features[i];
+		_scores[n] = _scores[i];
+		_trainIndex[n] = _trainIndex[i];
+		_keys[n] = _keys[i];
+		n++;
+	}
+	_features.resize(n);
+	_scores.resize(n);
+	_trainIndex.resize(n);
+	_keys.resize(n);
+
+	_heap.resize(n);
+	for(int i = 0; i < n; i++) _heap[i] = i;
+	std::make_heap(_heap.begin(), _heap.end(), [this](int a, int b) { return _scores[a] > _scores[b]; });
+}
+
+void
+HardExampleCache::appendTo(std::vector<float>& labels, FeatureSet& fset, std::vector<int>& initIndex)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	for(int i = 0; i < (int) _features.size(); i++) {
+		initIndex.push_back(_trainIndex[i]);
+		_trainIndex[i] = fset.size();
+		labels.push_back(-1);
+		fset.push_back(_features[i]);
+	}
+}
+
+long long
+mineHardNegatives(const SupportVectorMachine& svm, const FeatureExtractor& extractor,
+                  const ImageDatabase& negatives, float margin, HardExampleCache& cache,
+                  long long& nHard)
+{
+	Feature weights = svm.getWeights();
+	CShape wShape = weights.Shape();
+	int ox = weights.origin[0], oy = weights.origin[1];
+	int rowLength = wShape.width * wShape.nBands;
+
+	std::atomic<long long> nWindows(0), nAbove(0);
+	ParallelFor(0, negatives.getSize(), [&](int begin, int end) {
+		for(int i = begin; i < end; i++) {
+			CByteImage img;
+			ReadFile(img, negatives.getFilename(i).c_str());
+			Feature feat = extractor(img);
+			CShape fShape = feat.Shape();
+			if(fShape.nBands != wShape.nBands) {
+				throw CError("Features of %s do not match the SVM model", negatives.getFilename(i).c_str());
+			}
+			CFloatImage score = svm.predictSlidingWindow(feat);
+
+			// Windows entirely inside the map, (x, y) being where
+			// predictSlidingWindow puts the window's score
+			std::vector<std::pair<float, int> > above;
+			long long n = 0;
+			for(int y = oy; y - oy + wShape.height <= fShape.height; y++) {
+				const float* s = (const float*) score.PixelAddress(0, y, 0);
+				for(int x = ox; x - ox + wShape.width <= fShape.width; x++, n++) {
+					if(s[x] > margin) above.push_back(std::make_pair(s[x], y * fShape.width + x));
+				}
+			}
+			nWindows += n;
+			nAbove += above.size();
+
+			// Only the windows that can get in the cache are cropped, the
+			// hardest first
+			std::sort(above.begin(), above.end(), std::greater<std::pair<float, int> >());
+			if((int) above.size() > cache.capacity()) above.resize(cache.capacity());
+			float threshold = std::max(margin, cache.threshold());
+			FeatureSet windows;
+			std::vector<float> scores;
+			std::vector<long long> keys;
+			for(int k = 0; k < (int) above.size() && above[k].first > threshold; k++) {
+				int x0 = above[k].second % fShape.width - ox;
+				int y0 = above[k].second / fShape.width - oy;
+				Feature window = packedFeature(wShape);
+				for(int y = 0; y < wShape.height; y++) {
+					memcpy(window.PixelAddress(0, y, 0), feat.PixelAddress(x0, y0 + y, 0), rowLength * sizeof(float));
+				}
+				windows.push_back(window);
+				scores.push_back(above[k].first);
+				keys.push_back(((long long) i << 32) | above[k].second);
+			}
+			cache.insert(windows, scores, keys);
+		}
+	}, 1);
+
+	nHard = nAbove;
+	return nWindows;
+}
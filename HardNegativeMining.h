@@ -0,0 +1,60 @@
+#ifndef HARD_NEGATIVE_MINING_H
+#define HARD_NEGATIVE_MINING_H
+
+#include "Common.h"
+#include "Feature.h"
+#include "SupportVectorMachine.h"
+#include <mutex>
+#include <unordered_set>
+
+// The hardest negative examples found so far, at most capacity of them:
+// once it is full, a new example replaces the one with the lowest score
+// (the easiest) if it scores higher. Each example has a key (e.g., where
+// the window is), an example whose key is in the cache already is not
+// added again. Examples can be added from several threads at once.
+class HardExampleCache
+{
+private:
+	int _capacity;
+	FeatureSet _features;
+	std::vector<float> _scores;
+	std::vector<int> _trainIndex; // In the last training set, -1 if not trained on yet
+	std::vector<long long> _keys;
+	std::unordered_set<long long> _keySet;
+	std::vector<int> _heap; // Positions of the examples, lowest score first
+	mutable std::mutex _lock;
+
+public:
+	HardExampleCache(int capacity);
+
+	int capacity() const { return _capacity; }
+	int size() const;
+
+	// Lowest score an example needs to get in (-FLT_MAX while not full)
+	float threshold() const;
+
+	// Adds the examples, in decreasing order of score, that get in.
+	// Returns how many did.
+	int insert(const FeatureSet& features, const std::vector<float>& scores, const std::vector<long long>& keys);
+
+	// Scores the examples with svm again, and drops the ones below margin
+	void rescore(const SupportVectorMachine& svm, float margin);
+
+	// Appends the examples to a training set, as negatives. initIndex gets
+	// their index in the previous training set they were appended to (-1
+	// for new examples), see SupportVectorMachine::trainWarm.
+	void appendTo(std::vector<float>& labels, FeatureSet& fset, std::vector<int>& initIndex);
+};
+
+// Runs svm over every window of the feature maps (computed by extractor)
+// of the images of negatives, which are all negative, and adds the
+// windows scoring above margin to cache. The window features are cropped
+// from the maps, keyed by the image index (high 32 bits) and the position
+// in the map. The images are scanned in parallel on the ImageLib
+// thread pool, only the windows that get in the cache are kept. Returns
+// the number of windows scanned, and of those above margin in nHard.
+long long mineHardNegatives(const SupportVectorMachine& svm, const FeatureExtractor& extractor,
+                            const ImageDatabase& negatives, float margin, HardExampleCache& cache,
+                            long long& nHard);
+
+#endif
@@ -1,54 +1,105 @@
 #include "PrecisionRecall.h"
+#include <random>
+#include <cfloat>
 
+static const unsigned int bootstrapSeed = 5489u;
+
+// Sorts the examples by decreasing score. On return order holds example
+// indices and runStarts the position in order where each run of equal scores
+// begins, followed by order.size(). Examples with a NaN score are dropped, they
+// are never counted as predicted positive nor as predicted negative.
 static
 void
-computePrecisionRecallForThreshold(const std::vector<float> &gt, const std::vector<float>& preds, 
-	                               float threshold, float& precision, float& recall)
+sortByDecreasingScore(const std::vector<float>& preds, std::vector<int>& order, std::vector<int>& runStarts)
 {
-	// Compute tp, fp, fn, tn
-	int truePos = 0, trueNeg = 0, falsePos = 0, falseNeg = 0;
+	order.resize(0);
+	order.reserve(preds.size());
 	for(int i = 0; i < preds.size(); i++) {
-		if(preds[i] > threshold) {
-			if(gt[i] > 0) truePos++;
-			else falsePos++;
-		} else if(preds[i] <= threshold) {
-			if(gt[i] < 0) trueNeg++;
-			else falseNeg++;			
-		}
+		if(preds[i] == preds[i]) order.push_back(i);
 	}
 
-	if(truePos + falsePos == 0) precision = 1.0;
-	else precision = float(truePos) / (truePos + falsePos);
+	std::sort(order.begin(), order.end(), [&preds](int a, int b) { return preds[a] > preds[b]; });
 
-	if(truePos + falseNeg == 0) recall = 1.0;
-	else recall = float(truePos) / (truePos + falseNeg);
+	runStarts.resize(0);
+	for(int i = 0; i < order.size(); i++) {
+		if(i == 0 || preds[order[i]] != preds[order[i - 1]]) runStarts.push_back(i);
+	}
+	runStarts.push_back(order.size());
 }
 
-bool
-sortByRecall(const PecisionRecallPoint& a, const PecisionRecallPoint& b)
+static
+void
+addToBin(PrecisionRecallBin& bin, float gt, double count)
 {
-	return a.recall < b.recall;
+	if(gt > 0) bin.positives += count;
+	else if(gt < 0) bin.negatives += count;
+	else bin.unlabeled += count;
 }
 
 PrecisionRecall::PrecisionRecall(const std::vector<float> &gt, const std::vector<float>& preds)
 {
-	std::set<float> thresholds;
-	for (int i = 0; i < preds.size(); ++i) {
-		thresholds.insert(preds[i]);
+	std::vector<int> order, runStarts;
+	sortByDecreasingScore(preds, order, runStarts);
+
+	std::vector<PrecisionRecallBin> bins(runStarts.size() - 1);
+	for(int r = 0; r < bins.size(); r++) {
+		PrecisionRecallBin& bin = bins[r];
+		bin.score = preds[order[runStarts[r]]];
+		bin.positives = bin.negatives = bin.unlabeled = 0;
+		for(int i = runStarts[r]; i < runStarts[r + 1]; i++) {
+			addToBin(bin, gt[order[i]], 1);
+		}
+	}
+
+	compute(bins);
+}
+
+PrecisionRecall::PrecisionRecall(const PrecisionRecallAccumulator& acc)
+{
+	compute(acc.getBins());
+}
+
+PrecisionRecall::PrecisionRecall(const std::vector<PrecisionRecallBin>& bins)
+{
+	compute(bins);
+}
+
+void
+PrecisionRecall::compute(const std::vector<PrecisionRecallBin>& bins)
+{
+	double totalPos = 0, totalUnlabeled = 0;
+	for(int b = 0; b < bins.size(); b++) {
+		totalPos += bins[b].positives;
+		totalUnlabeled += bins[b].unlabeled;
 	}
 
+	// Sweep thresholds from the highest score down. Everything in the bins
+	// already visited scores strictly above the current threshold and is
+	// predicted positive. Unlabeled examples count as false positives above
+	// the threshold and as false negatives below it.
 	_data.resize(0);
+	_data.reserve(bins.size());
+
+	double truePos = 0, falsePos = 0, unlabeledAbove = 0;
+	for(int b = 0; b < bins.size(); b++) {
+		double falseNeg = totalPos + totalUnlabeled - truePos - unlabeledAbove;
 
-	for(std::set<float>::iterator th = thresholds.begin(); th != thresholds.end(); th++) {
 		PecisionRecallPoint pr;
-		computePrecisionRecallForThreshold(gt, preds, *th, pr.precision, pr.recall); 
-		pr.threshold = *th;
+		if(truePos + falsePos == 0) pr.precision = 1.0;
+		else pr.precision = float(truePos) / float(truePos + falsePos);
 
+		if(truePos + falseNeg == 0) pr.recall = 1.0;
+		else pr.recall = float(truePos) / float(truePos + falseNeg);
+
+		pr.threshold = bins[b].score;
 		_data.push_back(pr);
-	}
 
-	std::sort(_data.begin(), _data.end(), sortByRecall);
+		truePos += bins[b].positives;
+		falsePos += bins[b].negatives + bins[b].unlabeled;
+		unlabeledAbove += bins[b].unlabeled;
+	}
 
+	// Thresholds were visited in decreasing order so recall is already sorted
 	// Remove jags in precision recall curve
 	float maxPrecision = -1;
 	for(std::vector<PecisionRecallPoint>::reverse_iterator pr = _data.rbegin(); pr != _data.rend(); pr++) {
@@ -58,6 +109,7 @@ PrecisionRecall::PrecisionRecall(const std::vector<float> &gt, const std::vector
 
 	// Compute average precision as area under the curve
 	_averagePrecision = 0.0;
+	if(_data.empty()) return;
 	for(std::vector<PecisionRecallPoint>::iterator pr = _data.begin() + 1, prPrev = _data.begin(); pr != _data.end(); pr++, prPrev++) {
 		float xdiff = pr->recall - prPrev->recall;
 		float ydiff = pr->precision - prPrev->precision;
@@ -79,7 +131,7 @@ PrecisionRecall::save(const char* filename) const
 	}
 }
 
-double 
+double
 PrecisionRecall::getBestThreshold() const
 {
 	double bestFMeasure = -1, bestThreshold = -1;
@@ -90,7 +142,189 @@ PrecisionRecall::getBestThreshold() const
 			bestFMeasure = fMeasure;
 			bestThreshold = pr->threshold;
 		}
-	}	
+	}
 
 	return bestThreshold;
 }
+
+void
+PrecisionRecall::bootstrapAveragePrecision(const std::vector<float>& gt, const std::vector<float>& preds,
+                                           int nSamples, double confidence, double& apLow, double& apHigh)
+{
+	if(gt.size() != preds.size()) throw CError("Ground truth and predictions must have the same size");
+	if(nSamples <= 0) throw CError("Invalid number of bootstrap samples %d", nSamples);
+
+	// Sort once, each resample only changes how many times every example is
+	// counted, so its curve is a single linear sweep over the sorted order.
+	std::vector<int> order, runStarts;
+	sortByDecreasingScore(preds, order, runStarts);
+	int n = order.size();
+
+	std::vector<double> aps(nSamples, 0.0);
+	if(n > 0) {
+		ParallelFor(0, nSamples, [&](int sBegin, int sEnd) {
+			PrecisionRecall pr;
+			std::vector<int> counts(n);
+			std::vector<PrecisionRecallBin> bins;
+			bins.reserve(runStarts.size());
+
+			for(int s = sBegin; s < sEnd; s++) {
+				std::mt19937 rng(bootstrapSeed + s);
+				std::uniform_int_distribution<int> pick(0, n - 1);
+				std::fill(counts.begin(), counts.end(), 0);
+				for(int k = 0; k < n; k++) counts[pick(rng)]++;
+
+				bins.resize(0);
+				for(int r = 0; r + 1 < runStarts.size(); r++) {
+					PrecisionRecallBin bin;
+					bin.score = preds[order[runStarts[r]]];
+					bin.positives = bin.negatives = bin.unlabeled = 0;
+					for(int i = runStarts[r]; i < runStarts[r + 1]; i++) {
+						if(counts[i] > 0) addToBin(bin, gt[order[i]], counts[i]);
+					}
+
+					// Scores that were not drawn do not produce a threshold
+					if(bin.positives + bin.negatives + bin.unlabeled > 0) bins.push_back(bin);
+				}
+
+				pr.compute(bins);
+				aps[s] = pr.getAveragePrecision();
+			}
+		});
+	}
+
+	std::sort(aps.begin(), aps.end());
+	double alpha = (1.0 - confidence) / 2.0;
+	apLow = aps[int(floor(alpha * (nSamples - 1)))];
+	apHigh = aps[int(ceil((1.0 - alpha) * (nSamples - 1)))];
+}
+
+// ============================================================================
+// PrecisionRecallAccumulator
+// ============================================================================
+
+PrecisionRecallAccumulator::PrecisionRecallAccumulator(float minScore, float maxScore, int nBins):
+_minScore(minScore), _maxScore(maxScore), _maxSeen(-FLT_MAX), _nBins(nBins)
+{
+	if(nBins <= 0 || !(minScore < maxScore)) throw CError("Invalid precision recall accumulator binning");
+
+	// Bin 0 holds scores below minScore and bin nBins + 1 scores above maxScore
+	_positives.assign(nBins + 2, 0);
+	_negatives.assign(nBins + 2, 0);
+	_unlabeled.assign(nBins + 2, 0);
+}
+
+int
+PrecisionRecallAccumulator::binIndex(float score) const
+{
+	if(score < _minScore) return 0;
+	if(score >= _maxScore) return _nBins + 1;
+	int bin = int((double(score) - _minScore) / (double(_maxScore) - _minScore) * _nBins);
+	return 1 + min(bin, _nBins - 1);
+}
+
+void
+PrecisionRecallAccumulator::add(float score, float gt)
+{
+	// NaN scores are neither predicted positive nor negative
+	if(score != score) return;
+
+	int bin = binIndex(score);
+	if(gt > 0) _positives[bin]++;
+	else if(gt < 0) _negatives[bin]++;
+	else _unlabeled[bin]++;
+
+	_maxSeen = max(_maxSeen, score);
+}
+
+void
+PrecisionRecallAccumulator::add(const std::vector<float>& gt, const std::vector<float>& preds)
+{
+	if(gt.size() != preds.size()) throw CError("Ground truth and predictions must have the same size");
+	for(int i = 0; i < preds.size(); i++) {
+		add(preds[i], gt[i]);
+	}
+}
+
+void
+PrecisionRecallAccumulator::merge(const PrecisionRecallAccumulator& other)
+{
+	if(other._minScore != _minScore || other._maxScore != _maxScore || other._nBins != _nBins) {
+		throw CError("Cannot merge precision recall accumulators with different binning");
+	}
+
+	for(int b = 0; b < _nBins + 2; b++) {
+		_positives[b] += other._positives[b];
+		_negatives[b] += other._negatives[b];
+		_unlabeled[b] += other._unlabeled[b];
+	}
+	_maxSeen = max(_maxSeen, other._maxSeen);
+}
+
+long long
+PrecisionRecallAccumulator::getCount() const
+{
+	long long count = 0;
+	for(int b = 0; b < _nBins + 2; b++) {
+		count += _positives[b] + _negatives[b] + _unlabeled[b];
+	}
+	return count;
+}
+
+std::vector<PrecisionRecallBin>
+PrecisionRecallAccumulator::getBins() const
+{
+	std::vector<PrecisionRecallBin> bins;
+	for(int b = _nBins + 1; b >= 0; b--) {
+		if(_positives[b] + _negatives[b] + _unlabeled[b] == 0) continue;
+
+		// Everything in the bins above scores at least the upper edge of this one
+		PrecisionRecallBin bin;
+		if(b == _nBins + 1) bin.score = _maxSeen;
+		else bin.score = _minScore + (double(_maxScore) - _minScore) * b / _nBins;
+		bin.positives = _positives[b];
+		bin.negatives = _negatives[b];
+		bin.unlabeled = _unlabeled[b];
+		bins.push_back(bin);
+	}
+	return bins;
+}
+
+void
+PrecisionRecallAccumulator::save(const char* filename) const
+{
+	std::ofstream f(filename);
+	if(!f.is_open()) throw CError("Could not open file %s for writing", filename);
+
+	f << "# precision recall accumulator: minScore maxScore nBins maxSeen, then bin positives negatives unlabeled\n";
+	f << std::setprecision(9) << _minScore << " " << _maxScore << " " << _nBins << " " << _maxSeen << "\n";
+	for(int b = 0; b < _nBins + 2; b++) {
+		if(_positives[b] + _negatives[b] + _unlabeled[b] == 0) continue;
+		f << b << " " << _positives[b] << " " << _negatives[b] << " " << _unlabeled[b] << "\n";
+	}
+}
+
+void
+PrecisionRecallAccumulator::load(const char* filename)
+{
+	std::ifstream f(filename);
+	if(!f.is_open()) throw CError("Could not open file %s for reading", filename);
+
+	std::string comment;
+	std::getline(f, comment);
+
+	f >> _minScore >> _maxScore >> _nBins >> _maxSeen;
+	if(f.fail() || _nBins <= 0 || !(_minScore < _maxScore)) throw CError("Invalid precision recall accumulator file %s", filename);
+
+	_positives.assign(_nBins + 2, 0);
+	_negatives.assign(_nBins + 2, 0);
+	_unlabeled.assign(_nBins + 2, 0);
+
+	int b;
+	while(f >> b) {
+		if(b < 0 || b >= _nBins + 2) throw CError("Invalid bin in precision recall accumulator file %s", filename);
+		f >> _positives[b] >> _negatives[b] >> _unlabeled[b];
+		if(f.fail()) throw CError("Invalid bin counts in precision recall accumulator file %s", filename);
+	}
+	if(!f.eof()) throw CError("Invalid bin in precision recall accumulator file %s", filename);
+}
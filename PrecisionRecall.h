@@ -8,6 +8,15 @@ typedef struct {
 	float precision, recall, threshold;
 } PecisionRecallPoint;
 
+// Number of ground truth positives (gt > 0), negatives (gt < 0) and
+// unlabeled examples (gt == 0) that received the same classifier score
+typedef struct {
+	float score;
+	double positives, negatives, unlabeled;
+} PrecisionRecallBin;
+
+class PrecisionRecallAccumulator;
+
 // Computes and stores a precision recall curve
 class PrecisionRecall
 {
@@ -15,11 +24,24 @@ private:
 	std::vector<PecisionRecallPoint> _data;
 	float _averagePrecision;
 
+	PrecisionRecall() {}
+
+	// Fills _data and _averagePrecision, see PrecisionRecall(bins)
+	void compute(const std::vector<PrecisionRecallBin>& bins);
+
 public:
 	// Computes precision recall given a set of gound truth labels in gt and
 	// a set of predictions made by our classifier in preds.
 	PrecisionRecall(const std::vector<float>& gt, const std::vector<float>& preds);
 
+	// Computes the approximate precision recall curve of all the predictions
+	// added to acc, see PrecisionRecallAccumulator.
+	PrecisionRecall(const PrecisionRecallAccumulator& acc);
+
+	// Computes the curve from bins sorted by decreasing score, one curve
+	// point per bin using the bin score as threshold.
+	PrecisionRecall(const std::vector<PrecisionRecallBin>& bins);
+
 	// Returns area under the curve
 	double getAveragePrecision() const { return _averagePrecision; }
 
@@ -29,6 +51,54 @@ public:
 	// Save curve points to a .pr file. See inclded plot_pr.m file for a
 	// MATLAB script that can plot this data.
 	void save(const char* filename) const;
+
+	// Estimates a confidence interval for the average precision of (gt, preds)
+	// by resampling the examples with replacement nSamples times. The
+	// resamples are spread over the ImageLib thread pool and seeded
+	// deterministically, so the result does not depend on the number of threads.
+	static void bootstrapAveragePrecision(const std::vector<float>& gt, const std::vector<float>& preds,
+	                                      int nSamples, double confidence, double& apLow, double& apHigh);
+};
+
+// Collects predictions for a precision recall curve in constant memory.
+// Scores are counted in nBins equally spaced bins over [minScore, maxScore),
+// plus one bin on each side for scores outside that range, separately for
+// positive, negative and unlabeled examples. Accumulators with the same
+// binning can be merged, so shards of a dataset can be evaluated separately
+// and combined afterwards.
+//
+// The resulting curve has one threshold per non-empty bin, at the bin's upper
+// edge, and is exact for those thresholds. Compared to the curve computed from
+// all the predictions, thresholds are thus moved by less than one bin width
+// (scores above maxScore all share a single threshold).
+class PrecisionRecallAccumulator
+{
+private:
+	float _minScore, _maxScore, _maxSeen;
+	int _nBins;
+	std::vector<long long> _positives, _negatives, _unlabeled;
+
+	int binIndex(float score) const;
+
+public:
+	PrecisionRecallAccumulator(float minScore = -4.0f, float maxScore = 4.0f, int nBins = 1 << 16);
+
+	// Add one prediction and its ground truth label, or a whole set of them
+	void add(float score, float gt);
+	void add(const std::vector<float>& gt, const std::vector<float>& preds);
+
+	// Add all predictions collected by other, which must use the same binning
+	void merge(const PrecisionRecallAccumulator& other);
+
+	// Number of predictions added so far
+	long long getCount() const;
+
+	// Non-empty bins sorted by decreasing score
+	std::vector<PrecisionRecallBin> getBins() const;
+
+	// Loading and saving to a text file, only non-empty bins are stored
+	void load(const char* filename);
+	void save(const char* filename) const;
 };
 
-#endif // PRECISIONRECALL_H
\ No newline at end of file
+#endif // PRECISIONRECALL_H
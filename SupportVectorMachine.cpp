@@ -1,14 +1,75 @@
 #include "SupportVectorMachine.h"
+#include "GramMatrix.h"
+#include <mutex>
+
+// Returns the values of feat as one contiguous array: feat itself (sharing
+// its memory) unless its rows are padded, otherwise a packed copy. The
+// extractors allocate packed features (see packedFeature in Feature.h), so
+// the copy is only made for features built some other way.
+static Feature
+contiguousFeature(const Feature& feat)
+{
+	CShape shape = feat.Shape();
+	int rowLength = shape.width * shape.nBands;
+	if(shape.height <= 1 || feat.RowStride() == rowLength * (int)sizeof(float)) return feat;
+
+	Feature packed(rowLength * shape.height, 1, 1);
+	float* dst = (float*) packed.PixelAddress(0, 0, 0);
+	for(int y = 0; y < shape.height; y++, dst += rowLength) {
+		memcpy(dst, feat.PixelAddress(0, y, 0), rowLength * sizeof(float));
+	}
+	return packed;
+}
+
+// libsvm dense vector on the memory of a feature from contiguousFeature
+static svm_dense_node
+denseNode(const Feature& contiguous)
+{
+	CShape shape = contiguous.Shape();
+	svm_dense_node node;
+	node.index = SVM_DENSE_INDEX;
+	node.dim = shape.width * shape.height * shape.nBands;
+	node.values = (const float*) contiguous.PixelAddress(0, 0, 0);
+	return node;
+}
+
+// Throws if a feature of shape fShape cannot be scored by a model trained on
+// features of shape modelShape (e.g. a model saved by an older version of
+// the extractor); sliding windows only need the bands to agree
+static void
+checkFeatureShape(CShape fShape, CShape modelShape, bool slidingWindow)
+{
+	bool matches = slidingWindow ? fShape.nBands == modelShape.nBands : fShape == modelShape;
+	if(matches) return;
+
+	char fDims[64], modelDims[64];
+	snprintf(fDims, sizeof(fDims), "%dx%dx%d", fShape.width, fShape.height, fShape.nBands);
+	snprintf(modelDims, sizeof(modelDims), "%dx%dx%d", modelShape.width, modelShape.height, modelShape.nBands);
+	throw CError("Feature of shape %s does not fit the model, which was trained on features of shape %s", fDims, modelDims);
+}
+
+// libsvm's parallel loops (see svm_set_parallel_function) run on the
+// ImageLib thread pool, split into at most svmMaxThreads chunks
+static int svmMaxThreads = 0;
+static bool svmParallel = false;
+static std::mutex svmSettingsLock;
+
+static void
+svmParallelFor(int begin, int end, int grain, void (*fn)(int, int, void*), void* arg)
+{
+	int nThreads = ParallelNumThreads();
+	if(svmMaxThreads > 0) nThreads = std::min(nThreads, svmMaxThreads);
+	int chunk = std::max(grain, (end - begin + nThreads - 1) / nThreads);
+	ParallelFor(begin, end, [&](int b, int e) { fn(b, e, arg); }, chunk);
+}
 
 SupportVectorMachine::SupportVectorMachine(): 
-_model(NULL), 
-_data(NULL)
+_model(NULL)
 {
 }
 
 SupportVectorMachine::SupportVectorMachine(const char* modelFName):
-_model(NULL), 
-_data(NULL)
+_model(NULL)
 {
 	load(modelFName);
 }
@@ -17,9 +78,10 @@ void
 SupportVectorMachine::deinit()
 {
 	if(_model != NULL) svm_free_and_destroy_model(&_model);
-	if(_data != NULL) delete [] _data;
 	_model = NULL;
-	_data = NULL;	
+	_nodes.clear();
+	_vectors.clear();
+	_weights = Feature();
 }
 
 SupportVectorMachine::~SupportVectorMachine()
@@ -28,16 +90,57 @@ SupportVectorMachine::~SupportVectorMachine()
 }
 
 void 
-SupportVectorMachine::train(const std::vector<float>& labels, const FeatureSet& fset, double C)
+SupportVectorMachine::train(const std::vector<float>& labels, const FeatureSet& fset, double C, int nThreads, double cacheSizeMB)
+{
+	trainModel(labels, fset, C, nThreads, cacheSizeMB, false, NULL, NULL, NULL);
+}
+
+void 
+SupportVectorMachine::trainGram(const std::vector<float>& labels, const FeatureSet& fset, double C, int nThreads,
+                                const char* gramFName)
+{
+	// The kernel cache only saves gathering the rows of the matrix
+	trainModel(labels, fset, C, nThreads, 16, true, gramFName, NULL, NULL);
+}
+
+void 
+SupportVectorMachine::trainWarm(const std::vector<float>& labels, const FeatureSet& fset, double C,
+                                const SupportVectorMachine& init, int nThreads, double cacheSizeMB)
+{
+	trainModel(labels, fset, C, nThreads, cacheSizeMB, false, NULL, &init, NULL);
+}
+
+void 
+SupportVectorMachine::trainWarm(const std::vector<float>& labels, const FeatureSet& fset, double C,
+                                const SupportVectorMachine& init, const std::vector<int>& initIndex,
+                                int nThreads, double cacheSizeMB)
+{
+	trainModel(labels, fset, C, nThreads, cacheSizeMB, false, NULL, &init, &initIndex);
+}
+
+void 
+SupportVectorMachine::trainModel(const std::vector<float>& labels, const FeatureSet& fset, double C, int nThreads,
+                                 double cacheSizeMB, bool gram, const char* gramFName,
+                                 const SupportVectorMachine* init, const std::vector<int>* initIndex)
 {	
 	if(labels.size() != fset.size()) throw std::runtime_error("Database size is different from feature set size!");
 
+	// A model read with load() does not know which training examples its
+	// support vectors were, it cannot be used to warm start
+	if(init != NULL && (init->_model == NULL || init->_model->sv_indices == NULL)) {
+		throw std::runtime_error("Can only warm start from a model trained in this process!");
+	}
+
 	_fVecShape = fset[0].Shape();
 
 	// Figure out size and number of feature vectors
 	int nVecs = labels.size();
 	CShape shape = fset[0].Shape();
 	int dim = shape.width * shape.height * shape.nBands;
+	for(int i=0; i<nVecs; i++){
+		CShape fShape = fset[i].Shape();
+		if(fShape.width * fShape.height * fShape.nBands != dim) throw std::runtime_error("Feature vectors have different sizes!");
+	}
 
 	// Parameters for SVM
 	svm_parameter parameter;
@@ -47,7 +150,7 @@ SupportVectorMachine::train(const std::vector<float>& labels, const FeatureSet&
 	parameter.gamma = 0;
 	parameter.coef0 = 0;
 	parameter.nu = 0.5;
-	parameter.cache_size = 100;  // In MB
+	parameter.cache_size = cacheSizeMB;  // In MB, 0 = a quarter of the available memory
 	parameter.C = C;
 	parameter.eps = 1e-3;
 	parameter.p = 0.1;
@@ -63,54 +166,99 @@ SupportVectorMachine::train(const std::vector<float>& labels, const FeatureSet&
 	problem.l = nVecs;
 	problem.y = new double[nVecs];
 	problem.x = new svm_node*[nVecs];
-	if(_data) delete [] _data;
+
+	// Freed after training, init may be this machine
+	const svm_model* initModel = (init != NULL) ? init->_model : NULL;
+	svm_model* previous = _model;
+	_model = NULL;
+
+	// With initIndex, init's support vectors are renumbered to this
+	// training set (the ones that are not in it are left out)
+	svm_model renumbered;
+	std::vector<int> svIndices;
+	std::vector<double> svCoef;
+	double* svCoefRows[1];
+	if(initModel != NULL && initIndex != NULL && initModel->sv_indices != NULL && initModel->nr_class == 2) {
+		if((int) initIndex->size() != nVecs) throw std::runtime_error("Initial index size is different from feature set size!");
+		std::vector<int> newIndex;
+		for(int i=0; i<nVecs; i++){
+			int old = (*initIndex)[i];
+			if(old < 0) continue;
+			if(old >= (int) newIndex.size()) newIndex.resize(old + 1, -1);
+			newIndex[old] = i;
+		}
+		for(int s = 0; s < initModel->l; s++) {
+			int old = initModel->sv_indices[s] - 1;
+			if(old >= (int) newIndex.size() || newIndex[old] < 0) continue;
+			svIndices.push_back(newIndex[old] + 1);
+			svCoef.push_back(initModel->sv_coef[0][s]);
+		}
+		renumbered = *initModel;
+		renumbered.l = svIndices.size();
+		renumbered.sv_indices = svIndices.empty() ? NULL : &svIndices[0];
+		svCoefRows[0] = svCoef.empty() ? NULL : &svCoef[0];
+		renumbered.sv_coef = svCoefRows;
+		initModel = &renumbered;
+	}
 
 	/******** BEGIN TODO ********/
 	// Copy the data used for training the SVM into the libsvm data structures "problem".
-	// Put the feature vectors in _data and labels in problem.y. Also, problem.x[k]
-	// should point to the address in _data where the k-th feature vector starts (i.e.,
-	// problem.x[k] = &_data[starting index of k-th feature])
+	// Labels go in problem.y, and problem.x[k] points to the k-th feature vector.
 	//
-	// Hint:
-	// * Don't forget to set _data[].index to the corresponding dimension in
-	//   the original feature vector. You also need to set _data[].index to -1
-	//   right after the last element of each feature vector
-
-	// Vector containing all feature vectors. svm_node is a struct with
-	// two fields, index and value. Index entry indicates position 
-	// in feature vector while value is the value in the original feature vector, 
-	// each feature vector of size k takes up k+1 svm_node's in _data
-	// the last one being simply to indicate that the feature has ended by setting the index
-	// entry to -1
-	_data = new svm_node[nVecs * (dim + 1)];
-	int j = 0;
+	// The feature vectors are handed to libsvm as dense vectors (see
+	// svm_dense_node in svm.h): one node per vector, pointing to the
+	// feature's own memory (4 bytes per value rather than an index and
+	// a double), so that kernel evaluations are vectorized dot products.
+	// Extracted features are packed, so no values are copied; only features
+	// with padded rows are packed into a copy first.
+	_nodes.resize(nVecs);
+	_vectors.resize(nVecs);
 	for(int i=0; i<nVecs; i++){
-		Feature feat = fset.at(i);
-		int index=0;
-		problem.x[i] = &_data[j];
+		_vectors[i] = contiguousFeature(fset.at(i));
+		_nodes[i] = denseNode(_vectors[i]);
+		problem.x[i] = (svm_node*) &_nodes[i];
 		problem.y[i] = labels.at(i);
-		for (int y=0; y<feat.Shape().height; y++){
-			for (int x=0; x<feat.Shape().width; x++){
-				for(int b=0; b<feat.Shape().nBands; b++){
-					_data[j].index = index;
-					_data[j].value = feat.Pixel(x,y,b);
-					j++;
-					index++;
-				}
-			}
-		}
-		_data[j++].index = -1;
 	}
-	
+
 	//printf("TODO: SupportVectorMachine.cpp:87\n"); exit(EXIT_FAILURE); 
 
 	/******** END TODO ********/
 
 	// Train the model
-	if(_model != NULL) svm_free_and_destroy_model(&_model);
-	_model = svm_train(&problem, &parameter);
+	{
+		// Only changed when it has to, other machines may be training
+		std::lock_guard<std::mutex> guard(svmSettingsLock);
+		if(svmMaxThreads != nThreads || svmParallel != (nThreads != 1)) {
+			svmMaxThreads = nThreads;
+			svmParallel = (nThreads != 1);
+			svm_set_parallel_function(svmParallel ? svmParallelFor : NULL);
+		}
+	}
+	if(!gram) {
+		_model = svm_train_warm_start(&problem, &parameter, initModel);
+	} else {
+		// Training on the rows of the kernel matrix, the support vectors
+		// are pointed back to the feature vectors afterwards (same kernel)
+		GramMatrix gramMatrix(_vectors, LINEAR, 0, nThreads, gramFName);
+		for(int i=0; i<nVecs; i++) problem.x[i] = gramMatrix.row(i);
+		parameter.kernel_type = PRECOMPUTED;
+		_model = svm_train_warm_start(&problem, &parameter, initModel);
+		_model->param.kernel_type = LINEAR;
+		for(int s = 0; s < _model->l; s++) {
+			_model->SV[s] = (svm_node*) &_nodes[_model->sv_indices[s] - 1];
+		}
+	}
+
+	// Only the support vectors are needed from now on
+	FeatureSet svVectors(_model->l);
+	for(int s = 0; s < _model->l; s++) {
+		svVectors[s] = _vectors[_model->sv_indices[s] - 1];
+	}
+	_vectors.swap(svVectors);
+	_weights = getWeights();
 
 	// Cleanup
+	if(previous != NULL) svm_free_and_destroy_model(&previous);
 	delete [] problem.y;
 	delete [] problem.x;
 }
@@ -118,26 +266,16 @@ SupportVectorMachine::train(const std::vector<float>& labels, const FeatureSet&
 float 
 SupportVectorMachine::predict(const Feature& feature) const
 {
-	CShape shape = feature.Shape();
-	int dim = shape.width * shape.height * shape.nBands;
+	if(_model == NULL) throw CError("Predicting but there is no model. Either load one from file or train one before.");
+	checkFeatureShape(feature.Shape(), _fVecShape, false);
 
-	svm_node* svmNode = new svm_node[dim + 1];
-
-	svm_node* svmNodeIter = svmNode;
-
-	for(int y = 0, k = 0; y < shape.height; y++) {
-		float* data = (float*) feature.PixelAddress(0, y, 0);
-		for (int x = 0; x < shape.width * shape.nBands; x++, data++, k++, svmNodeIter++) {
-			svmNodeIter->index = k;
-			svmNodeIter->value = *data;
-		}
-	}
-	svmNodeIter->index = -1;
+	// Dense vector on the feature memory (copied only if its rows are
+	// padded), works with both trained and loaded (sparse) models
+	Feature values = contiguousFeature(feature);
+	svm_dense_node node = denseNode(values);
 
 	double decisionValue;
-	float label = svm_predict_values(_model, svmNode, &decisionValue);
-
-	delete [] svmNode;
+	svm_predict_values(_model, (const svm_node*) &node, &decisionValue);
 
 	return decisionValue;
 }
@@ -177,6 +315,19 @@ SupportVectorMachine::getWeights() const
 		double coeff = _model->sv_coef[0][s];
 		svm_node* sv = _model->SV[s];
 
+		if(sv->index == SVM_DENSE_INDEX) {
+			// Trained model, the values are the feature's
+			const float* v = ((const svm_dense_node*) sv)->values;
+			assert(((const svm_dense_node*) sv)->dim == _fVecShape.width * _fVecShape.height * _fVecShape.nBands);
+			for(int y = 0; y < _fVecShape.height; y++) {
+				float* w = (float*) weightVec.PixelAddress(0,y,0);
+				for(int x = 0; x < _fVecShape.width * _fVecShape.nBands; x++, w++, v++) {
+					*w += *v * coeff;
+				}
+			}
+			continue;
+		}
+
 		for(int y = 0, d = 0; y < _fVecShape.height; y++) {
 			float* w = (float*) weightVec.PixelAddress(0,y,0);
 			for(int x = 0; x < _fVecShape.width * _fVecShape.nBands; x++, d++, w++, sv++) {
@@ -206,6 +357,7 @@ SupportVectorMachine::load(FILE* fp)
 	if(_model == NULL) {
 		throw CError("Failed to load SVM model");
 	}	
+	_weights = getWeights();
 }
 
 void 
@@ -273,25 +425,28 @@ SupportVectorMachine::predictSlidingWindow(const Feature& feat) const
 	// Convolve, BandSelect, this->getWeights(), this->getBiasTerm()
 
 	//printf("TODO: SupportVectorMachine.cpp:273\n"); exit(EXIT_FAILURE); 
-	Feature weights = getWeights();
+	if(_model == NULL) throw CError("Sliding window prediction but there is no model. Either load one from file or train one before.");
+	checkFeatureShape(feat.Shape(), _fVecShape, true);
+	const Feature& weights = _weights;
+	// Scratch images are shared by all the bands; each band of feat is
+	// filtered on its own (bands do not mix in Convolve)
+	CFloatImage currentBandWeights(weights.Shape().width, weights.Shape().height, 1);
+	CFloatImage currentBandFeatures(feat.Shape().width, feat.Shape().height, 1);
+	CFloatImage convolved(CShape(feat.Shape().width, feat.Shape().height, 1));
+	currentBandWeights.origin[0] = weights.origin[0];
+	currentBandWeights.origin[1] = weights.origin[1];
 	for (int b=0; b<feat.Shape().nBands; b++){
-		CFloatImage currentBandWeights = CFloatImage(weights.Shape().width, weights.Shape().height, 1);
-		CFloatImage currentBandFeatures = CFloatImage(feat.Shape().width, feat.Shape().height, 1);
-		CFloatImage convolved = CFloatImage(CShape(feat.Shape().width, feat.Shape().height, 1));
-		CFloatImage final(CShape(feat.Shape().width, feat.Shape().height, 1));
 		BandSelect(weights, currentBandWeights, b, 0);
 		BandSelect(feat, currentBandFeatures, b, 0);
-		currentBandWeights.origin[0] = weights.origin[0];
-		currentBandWeights.origin[1] = weights.origin[1];
-		Convolve(feat, convolved, currentBandWeights);
-		BandSelect(convolved, final, b, 0);
+		Convolve(currentBandFeatures, convolved, currentBandWeights);
 		try{
-		score += final;
+		// The bias is subtracted in the same pass as the last band
+		if (b == feat.Shape().nBands - 1) score = score + convolved - getBiasTerm();
+		else score += convolved;
 		} catch (CError err) {
 			printf("OH NOES: the final chapter!");
 		}
 	}
-	score-=getBiasTerm();
 	/******** END TODO ********/
 
 	return score;
@@ -9,12 +9,21 @@ class SupportVectorMachine
 {
 private:
 	struct svm_model* _model;
-	svm_node* _data; // Have to keep this around if we want to save the model after training
+	// The model's support vectors point to these (dense nodes on the
+	// training features), have to keep them around to save the model
+	std::vector<svm_dense_node> _nodes;
+	FeatureSet _vectors; // Memory of the support vectors' nodes
 	CShape _fVecShape; // Shape of feature vector
+	Feature _weights; // getWeights(), for predictSlidingWindow
 
 private:
 	// De allocate memory
 	void deinit();
+
+	// See train, trainGram and trainWarm
+	void trainModel(const std::vector<float>& labels, const FeatureSet& fset, double C, int nThreads,
+	                double cacheSizeMB, bool gram, const char* gramFName, const SupportVectorMachine* init,
+	                const std::vector<int>* initIndex);
 	
 public:
 	SupportVectorMachine();
@@ -23,10 +32,38 @@ public:
 	SupportVectorMachine(const char* modelFName);
 	~SupportVectorMachine();
 
-	void train(const std::vector<float>& labels, const FeatureSet& fset, double C = 0.01);
+	// Kernel evaluations run on at most nThreads threads of the ImageLib
+	// thread pool (0 = all of them, see Parallel.h). Kernel columns are
+	// cached in cacheSizeMB megabytes (0 = a quarter of the available
+	// memory, shared by the machines training at the same time;
+	// svm_get_cache_stats reports the hit rate)
+	void train(const std::vector<float>& labels, const FeatureSet& fset, double C = 0.01, int nThreads = 0, double cacheSizeMB = 0);
+
+	// Same as train, but computes the whole kernel matrix first (see
+	// GramMatrix), in memory or in the file gramFName. Faster as long as
+	// the matrix fits, which takes 4 n^2 bytes for n vectors.
+	void trainGram(const std::vector<float>& labels, const FeatureSet& fset, double C = 0.01, int nThreads = 0,
+	               const char* gramFName = NULL);
+
+	// Same as train, but starting from the solution of init, trained on
+	// the same labels and features with another C (see
+	// svm_train_warm_start), which takes far fewer iterations when C
+	// changes little. init may be this machine. Several machines may
+	// train at once (with the same nThreads). init must have been trained
+	// (not loaded from a file, which leaves out the training set indices
+	// of its support vectors), otherwise std::runtime_error is thrown.
+	void trainWarm(const std::vector<float>& labels, const FeatureSet& fset, double C,
+	               const SupportVectorMachine& init, int nThreads = 0, double cacheSizeMB = 0);
+
+	// Same as above for a training set that changed since init was
+	// trained: example i of fset was example initIndex[i] of init's
+	// training set (-1 for a new example).
+	void trainWarm(const std::vector<float>& labels, const FeatureSet& fset, double C,
+	               const SupportVectorMachine& init, const std::vector<int>& initIndex,
+	               int nThreads = 0, double cacheSizeMB = 0);
 
 	// Run classifier on feature, size of feature must match one used for
-	// model training
+	// model training (throws CError otherwise)
 	float predict(const Feature& feature) const;
 	std::vector<float> predict(const FeatureSet& fset) const;
 
@@ -36,6 +73,7 @@ public:
 
 	// Runs classifier at every location of feature feat, returns a
 	// single channel image with classifier output at each location.
+	// feat must have as many bands as the features used for training.
 	CFloatImage predictSlidingWindow(const Feature& feat) const;
 
 	// Loading and saving model to file
@@ -4,21 +4,8 @@ template <typename T>
 void
 convertRGB2GrayImage(const CImageOf<T>& rgb, CImageOf<T>& gray)
 {
-	CShape shape = rgb.Shape();
-	shape.nBands = 1;
-	gray.ReAllocate(shape);
-
-	for (int i = 0; i < shape.height; i++) {
-		for (int j = 0; j < shape.width; j++) {
-
-			gray.Pixel(j, i, 0) = 0;
-			double val = 0.0;
-			for (int c = 0; c < rgb.Shape().nBands; c++) {
-				val +=  rgb.Pixel(j, i, c) / 3.0;
-			}
-			gray.Pixel(j, i, 0) = min((double)gray.MaxVal(), (double)val);
-		}
-	}	
+	// (B + G + R) / 3, computed in double and truncated (see ColorConvert.h)
+	ColorToGrayAverage(rgb, gray);
 }
 
 // Instantiate the templates
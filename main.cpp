@@ -3,16 +3,27 @@
 #include "SupportVectorMachine.h"
 #include "Feature.h"
 #include "PrecisionRecall.h"
+#include "DetectionEvaluation.h"
+#include "HardNegativeMining.h"
+#include <chrono>
+#include <random>
 
 void
 printUsage(const char* execName)
 {
 	printf("Usage:\n");
 	printf("\t%s TRAIN   <in:database> <feature type> <out:svm model>\n", execName);
-	printf("\t%s PRED    <in:database> <in:svm model> [<out:prcurve.pr>] [<out:database.preds>]\n", execName);
+	printf("\t%s TRAINGRAM <in:database> <feature type> <out:svm model> [<tmp:gram matrix file>]\n", execName);
+	printf("\t%s CV      <in:database> <feature type> <out:svm model> [<folds> [<C values, comma separated>]]\n", execName);
+	printf("\t%s TRAIN_MINE <in:database> <feature type> <in:negatives database> <out:svm model> [<rounds> [<hard example cache size>]]\n", execName);
+	printf("\t%s PRED    <in:database> <in:svm model> [<out:prcurve.pr>] [<out:database.preds>] [<bootstrap samples>]\n", execName);
+	printf("\t%s PREDACC <in:database> <in:svm model> <out:shard.pra>\n", execName);
+	printf("\t%s PRMERGE <out:prcurve.pr> <in:shard.pra> [<in:shard.pra> ...]\n", execName);
+	printf("\t%s DETEVAL <in:annotations> <in:detections> [<out:prcurve.pr>] [<iou threshold>]\n", execName);
 	printf("\t%s PREDSL  <in:image.jpg> <in:svm model> <out:scoreimg.tga>\n", execName);
 	printf("\t%s FEATVIZ <feature type> <in:img> <out:viz.tga>\n", execName);
 	printf("\t%s SVMVIZ  <in:svm model> <out:viz.tga>\n", execName);
+	printf("\t%s SVMBENCH [<vectors> [<dimensions> [<max threads>]]]\n", execName);
 }
 
 void
@@ -65,24 +76,12 @@ mainVizSVMModel(int argc, char** argv)
 	FeatureExtractor* featExtractor = FeatureExtractorNew(featureType.c_str());
 
 	Feature svmW = svm.getWeights();
-	svmW -= svm.getBiasTerm() / (svmW.Shape().width * svmW.Shape().height * svmW.Shape().nBands);
+	float shift = svm.getBiasTerm() / (svmW.Shape().width * svmW.Shape().height * svmW.Shape().nBands);
 
 	// Create two images, one for the positive weights and another
-	// one for the negative weights
-	Feature pos(svmW.Shape()), neg(svmW.Shape());
-	pos.ClearPixels();
-	neg.ClearPixels();
-
-	for(int y = 0; y < pos.Shape().height; y++) {
-		float* svmIt = (float*) svmW.PixelAddress(0, y, 0);
-		float* p = (float*) pos.PixelAddress(0, y, 0);
-		float* n = (float*) neg.PixelAddress(0, y, 0);
-
-		for(int x = 0; x < pos.Shape().width * pos.Shape().nBands; x++, p++, n++, svmIt++) {
-			if(*svmIt < 0) *n = fabs(*svmIt);
-			else if(*svmIt > 0) *p = *svmIt;
-		}
-	}
+	// one for the negative weights (of the weights shifted by the bias)
+	Feature pos = Max(0.0f, svmW - shift);
+	Feature neg = Max(0.0f, shift - svmW);
 
 	CByteImage negViz, posViz;
 	posViz = featExtractor->render(pos, true);
@@ -145,6 +144,24 @@ mainVizFeature(int argc, char** argv)
 	return EXIT_SUCCESS;
 }
 
+static double
+svmCacheHitRate(const svm_cache_stats& stats)
+{
+	long long requests = stats.hits + stats.misses;
+	return requests ? 100.0 * stats.hits / requests : 0;
+}
+
+// Kernel cache statistics of the training runs since the last call
+static void
+printSVMCacheStats()
+{
+	svm_cache_stats stats;
+	svm_get_cache_stats(&stats);
+	PRINT_MSG("Kernel cache: " << stats.columns << " columns (" << stats.size << " MB), "
+	          << stats.hits << " hits, " << stats.misses << " misses (hit rate "
+	          << svmCacheHitRate(stats) << "%), " << stats.evictions << " evictions");
+}
+
 int
 mainSVMTrain(int argc, char** argv)
 {
@@ -158,8 +175,59 @@ mainSVMTrain(int argc, char** argv)
 	const char* featureType = argv[3];
 	const char* svmModelFName = argv[4];
 
+	// TRAINGRAM computes the kernel matrix up front, in memory or in a file
+	bool gram = strcasecmp(argv[1], "TRAINGRAM") == 0;
+	const char* gramFName = (gram && argc >= 6)?argv[5]:NULL;
+
+	ImageDatabase db(dbFName);
+	std::cout << db << std::endl;
+
+	FeatureExtractor* featExtractor = FeatureExtractorNew(featureType);
+
+	PRINT_MSG("Extracting features");
+	FeatureSet features;
+	(*featExtractor)(db, features);
+
+	PRINT_MSG("Training SVM");
+	SupportVectorMachine svm;
+	if(gram) svm.trainGram(db.getLabels(), features, 0.01, 0, gramFName);
+	else svm.train(db.getLabels(), features);
+	printSVMCacheStats();
+
+	saveSVMModelAndFeatureType(svmModelFName, svm, featureType);
+
+	delete featExtractor;
+	return EXIT_SUCCESS;
+}
+
+static void
+svmPrintNothing(const char*)
+{
+}
+
+int
+mainSVMTrainMine(int argc, char** argv)
+{
+	if(argc < 6 || argc > 8) {
+		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* dbFName = argv[2];
+	const char* featureType = argv[3];
+	const char* negativesFName = argv[4];
+	const char* svmModelFName = argv[5];
+	int nRounds = (argc >= 7)?atoi(argv[6]):3;
+	int cacheSize = (argc >= 8)?atoi(argv[7]):10000;
+
+	// Windows scoring above -1 violate the margin of a negative example
+	const float margin = -1;
+	const double C = 0.01;
+
 	ImageDatabase db(dbFName);
 	std::cout << db << std::endl;
+	ImageDatabase negatives(negativesFName);
 
 	FeatureExtractor* featExtractor = FeatureExtractorNew(featureType);
 
@@ -169,7 +237,35 @@ mainSVMTrain(int argc, char** argv)
 
 	PRINT_MSG("Training SVM");
 	SupportVectorMachine svm;
-	svm.train(db.getLabels(), features);
+	svm.train(db.getLabels(), features, C);
+
+	// Every round retrains on the database and the hard examples, starting
+	// from the previous solution. The examples of the database keep their
+	// index, the hard examples theirs in the previous training set.
+	HardExampleCache cache(cacheSize);
+	for(int round = 1; round <= nRounds; round++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		cache.rescore(svm, margin);
+		int nKept = cache.size();
+		long long nHard;
+		long long nWindows = mineHardNegatives(svm, *featExtractor, negatives, margin, cache, nHard);
+		double miningSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<float> labels = db.getLabels();
+		FeatureSet trainSet = features;
+		std::vector<int> initIndex(labels.size());
+		for(int i = 0; i < (int) initIndex.size(); i++) initIndex[i] = i;
+		cache.appendTo(labels, trainSet, initIndex);
+
+		start = std::chrono::steady_clock::now();
+		svm.trainWarm(labels, trainSet, C, svm, initIndex);
+		double trainingSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		PRINT_MSG("Round " << round << ": " << nWindows << " windows scanned in " << miningSeconds << " s, "
+		          << nHard << " above the margin, " << nKept << " hard examples kept, " << cache.size()
+		          << " in the cache, retrained in " << trainingSeconds << " s");
+	}
+	printSVMCacheStats();
 
 	saveSVMModelAndFeatureType(svmModelFName, svm, featureType);
 
@@ -177,10 +273,214 @@ mainSVMTrain(int argc, char** argv)
 	return EXIT_SUCCESS;
 }
 
+// Comma separated C values, in increasing order
+static std::vector<double>
+parseCValues(const char* list)
+{
+	std::vector<double> values;
+	std::stringstream ss(list);
+	std::string item;
+	while(std::getline(ss, item, ',')) {
+		double C = atof(item.c_str());
+		if(C <= 0) throw CError("Invalid C value %s", item.c_str());
+		values.push_back(C);
+	}
+	std::sort(values.begin(), values.end());
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+	if(values.empty()) throw CError("No C values in %s", list);
+	return values;
+}
+
+int
+mainSVMCrossValidation(int argc, char** argv)
+{
+	if(argc < 5 || argc > 7) {
+		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* dbFName = argv[2];
+	const char* featureType = argv[3];
+	const char* svmModelFName = argv[4];
+	int nFolds = (argc >= 6)?atoi(argv[5]):5;
+	std::vector<double> cValues = parseCValues((argc >= 7)?argv[6]:"0.0001,0.001,0.01,0.1,1");
+	int nC = cValues.size();
+
+	ImageDatabase db(dbFName);
+	std::cout << db << std::endl;
+	const std::vector<float>& labels = db.getLabels();
+	int nVecs = labels.size();
+	if(nFolds < 2 || nFolds > nVecs) throw CError("Invalid number of folds %d", nFolds);
+
+	FeatureExtractor* featExtractor = FeatureExtractorNew(featureType);
+
+	PRINT_MSG("Extracting features");
+	FeatureSet features;
+	(*featExtractor)(db, features);
+
+	// Stratified folds: the positives and the negatives are shuffled
+	// separately, then dealt out to the folds in turn
+	std::vector<int> positives, negatives;
+	for(int i = 0; i < nVecs; i++) {
+		if(labels[i] > 0) positives.push_back(i);
+		else negatives.push_back(i);
+	}
+	std::mt19937 rng(1);
+	std::shuffle(positives.begin(), positives.end(), rng);
+	std::shuffle(negatives.begin(), negatives.end(), rng);
+	std::vector<int> fold(nVecs);
+	for(int k = 0; k < (int) positives.size(); k++) fold[positives[k]] = k % nFolds;
+	for(int k = 0; k < (int) negatives.size(); k++) fold[negatives[k]] = (positives.size() + k) % nFolds;
+
+	// Chain f < nFolds trains without fold f and tests on it, chain nFolds
+	// trains on everything. The chains run concurrently, each one through
+	// the C values in increasing order, every training warm started from
+	// the previous one.
+	PRINT_MSG("Cross validating " << nC << " C values on " << nFolds << " folds");
+	std::vector<std::vector<double> > ap(nFolds, std::vector<double>(nC));
+	std::vector<SupportVectorMachine> models(nC); // Trained on everything
+	svm_set_print_string_function(svmPrintNothing);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ParallelFor(0, nFolds + 1, [&](int begin, int end) {
+		for(int f = begin; f < end; f++) {
+			std::vector<float> trainLabels, testLabels;
+			FeatureSet trainSet, testSet;
+			for(int i = 0; i < nVecs; i++) {
+				if(fold[i] != f) {
+					trainLabels.push_back(labels[i]);
+					trainSet.push_back(features[i]);
+				} else {
+					testLabels.push_back(labels[i]);
+					testSet.push_back(features[i]);
+				}
+			}
+
+			SupportVectorMachine foldSvm;
+			for(int c = 0; c < nC; c++) {
+				SupportVectorMachine& svm = (f == nFolds) ? models[c] : foldSvm;
+				if(c == 0) svm.train(trainLabels, trainSet, cValues[c]);
+				else svm.trainWarm(trainLabels, trainSet, cValues[c], (f == nFolds) ? models[c - 1] : foldSvm);
+
+				if(f < nFolds) {
+					PrecisionRecall pr(testLabels, svm.predict(testSet));
+					ap[f][c] = pr.getAveragePrecision();
+				}
+			}
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	svm_set_print_string_function(NULL);
+	svm_cache_stats stats;
+	svm_get_cache_stats(&stats);
+
+	// Average precision per fold and C, the best mean wins
+	printf("%10s", "C");
+	for(int f = 0; f < nFolds; f++) printf("  fold %-3d", f);
+	printf("      mean\n");
+	int best = 0;
+	std::vector<double> meanAP(nC, 0);
+	for(int c = 0; c < nC; c++) {
+		printf("%10g", cValues[c]);
+		for(int f = 0; f < nFolds; f++) {
+			printf("  %8.5f", ap[f][c]);
+			meanAP[c] += ap[f][c] / nFolds;
+		}
+		printf("  %8.5f\n", meanAP[c]);
+		if(meanAP[c] > meanAP[best]) best = c;
+	}
+	PRINT_MSG((nFolds + 1) * nC << " trainings in " << seconds << " s (kernel cache hit rate "
+	          << svmCacheHitRate(stats) << "%)");
+	PRINT_MSG("Best C: " << cValues[best] << ", average precision " << meanAP[best]);
+
+	saveSVMModelAndFeatureType(svmModelFName, models[best], featureType);
+
+	delete featExtractor;
+	return EXIT_SUCCESS;
+}
+
+int
+mainSVMBenchmark(int argc, char** argv)
+{
+	int nVecs = (argc > 2) ? atoi(argv[2]) : 4000;
+	int dim = (argc > 3) ? atoi(argv[3]) : 1000;
+	int maxThreads = (argc > 4) ? atoi(argv[4]) : ParallelNumThreads();
+	if(nVecs < 2 || dim < 1 || maxThreads < 1) {
+		std::cerr << "ERROR: Invalid benchmark size\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	ParallelSetNumThreads(maxThreads);
+
+	// Synthetic dense problem: uniform noise, with the first tenth of
+	// the dimensions shifted for the positive vectors
+	PRINT_MSG("Training on " << nVecs << " random vectors of " << dim << " dimensions");
+	srand(1);
+	std::vector<float> labels(nVecs);
+	FeatureSet features(nVecs);
+	for(int i = 0; i < nVecs; i++) {
+		labels[i] = (i % 2) ? 1 : -1;
+		features[i] = Feature(dim, 1, 1);
+		float* v = (float*) features[i].PixelAddress(0, 0, 0);
+		for(int k = 0; k < dim; k++) {
+			v[k] = rand() / (float) RAND_MAX + ((labels[i] > 0 && k < dim / 10) ? 0.1f : 0.0f);
+		}
+	}
+
+	svm_set_print_string_function(svmPrintNothing);
+	Feature weights1;
+	double seconds1 = 0;
+	for(int nThreads = 1; ; nThreads = std::min(2 * nThreads, maxThreads)) {
+		SupportVectorMachine svm;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		svm.train(labels, features, 0.01, nThreads);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		svm_cache_stats stats;
+		svm_get_cache_stats(&stats);
+
+		// The results must not depend on the number of threads
+		Feature weights = svm.getWeights();
+		if(nThreads == 1) {
+			weights1 = weights;
+			seconds1 = seconds;
+		}
+		float maxDiff = 0;
+		for(int k = 0; k < dim; k++) {
+			maxDiff = std::max(maxDiff, fabsf(weights.Pixel(k, 0, 0) - weights1.Pixel(k, 0, 0)));
+		}
+		printf("%3d threads: %8.3f s, speedup %5.2f, weight difference %g, cache hit rate %.1f%%\n",
+		       nThreads, seconds, seconds1 / seconds, maxDiff, svmCacheHitRate(stats));
+
+		if(nThreads == maxThreads) break;
+	}
+
+	// Same problem on the precomputed kernel matrix (with float kernel
+	// values, so the weights differ slightly)
+	{
+		SupportVectorMachine svm;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		svm.trainGram(labels, features, 0.01, maxThreads);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		svm_cache_stats stats;
+		svm_get_cache_stats(&stats);
+
+		Feature weights = svm.getWeights();
+		float maxDiff = 0;
+		for(int k = 0; k < dim; k++) {
+			maxDiff = std::max(maxDiff, fabsf(weights.Pixel(k, 0, 0) - weights1.Pixel(k, 0, 0)));
+		}
+		printf("Gram matrix, %3d threads: %8.3f s, speedup %5.2f, weight difference %g\n",
+		       maxThreads, seconds, seconds1 / seconds, maxDiff);
+	}
+	svm_set_print_string_function(NULL);
+
+	return EXIT_SUCCESS;
+}
+
 int
 mainSVMPredict(int argc, char** argv)
 {
-	if(argc < 3 || argc > 6) {
+	if(argc < 3 || argc > 7) {
 		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
 		printUsage(argv[0]);
 		return EXIT_FAILURE;
@@ -190,6 +490,7 @@ mainSVMPredict(int argc, char** argv)
 	const char* svmModelFName = argv[3];
 	const char* prFName = (argc >= 4)?argv[4]:NULL;
 	const char* predsFName = (argc >= 5)?argv[5]:NULL;
+	int nBootstrap = (argc >= 7)?atoi(argv[6]):0;
 
 	std::string featureType;
 
@@ -212,6 +513,12 @@ mainSVMPredict(int argc, char** argv)
 	PrecisionRecall pr(db.getLabels(), preds);
 	PRINT_MSG("Average precision: " << pr.getAveragePrecision());
 
+	if(nBootstrap > 0) {
+		double apLow, apHigh;
+		PrecisionRecall::bootstrapAveragePrecision(db.getLabels(), preds, nBootstrap, 0.95, apLow, apHigh);
+		PRINT_MSG("95% confidence interval: [" << apLow << ", " << apHigh << "]");
+	}
+
 	if(prFName != NULL) pr.save(prFName);
 	if(predsFName != NULL) {
 		ImageDatabase predsDb(preds, db.getFilenames());
@@ -221,6 +528,100 @@ mainSVMPredict(int argc, char** argv)
 	return EXIT_SUCCESS;
 }
 
+int
+mainSVMPredictAccumulate(int argc, char** argv)
+{
+	if(argc < 5) {
+		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* dbFName = argv[2];
+	const char* svmModelFName = argv[3];
+	const char* accFName = argv[4];
+
+	std::string featureType;
+
+	ImageDatabase db(dbFName);
+	std::cout << db << std::endl;
+
+	PRINT_MSG("Loading model from file");
+	SupportVectorMachine svm;
+	loadSVMModelAndFeatureType(svmModelFName, svm, featureType);
+
+	PRINT_MSG("Extracting features");
+	FeatureExtractor* featExtractor = FeatureExtractorNew(featureType.c_str());
+	FeatureSet features;
+	(*featExtractor)(db, features);
+
+	PRINT_MSG("Predicting");
+	std::vector<float> preds = svm.predict(features);
+
+	PrecisionRecallAccumulator acc;
+	acc.add(db.getLabels(), preds);
+	acc.save(accFName);
+
+	delete featExtractor;
+	return EXIT_SUCCESS;
+}
+
+int
+mainMergePrecisionRecall(int argc, char** argv)
+{
+	if(argc < 4) {
+		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* prFName = argv[2];
+
+	PrecisionRecallAccumulator acc;
+	acc.load(argv[3]);
+	for(int i = 4; i < argc; i++) {
+		PrecisionRecallAccumulator shard;
+		shard.load(argv[i]);
+		acc.merge(shard);
+	}
+	PRINT_MSG("Merged " << acc.getCount() << " predictions");
+
+	PrecisionRecall pr(acc);
+	PRINT_MSG("Average precision: " << pr.getAveragePrecision());
+	pr.save(prFName);
+
+	return EXIT_SUCCESS;
+}
+
+int
+mainEvaluateDetections(int argc, char** argv)
+{
+	if(argc < 4 || argc > 6) {
+		std::cerr << "ERROR: Incorrect number of arguments\n" << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* annotationsFName = argv[2];
+	const char* detectionsFName = argv[3];
+	const char* prFName = (argc >= 5)?argv[4]:NULL;
+	float iouThreshold = (argc >= 6)?atof(argv[5]):0.5f;
+
+	BoxAnnotations gt(annotationsFName);
+	PRINT_MSG("Ground truth boxes: " << gt.getBoxesCount() << " in " << gt.getSize() << " images");
+
+	std::vector<Detection> detections = loadDetections(detectionsFName);
+	PRINT_MSG("Detections: " << detections.size());
+
+	PRINT_MSG("Computing Precision Recall Curve");
+	PrecisionRecall pr = evaluateDetections(gt, detections, iouThreshold);
+	PRINT_MSG("Average precision: " << pr.getAveragePrecision());
+
+	if(prFName != NULL) pr.save(prFName);
+
+	return EXIT_SUCCESS;
+}
+
 int
 mainSVMPredictSlidinbWindow(int argc, char** argv)
 {
@@ -258,15 +659,11 @@ mainSVMPredictSlidinbWindow(int argc, char** argv)
 	scoreMin = 0;
 	PRINT_EXPR(scoreMin);
 	PRINT_EXPR(scoreMax);
-	scoreImg -= scoreMin;
-	scoreImg /= (scoreMax - scoreMin);
+	scoreImg = (scoreImg - scoreMin) / (scoreMax - scoreMin);
 
 	// Composite score on top of original image
-	CTransform3x3 s = CTransform3x3::Scale( double(scoreImg.Shape().width) / img.Shape().width, 
-	                                        double(scoreImg.Shape().height) / img.Shape().height );
-
 	CFloatImage scoreScaled(img.Shape().width, img.Shape().height, 1);
-	WarpGlobal(scoreImg, scoreScaled, s, eWarpInterpNearest);
+	Resize(scoreImg, scoreScaled, eResizeBox);
 
 	CFloatImage overlayImg(img.Shape().width, img.Shape().height, 3);
 	overlayImg.ClearPixels();
@@ -300,16 +697,28 @@ main(int argc, char **argv)
 			printUsage(argv[0]);
 			return EXIT_FAILURE;
 		} else {
-			if (strcasecmp(argv[1], "TRAIN") == 0) {
+			if (strcasecmp(argv[1], "TRAIN") == 0 || strcasecmp(argv[1], "TRAINGRAM") == 0) {
 				return mainSVMTrain(argc, argv);
+			} else if (strcasecmp(argv[1], "TRAIN_MINE") == 0) {
+				return mainSVMTrainMine(argc, argv);
+			} else if (strcasecmp(argv[1], "CV") == 0) {
+				return mainSVMCrossValidation(argc, argv);
 			} else if (strcasecmp(argv[1], "PRED") == 0) {
 				return mainSVMPredict(argc, argv);
+			} else if (strcasecmp(argv[1], "PREDACC") == 0) {
+				return mainSVMPredictAccumulate(argc, argv);
+			} else if (strcasecmp(argv[1], "PRMERGE") == 0) {
+				return mainMergePrecisionRecall(argc, argv);
+			} else if (strcasecmp(argv[1], "DETEVAL") == 0) {
+				return mainEvaluateDetections(argc, argv);
 			} else if (strcasecmp(argv[1], "PREDSL") == 0) {
 				return mainSVMPredictSlidinbWindow(argc, argv);
 			} else if (strcasecmp(argv[1], "FEATVIZ") == 0) {
 				return mainVizFeature(argc, argv);
 			} else if (strcasecmp(argv[1], "SVMVIZ") == 0) {
 				return mainVizSVMModel(argc, argv);
+			} else if (strcasecmp(argv[1], "SVMBENCH") == 0) {
+				return mainSVMBenchmark(argc, argv);
 			} else {
 				printUsage(argv[0]);
 				system("PAUSE");
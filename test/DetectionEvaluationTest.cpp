@@ -0,0 +1,184 @@
+// Checks matchDetections: duplicate detections of a box, detections in
+// images without annotations, the IoU threshold boundary and, on images
+// with many boxes, that the BoxGrid lookup finds the same matches as
+// comparing every detection with every box. Annotations go through
+// BoxAnnotations::load, which must also reject an image listed twice.
+// Returns non-zero if any check fails.
+
+#include "DetectionEvaluation.h"
+#include <cstdio>
+#include <random>
+
+static const char* annotationsFName = "detection_evaluation_test.ann";
+
+static int nChecks = 0, nFailed = 0;
+
+static void
+check(bool ok, const char* what)
+{
+	nChecks++;
+	if(!ok) {
+		printf("FAILED: %s\n", what);
+		nFailed++;
+	}
+}
+
+static BoxAnnotations
+annotations(const std::vector<std::string>& filenames, const std::vector<std::vector<BoundingBox> >& boxes)
+{
+	std::ofstream f(annotationsFName);
+	f << filenames.size() << "\n";
+	for(int i = 0; i < filenames.size(); i++) {
+		f << filenames[i] << " " << boxes[i].size();
+		for(int b = 0; b < boxes[i].size(); b++) {
+			f << " " << boxes[i][b].x << " " << boxes[i][b].y << " " << boxes[i][b].width << " " << boxes[i][b].height;
+		}
+		f << "\n";
+	}
+	f.close();
+
+	return BoxAnnotations(annotationsFName);
+}
+
+static Detection
+detection(const char* filename, float score, const BoundingBox& box)
+{
+	Detection d;
+	d.filename = filename;
+	d.score = score;
+	d.box = box;
+	return d;
+}
+
+// Matches detections as the header describes, comparing each one with every box
+static std::vector<char>
+bruteForceMatch(const BoxAnnotations& gt, const std::vector<Detection>& detections, float iouThreshold)
+{
+	std::vector<char> isTruePos(detections.size(), 0);
+	for(int i = 0; i < gt.getSize(); i++) {
+		const std::vector<BoundingBox>& boxes = gt.getBoxes(i);
+		std::vector<int> dets;
+		for(int d = 0; d < detections.size(); d++) {
+			if(detections[d].filename == gt.getFilename(i)) dets.push_back(d);
+		}
+		std::stable_sort(dets.begin(), dets.end(), [&detections](int a, int b) {
+			return detections[a].score > detections[b].score;
+		});
+
+		std::vector<char> matched(boxes.size(), 0);
+		for(int k = 0; k < dets.size(); k++) {
+			float bestIoU = 0;
+			int best = -1;
+			for(int b = 0; b < boxes.size(); b++) {
+				float iou = intersectionOverUnion(detections[dets[k]].box, boxes[b]);
+				if(iou > bestIoU) {
+					bestIoU = iou;
+					best = b;
+				}
+			}
+			if(best >= 0 && bestIoU >= iouThreshold && !matched[best]) {
+				matched[best] = 1;
+				isTruePos[dets[k]] = 1;
+			}
+		}
+	}
+	return isTruePos;
+}
+
+static void
+testSmallCases()
+{
+	std::vector<std::string> filenames = { "a.jpg", "b.jpg", "empty.jpg" };
+	std::vector<std::vector<BoundingBox> > boxes(3);
+	boxes[0].push_back(BoundingBox(0, 0, 10, 10));
+	boxes[0].push_back(BoundingBox(100, 0, 10, 10));
+	boxes[1].push_back(BoundingBox(0, 0, 10, 10));
+	BoxAnnotations gt = annotations(filenames, boxes);
+
+	std::vector<Detection> dets;
+	dets.push_back(detection("a.jpg", 0.5f, BoundingBox(1, 0, 10, 10)));     // second on box 0
+	dets.push_back(detection("a.jpg", 0.9f, BoundingBox(0, 0, 10, 10)));     // first on box 0
+	dets.push_back(detection("a.jpg", 0.1f, BoundingBox(100, 0, 10, 5)));    // IoU exactly 0.5
+	dets.push_back(detection("b.jpg", 0.8f, BoundingBox(0, 0, 10, 4.75f)));  // IoU 0.475
+	dets.push_back(detection("c.jpg", 0.7f, BoundingBox(0, 0, 10, 10)));     // not annotated
+	dets.push_back(detection("empty.jpg", 0.6f, BoundingBox(0, 0, 10, 10))); // no boxes
+
+	std::vector<char> tp = matchDetections(gt, dets, 0.5f);
+	check(tp[1] == 1, "highest scoring detection of a box is a true positive");
+	check(tp[0] == 0, "second detection of a matched box is a false positive");
+	check(tp[2] == 1, "IoU equal to the threshold is a true positive");
+	check(tp[3] == 0, "IoU below the threshold is a false positive");
+	check(tp[4] == 0, "detection in an image without annotations is a false positive");
+	check(tp[5] == 0, "detection in an image without boxes is a false positive");
+
+	std::vector<char> tp4 = matchDetections(gt, dets, 0.475f);
+	check(tp4[3] == 1, "lowering the threshold to the IoU makes a true positive");
+	check(evaluateDetections(gt, dets, 0.5f).getAveragePrecision() < 1, "average precision counts the false positives");
+}
+
+static void
+testGridLookup()
+{
+	std::mt19937 generator(28);
+	std::uniform_real_distribution<float> pos(0, 1000), size(5, 60), jitter(-8, 8), big(100, 600);
+
+	std::vector<std::string> filenames;
+	std::vector<std::vector<BoundingBox> > boxes;
+	std::vector<Detection> dets;
+	for(int i = 0; i < 20; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "img%02d.jpg", i);
+		filenames.push_back(name);
+		boxes.push_back(std::vector<BoundingBox>());
+		for(int b = 0; b < 300; b++) {
+			BoundingBox box(pos(generator), pos(generator), size(generator), size(generator));
+			boxes.back().push_back(box);
+
+			// A few detections near each box and some anywhere, large ones too
+			for(int k = 0; k < 2; k++) {
+				BoundingBox near(box.x + jitter(generator), box.y + jitter(generator),
+				                 box.width + jitter(generator) / 2, box.height + jitter(generator) / 2);
+				dets.push_back(detection(name, generator() / 4294967296.0f, near));
+			}
+			if(b % 10 == 0) {
+				BoundingBox far(pos(generator), pos(generator), big(generator), big(generator));
+				dets.push_back(detection(name, generator() / 4294967296.0f, far));
+			}
+		}
+	}
+	BoxAnnotations gt = annotations(filenames, boxes);
+
+	const float thresholds[] = { 0.1f, 0.5f, 0.7f };
+	for(int t = 0; t < 3; t++) {
+		std::vector<char> tp = matchDetections(gt, dets, thresholds[t]);
+		std::vector<char> ref = bruteForceMatch(gt, dets, thresholds[t]);
+		check(tp == ref, "grid lookup matches the brute force matching");
+		check(std::count(tp.begin(), tp.end(), 1) > 0, "grid lookup finds true positives");
+	}
+}
+
+static void
+testDuplicateImages()
+{
+	std::vector<std::string> filenames = { "a.jpg", "b.jpg", "a.jpg" };
+	std::vector<std::vector<BoundingBox> > boxes(3, std::vector<BoundingBox>(1, BoundingBox(0, 0, 10, 10)));
+	bool rejected = false;
+	try {
+		annotations(filenames, boxes);
+	} catch(CError&) {
+		rejected = true;
+	}
+	check(rejected, "annotations listing an image twice are rejected");
+}
+
+int
+main(void)
+{
+	testSmallCases();
+	testGridLookup();
+	testDuplicateImages();
+	remove(annotationsFName);
+
+	printf("%d of %d checks passed\n", nChecks - nFailed, nChecks);
+	return nFailed > 0;
+}
@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ColorConvert.cpp -- vectorized color conversions (gray, band order, alpha)
+//
+// DESIGN NOTES
+//  The gray and alpha kernels are templated on the number of source
+//  bands, so that the compiler sees constant strides and can vectorize
+//  the interleaved loads; the exported functions only dispatch on it.
+//  Band reordering and alpha stripping are plain band maps, so they are
+//  handed to ConvertLineBands, which already has loops for those layouts.
+//
+//  The float gray kernels evaluate w.r * R + w.g * G + w.b * B in that
+//  order, and the average kernels add B / 3.0, G / 3.0, R / 3.0 to 0.0,
+//  which keeps them bit-identical to the scalar code in ConvertToGray and
+//  convertRGB2GrayImage (including the way NaNs come out).
+//
+// SEE ALSO
+//  ColorConvert.h      longer description
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "ColorConvert.h"
+#include "ConvertLine.h"
+#include "Vectorize.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+namespace {
+
+struct CFixedWeights
+{
+    int r, g, b;
+};
+
+CFixedWeights FixedWeights(const CGrayWeights& w)
+{
+    // Larger weights could overflow the 32 bit sums
+    const float maxWeight = 64.0f;
+    if (! (fabsf(w.r) <= maxWeight && fabsf(w.g) <= maxWeight && fabsf(w.b) <= maxWeight))
+        throw CError("ColorToGray: gray weights must not exceed %d in magnitude", (int) maxWeight);
+
+    const float one = (float) (1 << grayFixedBits);
+    CFixedWeights f;
+    f.r = (int) lrintf(w.r * one);
+    f.g = (int) lrintf(w.g * one);
+    f.b = (int) lrintf(w.b * one);
+
+    // Give the rounding error of the sum to the largest weight
+    int err = (int) lrintf((w.r + w.g + w.b) * one) - (f.r + f.g + f.b);
+    int *largest = (abs(f.g) >= abs(f.r) && abs(f.g) >= abs(f.b)) ? &f.g :
+                   (abs(f.r) >= abs(f.b)) ? &f.r : &f.b;
+    *largest += err;
+    return f;
+}
+
+template <int SB>
+IMAGELIB_INLINE void GrayFixedRun(const uchar* __restrict src, uchar* __restrict dst, int n,
+                                  CFixedWeights w)
+{
+    const int half = 1 << (grayFixedBits - 1);
+    for (int x = 0; x < n; x++, src += SB)
+    {
+        int Y = (w.r * src[2] + w.g * src[1] + w.b * src[0] + half) >> grayFixedBits;
+        dst[x] = (uchar) __min(__max(Y, 0), 255);
+    }
+}
+
+template <int SB, class T>
+IMAGELIB_INLINE void GrayFloatRun(const T* __restrict src, float* __restrict dst, int n,
+                                  CGrayWeights w)
+{
+    const float minVal = -FLT_MAX, maxVal = FLT_MAX;
+    for (int x = 0; x < n; x++, src += SB)
+    {
+        float Y = w.r * src[2] + w.g * src[1] + w.b * src[0];
+        dst[x] = __min(maxVal, __max(minVal, Y));
+    }
+}
+
+template <int SB, class T>
+IMAGELIB_INLINE void AverageRun(const T* __restrict src, T* __restrict dst, int n, double maxVal)
+{
+    for (int x = 0; x < n; x++, src += SB)
+    {
+        double val = 0.0;
+        val += src[0] / 3.0;
+        val += src[1] / 3.0;
+        val += src[2] / 3.0;
+        dst[x] = (T) ((val < maxVal) ? val : maxVal);
+    }
+}
+
+template <int SB, class T>
+IMAGELIB_INLINE void InsertAlphaRun(const T* __restrict src, T* __restrict dst, int n, T alpha)
+{
+    for (int x = 0; x < n; x++, src += SB, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[SB > 1];
+        dst[2] = src[2 * (SB > 1)];
+        dst[3] = alpha;
+    }
+}
+
+void CheckColorBands(const char* fn, int nBands)
+{
+    if (nBands != 3 && nBands != 4)
+        throw CError("%s: source must have 3 or 4 bands, not %d", fn, nBands);
+}
+
+template <class T>
+void SwapRedBlueAny(const T* src, int nBands, T* dst, int n)
+{
+    static const int bandMap[4] = {2, 1, 0, 3};
+    static const int identity[1] = {0};
+    if (nBands != 1 && nBands != 3 && nBands != 4)
+        throw CError("SwapRedBlue: source must have 1, 3 or 4 bands, not %d", nBands);
+    ConvertLineBands(src, nBands, dst, nBands, (nBands == 1) ? identity : bandMap,
+                     n, 1.0f, 0.0f, T(0), T(0));
+}
+
+template <class T>
+void StripAlphaAny(const T* src, T* dst, int n)
+{
+    static const int bandMap[3] = {0, 1, 2};
+    ConvertLineBands(src, 4, dst, 3, bandMap, n, 1.0f, 0.0f, T(0), T(0));
+}
+
+// Gives dst the requested shape, and memory of its own if it shares the
+// pixels of src.  Returns a handle on the source pixels, which stays valid
+// even if dst is src.
+template <class T>
+CImageOf<T> PrepareDestination(const CImageOf<T>& src, CImageOf<T>& dst, CShape shape)
+{
+    CImageOf<T> s = src;
+    bool shared = dst.Shape() == shape && shape.width > 0 && shape.height > 0 &&
+                  dst.PixelAddress(0, 0, 0) == s.PixelAddress(0, 0, 0);
+    dst.ReAllocate(shape, shared);
+    return s;
+}
+
+}
+
+//
+// Line kernels
+//
+
+IMAGELIB_TARGET_CLONES
+void ColorToGrayLine(const uchar* src, int srcBands, uchar* dst, int n, const CGrayWeights& weights)
+{
+    CheckColorBands("ColorToGrayLine", srcBands);
+    CFixedWeights w = FixedWeights(weights);
+    if (srcBands == 3)
+        GrayFixedRun<3>(src, dst, n, w);
+    else
+        GrayFixedRun<4>(src, dst, n, w);
+}
+
+IMAGELIB_TARGET_CLONES
+void ColorToGrayLine(const uchar* src, int srcBands, float* dst, int n, const CGrayWeights& weights)
+{
+    CheckColorBands("ColorToGrayLine", srcBands);
+    if (srcBands == 3)
+        GrayFloatRun<3>(src, dst, n, weights);
+    else
+        GrayFloatRun<4>(src, dst, n, weights);
+}
+
+IMAGELIB_TARGET_CLONES
+void ColorToGrayLine(const float* src, int srcBands, float* dst, int n, const CGrayWeights& weights)
+{
+    CheckColorBands("ColorToGrayLine", srcBands);
+    if (srcBands == 3)
+        GrayFloatRun<3>(src, dst, n, weights);
+    else
+        GrayFloatRun<4>(src, dst, n, weights);
+}
+
+IMAGELIB_TARGET_CLONES
+void ColorAverageLine(const uchar* src, int srcBands, uchar* dst, int n)
+{
+    CheckColorBands("ColorAverageLine", srcBands);
+    if (srcBands == 3)
+        AverageRun<3>(src, dst, n, 255.0);
+    else
+        AverageRun<4>(src, dst, n, 255.0);
+}
+
+IMAGELIB_TARGET_CLONES
+void ColorAverageLine(const float* src, int srcBands, float* dst, int n)
+{
+    CheckColorBands("ColorAverageLine", srcBands);
+    if (srcBands == 3)
+        AverageRun<3>(src, dst, n, (double) FLT_MAX);
+    else
+        AverageRun<4>(src, dst, n, (double) FLT_MAX);
+}
+
+void SwapRedBlueLine(const uchar* src, int nBands, uchar* dst, int n)
+{
+    SwapRedBlueAny(src, nBands, dst, n);
+}
+
+void SwapRedBlueLine(const float* src, int nBands, float* dst, int n)
+{
+    SwapRedBlueAny(src, nBands, dst, n);
+}
+
+void StripAlphaLine(const uchar* src, uchar* dst, int n)
+{
+    StripAlphaAny(src, dst, n);
+}
+
+void StripAlphaLine(const float* src, float* dst, int n)
+{
+    StripAlphaAny(src, dst, n);
+}
+
+IMAGELIB_TARGET_CLONES
+void InsertAlphaLine(const uchar* src, int srcBands, uchar* dst, int n, uchar alpha)
+{
+    if (srcBands == 1)
+        InsertAlphaRun<1>(src, dst, n, alpha);
+    else if (srcBands == 3)
+        InsertAlphaRun<3>(src, dst, n, alpha);
+    else
+        throw CError("InsertAlphaLine: source must have 1 or 3 bands, not %d", srcBands);
+}
+
+IMAGELIB_TARGET_CLONES
+void InsertAlphaLine(const float* src, int srcBands, float* dst, int n, float alpha)
+{
+    if (srcBands == 1)
+        InsertAlphaRun<1>(src, dst, n, alpha);
+    else if (srcBands == 3)
+        InsertAlphaRun<3>(src, dst, n, alpha);
+    else
+        throw CError("InsertAlphaLine: source must have 1 or 3 bands, not %d", srcBands);
+}
+
+//
+// Image routines
+//
+
+template <class T>
+void ColorToGray(const CImageOf<T>& src, CImageOf<T>& dst, const CGrayWeights& weights)
+{
+    CShape sShape = src.Shape();
+    if (sShape.nBands == 1)
+    {
+        dst = src;
+        return;
+    }
+    CheckColorBands("ColorToGray", sShape.nBands);
+    CImageOf<T> s = PrepareDestination(src, dst, CShape(sShape.width, sShape.height, 1));
+
+    for (int y = 0; y < sShape.height; y++)
+        ColorToGrayLine(&s.Pixel(0, y, 0), sShape.nBands, &dst.Pixel(0, y, 0),
+                        sShape.width, weights);
+}
+
+template <class T>
+void ColorToGrayAverage(const CImageOf<T>& src, CImageOf<T>& dst)
+{
+    CShape sShape = src.Shape();
+    if (sShape.nBands == 1)
+    {
+        dst = src;
+        return;
+    }
+    CheckColorBands("ColorToGrayAverage", sShape.nBands);
+    CImageOf<T> s = PrepareDestination(src, dst, CShape(sShape.width, sShape.height, 1));
+
+    for (int y = 0; y < sShape.height; y++)
+        ColorAverageLine(&s.Pixel(0, y, 0), sShape.nBands, &dst.Pixel(0, y, 0),
+                         sShape.width);
+}
+
+template <class T>
+void SwapRedBlue(const CImageOf<T>& src, CImageOf<T>& dst)
+{
+    CShape sShape = src.Shape();
+    CImageOf<T> s = PrepareDestination(src, dst, sShape);
+
+    for (int y = 0; y < sShape.height; y++)
+        SwapRedBlueLine(&s.Pixel(0, y, 0), sShape.nBands, &dst.Pixel(0, y, 0),
+                        sShape.width);
+}
+
+template <class T>
+void StripAlpha(const CImageOf<T>& src, CImageOf<T>& dst)
+{
+    CShape sShape = src.Shape();
+    if (sShape.nBands != 4)
+        throw CError("StripAlpha: source must have 4 bands, not %d", sShape.nBands);
+    CImageOf<T> s = PrepareDestination(src, dst, CShape(sShape.width, sShape.height, 3));
+
+    for (int y = 0; y < sShape.height; y++)
+        StripAlphaLine(&s.Pixel(0, y, 0), &dst.Pixel(0, y, 0), sShape.width);
+}
+
+template <class T>
+void InsertAlpha(const CImageOf<T>& src, CImageOf<T>& dst, T alpha)
+{
+    CShape sShape = src.Shape();
+    if (sShape.nBands != 1 && sShape.nBands != 3)
+        throw CError("InsertAlpha: source must have 1 or 3 bands, not %d", sShape.nBands);
+    CImageOf<T> s = PrepareDestination(src, dst, CShape(sShape.width, sShape.height, 4));
+    dst.alphaChannel = 3;
+
+    for (int y = 0; y < sShape.height; y++)
+        InsertAlphaLine(&s.Pixel(0, y, 0), sShape.nBands, &dst.Pixel(0, y, 0),
+                        sShape.width, alpha);
+}
+
+template void ColorToGray<>(const CByteImage& src, CByteImage& dst, const CGrayWeights& weights);
+template void ColorToGray<>(const CFloatImage& src, CFloatImage& dst, const CGrayWeights& weights);
+template void ColorToGrayAverage<>(const CByteImage& src, CByteImage& dst);
+template void ColorToGrayAverage<>(const CFloatImage& src, CFloatImage& dst);
+template void SwapRedBlue<>(const CByteImage& src, CByteImage& dst);
+template void SwapRedBlue<>(const CFloatImage& src, CFloatImage& dst);
+template void StripAlpha<>(const CByteImage& src, CByteImage& dst);
+template void StripAlpha<>(const CFloatImage& src, CFloatImage& dst);
+template void InsertAlpha<>(const CByteImage& src, CByteImage& dst, uchar alpha);
+template void InsertAlpha<>(const CFloatImage& src, CFloatImage& dst, float alpha);
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ColorConvert.h -- vectorized color conversions (gray, band order, alpha)
+//
+// SPECIFICATION
+//  void ColorToGray(const CImageOf<T>& src, CImageOf<T>& dst,
+//                   const CGrayWeights& weights = grayWeightsLuminance);
+//  void ColorToGrayAverage(const CImageOf<T>& src, CImageOf<T>& dst);
+//  void SwapRedBlue(const CImageOf<T>& src, CImageOf<T>& dst);
+//  void StripAlpha(const CImageOf<T>& src, CImageOf<T>& dst);
+//  void InsertAlpha(const CImageOf<T>& src, CImageOf<T>& dst, T alpha);
+//
+//  void ColorToGrayLine(const T1* src, int srcBands, T2* dst, int n,
+//                       const CGrayWeights& weights);
+//  void ColorAverageLine(const T* src, int srcBands, T* dst, int n);
+//  void SwapRedBlueLine(const T* src, int nBands, T* dst, int n);
+//  void StripAlphaLine(const T* src, T* dst, int n);
+//  void InsertAlphaLine(const T* src, int srcBands, T* dst, int n, T alpha);
+//
+// PARAMETERS
+//  src, dst            source and destination images (or pixel rows)
+//  weights             contribution of the R, G and B bands to gray
+//  alpha               value of the inserted alpha band
+//  srcBands, nBands    number of interleaved bands in src (see below)
+//  n                   number of pixels in a row
+//
+// DESCRIPTION
+//  Color images use ImageLib's band order (B, G, R and optionally A, see
+//  RGBA<T> in Image.h).  All routines are defined for uchar and float
+//  pixels.  dst is (re)allocated to the shape of the result; if it is src,
+//  or shares its pixels, it gets memory of its own first.
+//
+//  ColorToGray computes Y = w.r * R + w.g * G + w.b * B, ignoring the
+//  alpha band of 4-band images (1-band images are already gray and are
+//  just shared).  uchar pixels use 14 bit fixed-point weights and are
+//  rounded to the nearest value; the weights are adjusted so that they
+//  add up to the same total as the float weights (i.e., for weights that
+//  sum to 1, a gray pixel stays exactly the same).  float pixels are
+//  computed in float and clipped to [-FLT_MAX, FLT_MAX].
+//
+//  ColorToGrayAverage computes B / 3.0 + G / 3.0 + R / 3.0 in double
+//  precision and truncates the result, which is bit for bit what
+//  convertRGB2GrayImage in the object detector computed for 3-band
+//  images.  Other band counts are handled differently: a 1-band image is
+//  now shared as is (convertRGB2GrayImage returned val / 3), and the alpha
+//  band of a 4-band image is ignored (convertRGB2GrayImage added A / 3.0
+//  to the sum), and 2 or more than 4 bands throw a CError.
+//
+//  SwapRedBlue converts between BGR(A) and RGB(A) (the order used by
+//  image files such as JPEG), StripAlpha turns BGRA into BGR, and
+//  InsertAlpha turns a BGR or gray image into BGRA.
+//
+//  The ...Line routines are the kernels behind the image routines (and
+//  behind ConvertToGray and ConvertToRGBA in Convert.h).  Like the ones
+//  in ConvertLine.h, they are auto-vectorized and compiled for several
+//  instruction sets (see Vectorize.h).  The gray kernels accept 3 or 4
+//  band sources, SwapRedBlueLine 1, 3 or 4 bands, and InsertAlphaLine 1
+//  or 3 bands.  The uchar to float gray kernel is the exact float
+//  arithmetic of ConvertToGray, for callers that need it unrounded.
+//
+// SEE ALSO
+//  ColorConvert.cpp    implementation
+//  ConvertLine.h       pixel type conversion kernels
+//  Convert.h           ConvertToGray, ConvertToRGBA, ScaleAndOffsetBands
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef COLOR_CONVERT_H
+#define COLOR_CONVERT_H
+
+struct CGrayWeights
+{
+    float r, g, b;          // weights of the R, G and B bands
+};
+
+// Rec. 709 luminance, as used by ConvertToGray
+static const CGrayWeights grayWeightsLuminance = {0.212671f, 0.715160f, 0.072169f};
+
+// Plain average of the three color bands
+static const CGrayWeights grayWeightsAverage = {1/3.0f, 1/3.0f, 1/3.0f};
+
+static const int grayFixedBits = 14;    // fractional bits of the uchar weights
+
+template <class T>
+void ColorToGray(const CImageOf<T>& src, CImageOf<T>& dst,
+                 const CGrayWeights& weights = grayWeightsLuminance);
+
+template <class T>
+void ColorToGrayAverage(const CImageOf<T>& src, CImageOf<T>& dst);
+
+template <class T>
+void SwapRedBlue(const CImageOf<T>& src, CImageOf<T>& dst);
+
+template <class T>
+void StripAlpha(const CImageOf<T>& src, CImageOf<T>& dst);
+
+template <class T>
+void InsertAlpha(const CImageOf<T>& src, CImageOf<T>& dst, T alpha);
+
+void ColorToGrayLine(const uchar* src, int srcBands, uchar* dst, int n, const CGrayWeights& weights);
+void ColorToGrayLine(const uchar* src, int srcBands, float* dst, int n, const CGrayWeights& weights);
+void ColorToGrayLine(const float* src, int srcBands, float* dst, int n, const CGrayWeights& weights);
+
+void ColorAverageLine(const uchar* src, int srcBands, uchar* dst, int n);
+void ColorAverageLine(const float* src, int srcBands, float* dst, int n);
+
+void SwapRedBlueLine(const uchar* src, int nBands, uchar* dst, int n);
+void SwapRedBlueLine(const float* src, int nBands, float* dst, int n);
+
+void StripAlphaLine(const uchar* src, uchar* dst, int n);
+void StripAlphaLine(const float* src, float* dst, int n);
+
+void InsertAlphaLine(const uchar* src, int srcBands, uchar* dst, int n, uchar alpha);
+void InsertAlphaLine(const float* src, int srcBands, float* dst, int n, float alpha);
+
+#endif // COLOR_CONVERT_H
@@ -15,6 +15,9 @@
 
 #include "Image.h"
 #include "Convert.h"
+#include "ConvertLine.h"
+#include "ColorConvert.h"
+#include <vector>
 
 template <class T1, class T2>
 void ScaleAndOffsetLine(T1* src, T2* dst, int n,
@@ -46,6 +49,33 @@ void ScaleAndOffsetLine(T1* src, T2* dst, int n,
         }
 }
 
+// The uchar and float combinations use the vectorized kernels (which
+// produce the same results)
+
+inline void ScaleAndOffsetLine(uchar* src, uchar* dst, int n, float scale, float offset,
+                               uchar minVal, uchar maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void ScaleAndOffsetLine(uchar* src, float* dst, int n, float scale, float offset,
+                               float minVal, float maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void ScaleAndOffsetLine(float* src, uchar* dst, int n, float scale, float offset,
+                               uchar minVal, uchar maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void ScaleAndOffsetLine(float* src, float* dst, int n, float scale, float offset,
+                               float minVal, float maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
 template <class T1, class T2>
 void ScaleAndOffset(CImageOf<T1>& src, CImageOf<T2>& dst, float scale, float offset)
 {
@@ -72,6 +102,93 @@ void ScaleAndOffset(CImageOf<T1>& src, CImageOf<T2>& dst, float scale, float off
     }
 }
 
+template <class T1, class T2>
+void ScaleAndOffsetBands(const CImageOf<T1>& src, CImageOf<T2>& dst,
+                         const int* bandMap, int nDstBands,
+                         float scale, float offset)
+{
+    CShape sShape = src.Shape();
+    CShape dShape(sShape.width, sShape.height, nDstBands);
+    for (int b = 0; b < nDstBands; b++)
+        if (bandMap[b] < 0 || bandMap[b] >= sShape.nBands)
+            throw CError("ScaleAndOffsetBands: source band %d is invalid", bandMap[b]);
+    if (dst.Shape() != dShape)
+        dst.ReAllocate(dShape);
+
+    // Determine if clipping is required (see ScaleAndOffset)
+    T2 minVal = dst.MinVal();
+    T2 maxVal = dst.MaxVal();
+    if (minVal <= src.MinVal() && maxVal >= src.MaxVal())
+        minVal = maxVal = 0;
+
+    // Process each row
+    for (int y = 0; y < sShape.height; y++)
+    {
+        ConvertLineBands(&src.Pixel(0, y, 0), sShape.nBands, &dst.Pixel(0, y, 0), nDstBands,
+                         bandMap, sShape.width, scale, offset, minVal, maxVal);
+    }
+}
+
+template void ScaleAndOffsetBands<>(const CByteImage& src, CByteImage& dst, const int* bandMap, int nDstBands, float scale, float offset);
+template void ScaleAndOffsetBands<>(const CByteImage& src, CFloatImage& dst, const int* bandMap, int nDstBands, float scale, float offset);
+template void ScaleAndOffsetBands<>(const CFloatImage& src, CByteImage& dst, const int* bandMap, int nDstBands, float scale, float offset);
+template void ScaleAndOffsetBands<>(const CFloatImage& src, CFloatImage& dst, const int* bandMap, int nDstBands, float scale, float offset);
+
+// Gray to RGBA and RGB to gray rows; the uchar and float versions use the
+// kernels in ColorConvert.h (which produce the same results)
+
+template <class T>
+void ConvertToRGBALine(const T* srcP, T* dstP, int n, int aC)
+{
+    for (int x = 0; x < n; x++, srcP++)
+        for (int b = 0; b < 4; b++, dstP++)
+            *dstP = (b == aC) ? 255 : *srcP;
+}
+
+inline void ConvertToRGBALine(const uchar* srcP, uchar* dstP, int n, int aC)
+{
+    if (aC == 3)
+        InsertAlphaLine(srcP, 1, dstP, n, 255);
+    else
+        ConvertToRGBALine<uchar>(srcP, dstP, n, aC);
+}
+
+inline void ConvertToRGBALine(const float* srcP, float* dstP, int n, int aC)
+{
+    if (aC == 3)
+        InsertAlphaLine(srcP, 1, dstP, n, 255.0f);
+    else
+        ConvertToRGBALine<float>(srcP, dstP, n, aC);
+}
+
+template <class T>
+void ConvertToGrayLine(const T* srcP, T* dstP, int n, T minVal, T maxVal, float* /*buffer*/)
+{
+    for (int x = 0; x < n; x++, srcP += 3/*4*/, dstP++)
+    {
+        const RGBA<T>& p = *(const RGBA<T> *) srcP;
+        float Y = 0.212671f * p.R + 0.715160f * p.G + 0.072169f * p.B;
+        *dstP = (T) __min(maxVal, __max(minVal, Y));
+    }
+}
+
+inline void ConvertToGrayLine(const uchar* srcP, uchar* dstP, int n,
+                              uchar minVal, uchar maxVal, float* buffer)
+{
+    // Y is computed in float and truncated, so don't use the fixed-point kernel
+    ColorToGrayLine(srcP, 3, buffer, n, grayWeightsLuminance);
+    ConvertLine(buffer, dstP, n, 1.0f, 0.0f, minVal, maxVal);
+}
+
+inline void ConvertToGrayLine(const float* srcP, float* dstP, int n,
+                              float minVal, float maxVal, float* /*buffer*/)
+{
+    // The kernel only clips to the float range, then clip like the generic code
+    ColorToGrayLine(srcP, 3, dstP, n, grayWeightsLuminance);
+    for (int x = 0; x < n; x++)
+        dstP[x] = __min(maxVal, __max(minVal, dstP[x]));
+}
+
 template <class T>
 CImageOf<T> ConvertToRGBA(CImageOf<T> src)
 {
@@ -91,13 +208,7 @@ CImageOf<T> ConvertToRGBA(CImageOf<T> src)
     // Process each row
     int aC = dst.alphaChannel;
     for (int y = 0; y < sShape.height; y++)
-    {
-        T* srcP = &src.Pixel(0, y, 0);
-        T* dstP = &dst.Pixel(0, y, 0);
-        for (int x = 0; x < sShape.width; x++, srcP++)
-            for (int b = 0; b < dShape.nBands; b++, dstP++)
-                *dstP = (b == aC) ? 255 : *srcP;
-    }
+        ConvertToRGBALine(&src.Pixel(0, y, 0), &dst.Pixel(0, y, 0), sShape.width, aC);
     return dst;
 }
 
@@ -126,17 +237,10 @@ CImageOf<T> ConvertToGray(CImageOf<T> src)
     // Process each row
     T minVal = dst.MinVal();
     T maxVal = dst.MaxVal();
+    std::vector<float> buffer(sShape.width);
     for (int y = 0; y < sShape.height; y++)
-    {
-        T* srcP = &src.Pixel(0, y, 0);
-        T* dstP = &dst.Pixel(0, y, 0);
-        for (int x = 0; x < sShape.width; x++, srcP += 3/*4*/, dstP++)
-        {
-            RGBA<T>& p = *(RGBA<T> *) srcP;
-            float Y = 0.212671f * p.R + 0.715160f * p.G + 0.072169f * p.B;
-            *dstP = (T) __min(maxVal, __max(minVal, Y));
-        }
-    }
+        ConvertToGrayLine(&src.Pixel(0, y, 0), &dst.Pixel(0, y, 0), sShape.width,
+                          minVal, maxVal, &buffer[0]);
     return dst;
 }
 
@@ -203,4 +307,16 @@ void InstantiateAllConverts(void)
     InstantiateConvert(CByteImage());
     InstantiateConvert(CIntImage());
     InstantiateConvert(CFloatImage());
-}
\ No newline at end of file
+}
+
+// The calls above get inlined away in optimized builds, so also instantiate
+// the templates explicitly
+template CByteImage  ConvertToRGBA<>(CByteImage src);
+template CIntImage   ConvertToRGBA<>(CIntImage src);
+template CFloatImage ConvertToRGBA<>(CFloatImage src);
+template CByteImage  ConvertToGray<>(CByteImage src);
+template CIntImage   ConvertToGray<>(CIntImage src);
+template CFloatImage ConvertToGray<>(CFloatImage src);
+template void BandSelect<>(const CByteImage& src, CByteImage& dst, int sBand, int dBand);
+template void BandSelect<>(const CIntImage& src, CIntImage& dst, int sBand, int dBand);
+template void BandSelect<>(const CFloatImage& src, CFloatImage& dst, int sBand, int dBand);
\ No newline at end of file
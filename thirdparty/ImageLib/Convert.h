@@ -10,6 +10,12 @@
 //                       float scale, float offset);
 //      -- scale and offset one image into another (optionally convert type)
 //
+//  void ScaleAndOffsetBands(const CImageOf<T1>& src, CImageOf<T2>& dst,
+//                           const int* bandMap, int nDstBands,
+//                           float scale, float offset);
+//      -- same, but band b of dst is taken from band bandMap[b] of src
+//          (reorders/selects channels in the same pass, uchar/float only)
+//
 //  void CopyPixels(CImageOf<T1>& src, CImageOf<T2>& dst);
 //      -- convert pixel types or just copy pixels from src to dst
 //
@@ -19,12 +25,15 @@
 //  CImageOf<T> ConvertToGray(CImageOf<T> src);
 //      -- convert from RGBA (4-band) image to gray, using Y formula,
 //          Y = 0.212671 * R + 0.715160 * G + 0.072169 * B
+//          (see ColorConvert.h for more color conversions)
 //
 //  void BandSelect(CImageOf<T>& src, CImageOf<T>& dst, int sBand, int dBand);
 //      -- copy the sBand from src into the dBand in dst
 //
 //  The ScaleAndOffset and CopyPixels routines will reallocate dst if it
-//  doesn't conform in shape to src.  So will BandSelect, except that the
+//  doesn't conform in shape to src (ScaleAndOffsetBands, if it doesn't have
+//  the shape of src with nDstBands bands).  Conversions between uchar and
+//  float images run through the vectorized kernels in ConvertLine.h.  So will BandSelect, except that the
 //  number of bands in src and dst is allowed to differ (if dst is
 //  unitialized, it will be set to a 1-band image).
 //
@@ -33,6 +42,8 @@
 //  dst                 destination image
 //  scale               floating point scale value  (1.0 = no change)
 //  offset              floating point offset value (0.0 = no change)
+//  bandMap             source band of each destination band
+//  nDstBands           number of bands in dst
 //  sBand               source band (0...)
 //  dBand               destination band (0...)
 //
@@ -48,6 +59,11 @@ template <class T1, class T2>
 void ScaleAndOffset(CImageOf<T1>& src, CImageOf<T2>& dst,
                     float scale, float offset);
 
+template <class T1, class T2>
+void ScaleAndOffsetBands(const CImageOf<T1>& src, CImageOf<T2>& dst,
+                         const int* bandMap, int nDstBands,
+                         float scale, float offset);
+
 template <class T1, class T2>
 void CopyPixels(CImageOf<T1>& src, CImageOf<T2>& dst)
 {
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ConvertLine.h -- vectorized pixel type conversion kernels
+//
+// SPECIFICATION
+//  void ConvertLine(const T1* src, T2* dst, int n,
+//                   float scale, float offset, T2 minVal, T2 maxVal);
+//
+//  void ConvertLineBands(const T1* src, int srcBands,
+//                        T2* dst, int dstBands, const int* bandMap, int n,
+//                        float scale, float offset, T2 minVal, T2 maxVal);
+//
+// PARAMETERS
+//  src, dst            source and destination values (or pixels)
+//  n                   number of values (ConvertLine) or of pixels
+//                      (ConvertLineBands) to convert
+//  scale, offset       dst = src * scale + offset, computed in float
+//  minVal, maxVal      clipping range, only applied when minVal < maxVal
+//  srcBands, dstBands  number of interleaved bands in src and dst
+//  bandMap             dst band b is computed from src band bandMap[b]
+//
+// DESCRIPTION
+//  These are the inner loops of ScaleAndOffset, TypeConvert and of the
+//  image loaders, for the pixel type pairs (uchar, float) in any
+//  combination.  Values are NOT rounded when converting to uchar (they
+//  are truncated, as everywhere else in ImageLib), and clipping uses the
+//  same __min(__max(v, minVal), maxVal) expression as the generic code,
+//  so the results are bit-identical to it (including for NaNs).
+//
+//  The kernels are written to be auto-vectorized and, with GCC on x86-64,
+//  compiled twice (for AVX2 and for the baseline SSE2); the best version
+//  for the running CPU is picked once when the program is loaded.
+//
+//  ConvertLineBands fuses a channel reorder/selection with the
+//  conversion, e.g., a JPEG row (RGB) can be turned into a normalized
+//  float BGR row in a single pass.  The common 1, 3 and 4 band layouts
+//  have dedicated loops.
+//
+// SEE ALSO
+//  ConvertLine.cpp     implementation
+//  Convert.h           image level conversion routines
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef CONVERT_LINE_H
+#define CONVERT_LINE_H
+
+void ConvertLine(const uchar* src, uchar* dst, int n, float scale, float offset, uchar minVal, uchar maxVal);
+void ConvertLine(const uchar* src, float* dst, int n, float scale, float offset, float minVal, float maxVal);
+void ConvertLine(const float* src, uchar* dst, int n, float scale, float offset, uchar minVal, uchar maxVal);
+void ConvertLine(const float* src, float* dst, int n, float scale, float offset, float minVal, float maxVal);
+
+void ConvertLineBands(const uchar* src, int srcBands, uchar* dst, int dstBands, const int* bandMap,
+                      int n, float scale, float offset, uchar minVal, uchar maxVal);
+void ConvertLineBands(const uchar* src, int srcBands, float* dst, int dstBands, const int* bandMap,
+                      int n, float scale, float offset, float minVal, float maxVal);
+void ConvertLineBands(const float* src, int srcBands, uchar* dst, int dstBands, const int* bandMap,
+                      int n, float scale, float offset, uchar minVal, uchar maxVal);
+void ConvertLineBands(const float* src, int srcBands, float* dst, int dstBands, const int* bandMap,
+                      int n, float scale, float offset, float minVal, float maxVal);
+
+#endif // CONVERT_LINE_H
@@ -7,9 +7,21 @@
 //
 //  Upsampling is not supported:  zero-pad, then filter (see Pyramid.h).
 //
-//  The current version is quite inefficient, especially for separable
-//  convolution, where vertical kernels use a complete extra set of iterators
-//  that aren't necessary.
+//  Convolve works one output row at a time.  The source rows it needs are
+//  converted to float and padded according to the source borderMode once,
+//  then kept in a small row cache, so the inner loops run over contiguous
+//  memory without any bounds checks and vectorize.  The taps are summed in
+//  the same order and precision as the original code (kernel column by
+//  column, float products added to a double sum), so with the default
+//  eBorderZero the output is bit for bit the same.  Kernels 3, 5 or 7 taps
+//  high have their own instantiations.
+//
+//  ConvolveSeparable filters each source row horizontally once, caches it,
+//  and makes output rows weighted sums of those.  When decimating, the
+//  horizontal pass only produces the retained columns and only the
+//  retained rows are summed, so no full resolution intermediate image is
+//  ever built: the only temporaries are the kernel-height rows of the
+//  rolling row cache.
 //
 // SEE ALSO
 //  Convolve.h          longer description of these routines
@@ -21,78 +33,269 @@
 
 #include "Image.h"
 #include "Convolve.h"
+#include "ImageProc.h"
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+// Accumulator type of the separable path, double like the original code
+template <class T> struct ConvolveAccum         { typedef double type; };
 
-static int TrimIndex(int k, EBorderMode e, int n)
+template <class T, class A>
+static void FillPaddedRow(A* buf, const T* srcRow, int width, int nB,
+						  int left, int right, EBorderMode borderMode)
 {
-	// Compute the index value 0 <= k < n (return -1 for Zero mode)
-	while (k < 0 || k >= n)
+	// Copy a source row into buf, converted to the accumulator type and
+	// padded with left and right extra pixels according to borderMode
+	for (int x = -left; x < width + right; x++, buf += nB)
 	{
-		switch (e)
+		if (x == 0)
 		{
-		case eBorderZero:       // zero padding
-			return -1;
-		case eBorderReplicate:  // replicate border values
-			return k = __max(0, __min(n-1, k));
-		case eBorderReflect:    // reflect border pixels
-			k = (k < 0) ? -k : (k < n) ? k : 2*(n-1)-k;
-			break;              // may need to iterate if n < |k|
-		case eBorderCyclic:     // wrap pixel values
-			k = (k + n) % n;    // may need to iterate if k + n < 0
+			// Interior: one contiguous conversion
+			int n = width * nB;
+			for (int i = 0; i < n; i++)
+				buf[i] = (A) srcRow[i];
+			buf += n - nB;
+			x = width - 1;
+			continue;
 		}
+		int sx = (x >= 0 && x < width) ? x : TrimIndex(x, borderMode, width);
+		if (sx < 0)
+			for (int b = 0; b < nB; b++)
+				buf[b] = 0;
+		else
+			for (int b = 0; b < nB; b++)
+				buf[b] = (A) srcRow[sx * nB + b];
 	}
-	return k;
 }
 
-template <class T>
-static void FillRowBuffer(T buf[], CImageOf<T>& src, CFloatImage& kernel, int k, int n)
+// acc[i] += sum_k w[k] * s[i + k * step], for i < n. The tap count is a
+// template parameter for the common small kernels so the taps stay in
+// registers and the loop over i vectorizes.
+template <int KW, class A>
+static inline void AccumulateTaps(A* acc, const A* s, const A* w, int n, int step)
 {
-	// Compute the real row address
-	CShape sShape = src.Shape();
-	int nB = sShape.nBands;
-	int k0 = TrimIndex(k + kernel.origin[1], src.borderMode, sShape.height);
-	if (k0 < 0)
+	const A w0 = w[0], w1 = w[1], w2 = w[2];
+	const A w3 = (KW > 3) ? w[3] : 0, w4 = (KW > 3) ? w[4] : 0;
+	const A w5 = (KW > 5) ? w[5] : 0, w6 = (KW > 5) ? w[6] : 0;
+	for (int i = 0; i < n; i++)
 	{
-		memset(buf, 0, n * sizeof(T));
-		return;
+		A sum = w0 * s[i] + w1 * s[i + step] + w2 * s[i + 2*step];
+		if (KW > 3)
+			sum += w3 * s[i + 3*step] + w4 * s[i + 4*step];
+		if (KW > 5)
+			sum += w5 * s[i + 5*step] + w6 * s[i + 6*step];
+		acc[i] += sum;
 	}
+}
 
-	// Fill the row
-	T* srcP = &src.Pixel(0, k0, 0);
-	int m = n / nB;
-	for (int l = 0; l < m; l++, buf += nB)
+template <class A>
+static void AccumulateRow(A* acc, const A* s, const A* w, int kW, int n, int step)
+{
+	switch (kW)
 	{
-		int l0 = TrimIndex(l + kernel.origin[0], src.borderMode, sShape.width);
-		if (l0 < 0)
-			memset(buf, 0, nB * sizeof(T));
-		else
-			memcpy(buf, &srcP[l0*nB], nB * sizeof(T));
+	case 3: AccumulateTaps<3>(acc, s, w, n, step); return;
+	case 5: AccumulateTaps<5>(acc, s, w, n, step); return;
+	case 7: AccumulateTaps<7>(acc, s, w, n, step); return;
+	}
+	for (int k = 0; k < kW; k++, s += step)
+	{
+		const A wk = w[k];
+		if (wk == 0)
+			continue;
+		for (int i = 0; i < n; i++)
+			acc[i] += wk * s[i];
 	}
 }
 
-template <class T>
-void ConvolveRow(CImageOf<T> buffer, CFloatImage kernel, T* dst,
-				 int n, T minVal, T maxVal)
+// acc[i] += sum_k w[k] * rows[k][i], the sum being rounded to double after
+// every tap, and each product computed in float, as in the original code.
+// The tap count is a template parameter for the common small kernels.
+template <int KH>
+static inline void AccumulateColumnTaps(double* acc, const float* const* rows, int offset,
+										const float* w, int n)
 {
-	CShape kShape = kernel.Shape();
-	int kX  = kShape.width;
-	int kY  = kShape.height;
-	CShape bShape = buffer.Shape();
-	int nB  = bShape.nBands;
-
+	const float* r0 = rows[0] + offset;
+	const float* r1 = rows[1] + offset;
+	const float* r2 = rows[2] + offset;
+	const float* r3 = (KH > 3) ? rows[3] + offset : r0;
+	const float* r4 = (KH > 3) ? rows[4] + offset : r0;
+	const float* r5 = (KH > 5) ? rows[5] + offset : r0;
+	const float* r6 = (KH > 5) ? rows[6] + offset : r0;
+	const float w0 = w[0], w1 = w[1], w2 = w[2];
+	const float w3 = (KH > 3) ? w[3] : 0, w4 = (KH > 3) ? w[4] : 0;
+	const float w5 = (KH > 5) ? w[5] : 0, w6 = (KH > 5) ? w[6] : 0;
 	for (int i = 0; i < n; i++)
 	{
+		double sum = acc[i];
+		sum += (double) (w0 * r0[i]);
+		sum += (double) (w1 * r1[i]);
+		sum += (double) (w2 * r2[i]);
+		if (KH > 3)
+		{
+			sum += (double) (w3 * r3[i]);
+			sum += (double) (w4 * r4[i]);
+		}
+		if (KH > 5)
+		{
+			sum += (double) (w5 * r5[i]);
+			sum += (double) (w6 * r6[i]);
+		}
+		acc[i] = sum;
+	}
+}
+
+static void AccumulateColumn(double* acc, const float* const* rows, int offset,
+							 const float* w, int kH, int n)
+{
+	switch (kH)
+	{
+	case 3: AccumulateColumnTaps<3>(acc, rows, offset, w, n); return;
+	case 5: AccumulateColumnTaps<5>(acc, rows, offset, w, n); return;
+	case 7: AccumulateColumnTaps<7>(acc, rows, offset, w, n); return;
+	}
+	for (int k = 0; k < kH; k++)
+	{
+		const float wk = w[k];
+		const float* r = rows[k] + offset;
+		for (int i = 0; i < n; i++)
+			acc[i] += (double) (wk * r[i]);
+	}
+}
+
+// dst[j * nB + b] = src[j * subsample * nB + b], for the first n pixels.
+// NB is the band count when it is known at compile time, 0 otherwise.
+template <int NB, class A>
+static inline void GatherPixels(A* dst, const A* src, int n, int nB, int subsample)
+{
+	if (NB > 0)
+		nB = NB;
+	int step = subsample * nB;
+	for (int j = 0; j < n; j++, dst += nB, src += step)
 		for (int b = 0; b < nB; b++)
+			dst[b] = src[b];
+}
+
+// Decimating version of AccumulateRow: acc[X * nB + b] += sum_k w[k] *
+// s[(X * subsample + k) * nB + b], for the nOut retained output pixels.
+// The source pixels are first split into subsample phases, pixel X of phase
+// r being source pixel X * subsample + r, so that every tap becomes a
+// contiguous AccumulateRow style loop over one phase.
+template <class A>
+static void AccumulateRowDecimated(A* acc, const A* s, const A* w, int kW,
+								   int nOut, int nB, int subsample,
+								   std::vector<A>& phases)
+{
+	int phaseLength = (nOut + (kW - 1) / subsample) * nB;
+	int nSource = (nOut - 1) * subsample + kW;
+	phases.resize(subsample * phaseLength);
+	for (int r = 0; r < subsample; r++)
+	{
+		int nPixels = __min(phaseLength / nB, (nSource - r + subsample - 1) / subsample);
+		switch (nB)
+		{
+		case 1:  GatherPixels<1>(&phases[r * phaseLength], s + r, nPixels, 1, subsample); break;
+		case 3:  GatherPixels<3>(&phases[r * phaseLength], s + r * 3, nPixels, 3, subsample); break;
+		default: GatherPixels<0>(&phases[r * phaseLength], s + r * nB, nPixels, nB, subsample); break;
+		}
+	}
+
+	int n = nOut * nB;
+	for (int k = 0; k < kW; k++)
+	{
+		const A wk = w[k];
+		if (wk == 0)
+			continue;
+		const A* ph = &phases[(k % subsample) * phaseLength + (k / subsample) * nB];
+		for (int i = 0; i < n; i++)
+			acc[i] += wk * ph[i];
+	}
+}
+
+template <class T, class A>
+static void StoreRow(T* dst, const A* acc, int n, T minVal, T maxVal)
+{
+	const A lo = (A) minVal, hi = (A) maxVal;
+	for (int i = 0; i < n; i++)
+		dst[i] = (T) __max(lo, __min(hi, acc[i]));
+}
+
+template <class T>
+static void CopyIfAliased(CImageOf<T>& src, CImageOf<T>& dst)
+{
+	// Convolving in place: work from a copy of the source
+	if (&dst.Pixel(0, 0, 0) != &src.Pixel(0, 0, 0))
+		return;
+	CShape sShape = src.Shape();
+	CImageOf<T> copy(sShape);
+	for (int y = 0; y < sShape.height; y++)
+		memcpy(&copy.Pixel(0, y, 0), &src.Pixel(0, y, 0), sShape.width * sShape.nBands * sizeof(T));
+	copy.borderMode = src.borderMode;
+	src = copy;
+}
+
+//
+//  Separable convolution of src with kx (horizontal, origin ox) and ky
+//  (vertical, origin oy), keeping every subsample'th row and column.  dst
+//  must already have the decimated shape.  Only the retained columns of a
+//  source row are filtered, and the filtered rows are kept in a rolling
+//  cache of ky.size() rows while the output rows are produced.
+//
+template <class T, class A>
+static void ConvolveSeparableRows(CImageOf<T>& src, CImageOf<T>& dst,
+								  const std::vector<A>& kx, int ox,
+								  const std::vector<A>& ky, int oy,
+								  int subsample)
+{
+	CShape sShape = src.Shape();
+	CShape dShape = dst.Shape();
+	int nB = sShape.nBands;
+	int n  = dShape.width * nB;
+	int kW = (int) kx.size(), kH = (int) ky.size();
+	EBorderMode border = src.borderMode;
+
+	// Padding needed so that the taps of every retained column are in the row
+	int left  = __max(0, ox);
+	int right = __max(0, (dShape.width - 1) * subsample - ox + kW - sShape.width);
+
+	std::vector<A> padded((left + sShape.width + right) * nB), acc(n), phases;
+	std::vector<int> needed(__max(kH, 1));
+	CRowCache<A> cache(kH, n);
+	T minVal = dst.MinVal(), maxVal = dst.MaxVal();
+
+	for (int y = 0; y < dShape.height; y++)
+	{
+		for (int k = 0; k < kH; k++)
+		{
+			int sy = y * subsample - oy + k;
+			needed[k] = (sy >= 0 && sy < sShape.height) ? sy : TrimIndex(sy, border, sShape.height);
+		}
+
+		std::fill(acc.begin(), acc.end(), (A) 0);
+		for (int k = 0; k < kH; k++)
 		{
-			float sum = 0.0f;
-			for (int k = 0; k < kY; k++)
+			int sy = needed[k];
+			if (sy < 0)     // zero padding
+				continue;
+
+			bool fill;
+			A* row = cache.Lookup(sy, &needed[0], kH, fill);
+			if (fill)
 			{
-				float* kPtr = &kernel.Pixel(0, k, 0);
-				T*     bPtr = &buffer.Pixel(i, k, b);
-				for (int l = 0; l < kX; l++, bPtr += nB)
-					sum += kPtr[l] * bPtr[0];
+				FillPaddedRow(&padded[0], &src.Pixel(0, sy, 0), sShape.width, nB, left, right, border);
+				std::fill(row, row + n, (A) 0);
+				if (subsample == 1)
+					AccumulateRow(row, &padded[(left - ox) * nB], &kx[0], kW, n, nB);
+				else
+					AccumulateRowDecimated(row, &padded[(left - ox) * nB], &kx[0], kW,
+										   dShape.width, nB, subsample, phases);
 			}
-			*dst++ = (T) __max(minVal, __min(maxVal, sum));
+			const A wy = ky[k];
+			for (int i = 0; i < n; i++)
+				acc[i] += wy * row[i];
 		}
+
+		StoreRow(&dst.Pixel(0, y, 0), &acc[0], n, minVal, maxVal);
 	}
 }
 
@@ -109,18 +312,60 @@ void Convolve(CImageOf<T> src, CImageOf<T>& dst,
 	if (sShape.width * sShape.height * sShape.nBands == 0)
 		return;
 
-	// Do the convolution
+	CopyIfAliased(src, dst);
+
+	// Output pixel (x, y) sums kernel(kx, ky) * src(x - ox + kx, y - oy + ky)
+	int nB = sShape.nBands;
+	int n  = sShape.width * nB;
+	int kW = kShape.width, kH = kShape.height;
+	int ox = kernel.origin[0], oy = kernel.origin[1];
+	int left = __max(0, ox), right = __max(0, kW - 1 - ox);
+	EBorderMode border = src.borderMode;
+
+	// The kernel columns, one after the other
+	std::vector<float> w(kW * kH);
+	for (int x = 0; x < kW; x++)
+		for (int y = 0; y < kH; y++)
+			w[x * kH + y] = kernel.Pixel(x, y, 0);
+
+	int paddedLength = (left + sShape.width + right) * nB;
+	std::vector<float> zeros(paddedLength, 0.0f);
+	std::vector<double> acc(n);
+	std::vector<int> needed(kH);
+	std::vector<const float*> rows(kH);
+	CRowCache<float> cache(kH, paddedLength);
+	T minVal = dst.MinVal(), maxVal = dst.MaxVal();
+
 	for (int y = 0; y < sShape.height; y++)
-		for (int x = 0; x < sShape.width; x++)
-			for (int c = 0; c < sShape.nBands; c++)
+	{
+		for (int ky = 0; ky < kH; ky++)
+		{
+			int sy = y - oy + ky;
+			needed[ky] = (sy >= 0 && sy < sShape.height) ? sy : TrimIndex(sy, border, sShape.height);
+		}
+
+		for (int ky = 0; ky < kH; ky++)
+		{
+			int sy = needed[ky];
+			if (sy < 0)     // zero padding
 			{
-				double sum = 0;
-				for (int kx = 0; kx < kShape.width; kx++)
-					for (int ky = 0; ky < kShape.height; ky++)
-						if ((x-kernel.origin[0]+kx >= 0) && (x-kernel.origin[0]+kx < sShape.width) && (y-kernel.origin[1]+ky >= 0) && (y-kernel.origin[1]+ky < sShape.height))
-							sum += kernel.Pixel(kx,ky,0) * src.Pixel(x-kernel.origin[0]+kx,y-kernel.origin[1]+ky,c);
-				dst.Pixel(x,y,c) = (T) __max(dst.MinVal(), __min(dst.MaxVal(), sum));
+				rows[ky] = &zeros[0];
+				continue;
 			}
+
+			bool fill;
+			float* row = cache.Lookup(sy, &needed[0], kH, fill);
+			if (fill)
+				FillPaddedRow(row, &src.Pixel(0, sy, 0), sShape.width, nB, left, right, border);
+			rows[ky] = row;
+		}
+
+		std::fill(acc.begin(), acc.end(), 0.0);
+		for (int kx = 0; kx < kW; kx++)
+			AccumulateColumn(&acc[0], &rows[0], (left - ox + kx) * nB, &w[kx * kH], kH, n);
+
+		StoreRow(&dst.Pixel(0, y, 0), &acc[0], n, minVal, maxVal);
+	}
 }
 
 template <class T>
@@ -128,43 +373,30 @@ void ConvolveSeparable(CImageOf<T> src, CImageOf<T>& dst,
 					   CFloatImage x_kernel, CFloatImage y_kernel,
 					   int subsample)
 {
+	typedef typename ConvolveAccum<T>::type A;
+
 	// Allocate the result, if necessary
 	CShape dShape = src.Shape();
+	subsample = __max(1, subsample);
 	if (subsample > 1)
 	{
 		dShape.width  = (dShape.width  + subsample-1) / subsample;
 		dShape.height = (dShape.height + subsample-1) / subsample;
 	}
 	dst.ReAllocate(dShape, false);
+	if (dShape.width * dShape.height * dShape.nBands == 0)
+		return;
 
-	// Allocate the intermediate images
-	CImageOf<T> tmpImg1(src.Shape());
-	CImageOf<T> tmpImg2(src.Shape());
-
-	// Create a proper vertical convolution kernel
-	CFloatImage v_kernel(1, y_kernel.Shape().width, 1);
-	for (int k = 0; k < y_kernel.Shape().width; k++)
-		v_kernel.Pixel(0, k, 0) = y_kernel.Pixel(k, 0, 0);
-	v_kernel.origin[1] = y_kernel.origin[0];
-
-	// Perform the two convolutions
-	Convolve(src, tmpImg1, x_kernel);
-	Convolve(tmpImg1, tmpImg2, v_kernel);
-				
-	// Downsample or copy
-	for (int y = 0; y < dShape.height; y++)
-	{
-		T* sPtr = &tmpImg2.Pixel(0, y * subsample, 0);
-		T* dPtr = &dst.Pixel(0, y, 0);
-		int nB  = dShape.nBands;
-		for (int x = 0; x < dShape.width; x++)
-		{
-			for (int b = 0; b < nB; b++)
-				dPtr[b] = sPtr[b];
-			sPtr += subsample * nB;
-			dPtr += nB;
-		}
-	}
+	CopyIfAliased(src, dst);
+
+	// Both kernels are 1 row images, the vertical one is used transposed
+	std::vector<A> kx(x_kernel.Shape().width), ky(y_kernel.Shape().width);
+	for (int k = 0; k < (int) kx.size(); k++)
+		kx[k] = x_kernel.Pixel(k, 0, 0);
+	for (int k = 0; k < (int) ky.size(); k++)
+		ky[k] = y_kernel.Pixel(k, 0, 0);
+
+	ConvolveSeparableRows(src, dst, kx, x_kernel.origin[0], ky, y_kernel.origin[0], subsample);
 }
 
 template <class T>
@@ -181,69 +413,89 @@ void InstantiateConvolutions()
 	InstantiateConvolutionOf(CFloatImage());
 }
 
+// The calls above get inlined away in optimized builds, so also instantiate
+// the templates explicitly
+template void Convolve<>(CByteImage src, CByteImage& dst, CFloatImage kernel);
+template void Convolve<>(CIntImage src, CIntImage& dst, CFloatImage kernel);
+template void Convolve<>(CFloatImage src, CFloatImage& dst, CFloatImage kernel);
+template void ConvolveSeparable<>(CByteImage src, CByteImage& dst, CFloatImage xKernel, CFloatImage yKernel, int subsample);
+template void ConvolveSeparable<>(CIntImage src, CIntImage& dst, CFloatImage xKernel, CFloatImage yKernel, int subsample);
+template void ConvolveSeparable<>(CFloatImage src, CFloatImage& dst, CFloatImage xKernel, CFloatImage yKernel, int subsample);
+
 //
 //  Default kernels
 //
+//  Each kernel is a function-local static, built on first use (which C++11
+//  makes thread-safe) and never modified afterwards.  Callers get a const
+//  reference; copying it into a CFloatImage shares the (atomically
+//  reference counted) memory, so it must not be written through.
+//
+
+static CFloatImage MakeKernel(int width, int height, const float* taps,
+							  int originX, int originY, double norm = 1.0)
+{
+	CFloatImage kernel(width, height, 1);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			kernel.Pixel(x, y, 0) = (float) (taps[y * width + x] / norm);
+	kernel.origin[0] = originX;
+	kernel.origin[1] = originY;
+	return kernel;
+}
 
-CFloatImage ConvolveKernel_121;
-CFloatImage ConvolveKernel_14641;
-CFloatImage ConvolveKernel_8tapLowPass;
-CFloatImage ConvolveKernel_7x7;
-CFloatImage ConvolveKernel_SobelX;
-CFloatImage ConvolveKernel_SobelY;
+const CFloatImage& ConvolveKernel_121()
+{
+	static const float k_121[3] = {0.25f, 0.5f, 0.25f};
+	static const CFloatImage kernel = MakeKernel(3, 1, k_121, 1, 0);
+	return kernel;
+}
 
-struct KernelInit
+const CFloatImage& ConvolveKernel_14641()
 {
-	KernelInit();
-};
+	static const float k_14641[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
+	static const CFloatImage kernel = MakeKernel(5, 1, k_14641, 2, 0);
+	return kernel;
+}
 
-KernelInit::KernelInit()
+const CFloatImage& ConvolveKernel_8tapLowPass()
 {
-	static float k_11[2] = {0.5f, 0.5f};
-	static float k_121[3] = {0.25f, 0.5f, 0.25f};
-	static float k_14641[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
-	static float k_8ptFP[8] = {-0.044734f, -0.059009f,  0.156544f,  0.449199f,
-								0.449199f,  0.156544f, -0.059009f, -0.044734f};
-	// The following are derived as fix-point /256 fractions of the above:
+	//  Floating point taps: -0.044734, -0.059009,  0.156544,  0.449199, (mirrored)
+	//  The following are derived as fix-point /256 fractions of those:
 	//  -12, -15, 40, 115
-	static float k_8ptI [8] = {-0.04687500f, -0.05859375f,  0.15625000f,  0.44921875f,
-								0.44921875f,  0.15625000f, -0.05859375f, -0.04687500f};
-
-	static float k_7x7[49] = { 1.0, 4.0, 7.0, 10.0, 7.0, 4.0, 1.0, 
-							   4.0, 12.0, 26.0, 33.0, 26.0, 12.0, 4.0,
-							   7.0, 26.0, 55.0, 71.0, 55.0, 26.0, 7.0, 
-							   10.0, 33.0, 71.0, 91.0, 71.0, 33.0, 10.0, 
-							   7.0, 26.0, 55.0, 71.0, 55.0, 26.0, 7.0, 
-							   4.0, 12.0, 26.0, 33.0, 26.0, 12.0, 4.0,
-							   1.0, 4.0, 7.0, 10.0, 7.0, 4.0, 1.0 };
-
-	for (int i = 0; i < 49; i++) {
-		k_7x7[i] /= 1115.0;
-	}
+	static const float k_8ptI [8] = {-0.04687500f, -0.05859375f,  0.15625000f,  0.44921875f,
+									  0.44921875f,  0.15625000f, -0.05859375f, -0.04687500f};
+	static const CFloatImage kernel = MakeKernel(8, 1, k_8ptI, 4, 0);
+	return kernel;
+}
+
+const CFloatImage& ConvolveKernel_7x7()
+{
+	static const float k_7x7[49] = { 1.0, 4.0, 7.0, 10.0, 7.0, 4.0, 1.0, 
+									 4.0, 12.0, 26.0, 33.0, 26.0, 12.0, 4.0,
+									 7.0, 26.0, 55.0, 71.0, 55.0, 26.0, 7.0, 
+									 10.0, 33.0, 71.0, 91.0, 71.0, 33.0, 10.0, 
+									 7.0, 26.0, 55.0, 71.0, 55.0, 26.0, 7.0, 
+									 4.0, 12.0, 26.0, 33.0, 26.0, 12.0, 4.0,
+									 1.0, 4.0, 7.0, 10.0, 7.0, 4.0, 1.0 };
+	static const CFloatImage kernel = MakeKernel(7, 7, k_7x7, 0, 0, 1115.0);
+	return kernel;
+}
 
-	ConvolveKernel_121.ReAllocate(CShape(3, 1, 1), k_121, false, 3);
-	ConvolveKernel_121.origin[0] = 1;
-	ConvolveKernel_14641.ReAllocate(CShape(5, 1, 1), k_14641, false, 5);
-	ConvolveKernel_14641.origin[0] = 2;
-	ConvolveKernel_8tapLowPass.ReAllocate(CShape(8, 1, 1), k_8ptI, false, 8);
-	ConvolveKernel_8tapLowPass.origin[0] = 4;
-	ConvolveKernel_7x7.ReAllocate(CShape(7, 7, 1), k_7x7, false, 7);
-
-	/* Sobel filters */
-	static float k_SobelX[9] = { -1, 0, 1,
-								 -2, 0, 2,
-								 -1, 0, 1 };
-
-	static float k_SobelY[9] = { -1, -2, -1,
-								  0,  0,  0,
-								  1,  2,  1 };    
-			
-	ConvolveKernel_SobelX.ReAllocate(CShape(3, 3, 1), k_SobelX, false, 3);
-	ConvolveKernel_SobelX.origin[0] = 1;
-	ConvolveKernel_SobelX.origin[1] = 1;
-	ConvolveKernel_SobelY.ReAllocate(CShape(3, 3, 1), k_SobelY, false, 3);
-	ConvolveKernel_SobelY.origin[0] = 1;
-	ConvolveKernel_SobelY.origin[1] = 1;
-}
-
-KernelInit ConvKernelInitializer;
+/* Sobel filters */
+const CFloatImage& ConvolveKernel_SobelX()
+{
+	static const float k_SobelX[9] = { -1, 0, 1,
+									   -2, 0, 2,
+									   -1, 0, 1 };
+	static const CFloatImage kernel = MakeKernel(3, 3, k_SobelX, 1, 1);
+	return kernel;
+}
+
+const CFloatImage& ConvolveKernel_SobelY()
+{
+	static const float k_SobelY[9] = { -1, -2, -1,
+										0,  0,  0,
+										1,  2,  1 };
+	static const CFloatImage kernel = MakeKernel(3, 3, k_SobelY, 1, 1);
+	return kernel;
+}
@@ -25,6 +25,11 @@
 //  by the kernel.origin[] parameters, which specify the offset (coordinate,
 //  usually negative) of the first (top-left) pixel in the kernel.
 //
+//  ConvolveSeparable only computes the samples that survive decimation,
+//  without any full resolution intermediate image.  The horizontal pass
+//  keeps full precision, so 8-bit results may differ by one level from
+//  filtering with two successive Convolve calls.
+//
 // SEE ALSO
 //  Convolve.cpp        implementation
 //  Image.h             image class definition
@@ -42,9 +47,10 @@ void ConvolveSeparable(CImageOf<T> src, CImageOf<T>& dst,
                        CFloatImage xKernel, CFloatImage yKernel,
                        int subsample);
 
-extern CFloatImage ConvolveKernel_121;
-extern CFloatImage ConvolveKernel_14641;
-extern CFloatImage ConvolveKernel_7x7;
-extern CFloatImage ConvolveKernel_8tapLowPass;
-extern CFloatImage ConvolveKernel_SobelX;
-extern CFloatImage ConvolveKernel_SobelY;
+// Standard kernels, built on first use; safe to call from any thread
+const CFloatImage& ConvolveKernel_121();
+const CFloatImage& ConvolveKernel_14641();
+const CFloatImage& ConvolveKernel_7x7();
+const CFloatImage& ConvolveKernel_8tapLowPass();
+const CFloatImage& ConvolveKernel_SobelX();
+const CFloatImage& ConvolveKernel_SobelY();
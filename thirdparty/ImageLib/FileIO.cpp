@@ -19,7 +19,10 @@
 
 #include "Image.h"
 #include "FileIO.h"
+#include "Convert.h"
+#include "ColorConvert.h"
 #include "ImageProc.h"
+#include <vector>
 
 #include "JPEG/JPEGReader.h"
 #include "JPEG/JPEGWriter.h"
@@ -271,7 +274,20 @@ void WriteFileTGA(CImage img, const char* filename)
         throw CError("WriteFileTGA(%s): error closing file", filename);
 }
 
-void ReadFileJPEG(CImage& img, const char* filename) 
+//
+//  JPEG files store RGB, the images use BGR(A) order (see RGBA<T>)
+//
+
+static std::vector<int> ReversedBands(int nBands)
+{
+    std::vector<int> bandMap(nBands);
+    for (int c = 0; c < nBands; c++)
+        bandMap[c] = nBands - c - 1;
+    return bandMap;
+}
+
+// Loads the pixels as stored in the file (RGB), bottom row first
+static CByteImage LoadJPEG(const char* filename)
 {
     JPEGReader loader;
     loader.header(filename);
@@ -289,19 +305,25 @@ void ReadFileJPEG(CImage& img, const char* filename)
     }
 
     loader.load(rowPointers.begin());
+    return imgAux;
+}
+
+void ReadFileJPEG(CImage& img, const char* filename) 
+{
+    CByteImage imgAux = LoadJPEG(filename);
+    CShape shape = imgAux.Shape();
     img.ReAllocate(shape, typeid(uchar), sizeof(uchar), true);
 
     // Reverse color channel order
-    for(int y = 0; y < shape.height; y++) {
-        uchar* auxIt = (uchar*)imgAux.PixelAddress(0, y, 0);
-        uchar* imgIt = (uchar*)img.PixelAddress(0, y, 0);
+    SwapRedBlue(imgAux, *(CByteImage *) &img);
+}
 
-        for(int x = 0; x < shape.width; x++, auxIt += shape.nBands, imgIt += shape.nBands) {
-            for(int c = 0; c < shape.nBands; c++) {
-                imgIt[c] = auxIt[shape.nBands - c - 1];
-            }
-        }
-    }
+// Same, but converts to float (divided by 255, as TypeConvert) in the same pass
+static void ReadFileJPEG(CFloatImage& img, const char* filename)
+{
+    CByteImage imgAux = LoadJPEG(filename);
+    std::vector<int> bandMap = ReversedBands(imgAux.Shape().nBands);
+    ScaleAndOffsetBands(imgAux, img, &bandMap[0], imgAux.Shape().nBands, float(1/255.0), 0.0f);
 }
 
 void WriteFileJPEG(CImage& img, const char* filename, unsigned quality) 
@@ -318,17 +340,8 @@ void WriteFileJPEG(CImage& img, const char* filename, unsigned quality)
     writer.setQuality(quality);
 
     // Reverse color channel order
-    CByteImage imgAux(shape);
-    for(int y = 0; y < shape.height; y++) {
-        uchar* auxIt = (uchar*)imgAux.PixelAddress(0, y, 0);
-        uchar* imgIt = (uchar*)img.PixelAddress(0, y, 0);
-
-        for(int x = 0; x < shape.width; x++, auxIt += shape.nBands, imgIt += shape.nBands) {
-            for(int c = 0; c < shape.nBands; c++) {
-                auxIt[c] = imgIt[shape.nBands - c - 1];
-            }
-        }
-    }
+    CByteImage imgAux;
+    SwapRedBlue(*(CByteImage *) &img, imgAux);
 
     // Pack row pointers
     std::vector<uchar*> rowPointers(shape.height);
@@ -365,10 +378,7 @@ void ReadFile(CImage& img, const char* filename)
         if (img.PixType() == typeid(uchar))
             ReadFileJPEG(*(CByteImage *) &img, filename);
         else {
-            CByteImage imgAux;
-            ReadFileJPEG(imgAux, filename);
-
-            if(img.PixType() == typeid(float)) TypeConvert(imgAux, *(CFloatImage*) &img);
+            if(img.PixType() == typeid(float)) ReadFileJPEG(*(CFloatImage*) &img, filename);
             else
                 throw CError("Cannot load image into img with this type of buffer");
         }
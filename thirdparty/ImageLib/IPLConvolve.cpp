@@ -165,36 +165,38 @@ void InstantiateConvolutions()
 }
 
 //
-//  Default kernels
+//  Default kernels (see Convolve.cpp; IPL uses negated origins)
 //
 
-CFloatImage ConvolveKernel_121;
-CFloatImage ConvolveKernel_14641;
-CFloatImage ConvolveKernel_8tapLowPass;
+static CFloatImage MakeKernel(int width, const float* taps, int originX)
+{
+    CFloatImage kernel(width, 1, 1);
+    for (int x = 0; x < width; x++)
+        kernel.Pixel(x, 0, 0) = taps[x];
+    kernel.origin[0] = originX;
+    return kernel;
+}
 
-struct KernelInit
+const CFloatImage& ConvolveKernel_121()
 {
-    KernelInit();
-};
+    static const float k_121[3] = {0.25f, 0.5f, 0.25f};
+    static const CFloatImage kernel = MakeKernel(3, k_121, -1);
+    return kernel;
+}
 
-KernelInit::KernelInit()
+const CFloatImage& ConvolveKernel_14641()
 {
-    static float k_11[2] = {0.5f, 0.5f};
-    static float k_121[3] = {0.25f, 0.5f, 0.25f};
-    static float k_14641[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
-    static float k_8ptFP[8] = {-0.044734f, -0.059009f,  0.156544f,  0.449199f,
-                                0.449199f,  0.156544f, -0.059009f, -0.044734f};
-    // The following are derived as fix-point /256 fractions of the above:
-    //  -12, -15, 40, 115
-    static float k_8ptI [8] = {-0.04687500f, -0.05859375f,  0.15625000f,  0.44921875f,
-                                0.44921875f,  0.15625000f, -0.05859375f, -0.04687500f};
-
-    ConvolveKernel_121.ReAllocate(CShape(3, 1, 1), k_121, false, 3);
-    ConvolveKernel_121.origin[0] = -1;
-    ConvolveKernel_14641.ReAllocate(CShape(5, 1, 1), k_14641, false, 5);
-    ConvolveKernel_14641.origin[0] = -2;
-    ConvolveKernel_8tapLowPass.ReAllocate(CShape(8, 1, 1), k_8ptI, false, 8);
-    ConvolveKernel_8tapLowPass.origin[0] = -4;
+    static const float k_14641[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
+    static const CFloatImage kernel = MakeKernel(5, k_14641, -2);
+    return kernel;
 }
 
-KernelInit ConvKernelInitializer;
\ No newline at end of file
+const CFloatImage& ConvolveKernel_8tapLowPass()
+{
+    // Fix-point /256 fractions of the 8-tap low-pass filter:
+    //  -12, -15, 40, 115
+    static const float k_8ptI [8] = {-0.04687500f, -0.05859375f,  0.15625000f,  0.44921875f,
+                                      0.44921875f,  0.15625000f, -0.05859375f, -0.04687500f};
+    static const CFloatImage kernel = MakeKernel(8, k_8ptI, -4);
+    return kernel;
+}
\ No newline at end of file
@@ -11,6 +11,8 @@
 ///////////////////////////////////////////////////////////////////////////
 
 #include "Image.h"
+#include "ImageMemory.h"
+#include <utility>
 
 //
 // struct CShape: shape of image (width x height x nbands)
@@ -62,7 +64,7 @@ void CImage::SetDefaults()
     alphaChannel = 3;       // which channel contains alpha (for compositing)
     origin[0] = 0;          // x and y coordinate origin (for some operations)
     origin[1] = 0;          // x and y coordinate origin (for some operations)
-    borderMode = eBorderReplicate;   // border behavior for neighborhood operations...
+    borderMode = eBorderZero;        // border behavior for neighborhood operations...
 }
 
 CImage::CImage()
@@ -77,6 +79,38 @@ CImage::CImage(CShape s, const type_info& ti, int cS)
     ReAllocate(s, ti, cS, 0, true, 0);
 }
 
+CImage::CImage(CImage&& ref) noexcept :
+    CImageAttributes(ref),
+    m_shape(ref.m_shape), m_pTI(ref.m_pTI), m_bandSize(ref.m_bandSize),
+    m_pixSize(ref.m_pixSize), m_rowSize(ref.m_rowSize),
+    m_memStart(ref.m_memStart), m_memory(std::move(ref.m_memory))
+{
+    // Move constructor: ref keeps its pixel type but no longer has pixels
+    ref.m_shape    = CShape();
+    ref.m_rowSize  = 0;
+    ref.m_memStart = 0;
+}
+
+CImage& CImage::operator=(CImage&& ref) noexcept
+{
+    // Move assignment
+    if (this != &ref)
+    {
+        CImageAttributes::operator=(ref);
+        m_shape     = ref.m_shape;
+        m_pTI       = ref.m_pTI;
+        m_bandSize  = ref.m_bandSize;
+        m_pixSize   = ref.m_pixSize;
+        m_rowSize   = ref.m_rowSize;
+        m_memStart  = ref.m_memStart;
+        m_memory    = std::move(ref.m_memory);
+        ref.m_shape    = CShape();
+        ref.m_rowSize  = 0;
+        ref.m_memStart = 0;
+    }
+    return *this;
+}
+
 void CImage::ReAllocate(CShape s, const type_info& ti, int bandSize,
                         bool evenIfShapeDiffers)
 {
@@ -95,18 +129,19 @@ void CImage::ReAllocate(CShape s, const type_info& ti, int bandSize,
     m_pixSize   = m_bandSize * s.nBands;    // stride between pixels in bytes
 
     // Do the real allocation work
+    int rowAlign = ImageMemoryRowAlignment();     // (a power of 2, see ImageMemory.h)
     m_rowSize   = (rowSize) ? m_pixSize*rowSize :     // stride between rows in bytes
-                  (m_pixSize * s.width + 7) & -8;     // round up to 8 (quadwords)
+                  (m_pixSize * s.width + rowAlign - 1) & -rowAlign;
 
     int nBytes  = m_rowSize * s.height;
+    void (*deleteFunction)(void *ptr) = 0;
     if (memory == 0 && nBytes > 0)          // allocate if necessary
     {
-        memory = new double[(nBytes + 7)/ 8];
-        if (memory == 0)
-            throw CError("CImage::Reallocate: could not allocate %d bytes", nBytes);
+        memory = ImageMemoryAllocate(nBytes);   // (throws if out of memory)
+        deleteFunction = ImageMemoryRelease;    // give back to the pool
     }
     m_memStart = (char *) memory;           // start of addressable memory
-    m_memory.ReAllocate(nBytes, memory, deleteWhenDone);
+    m_memory.ReAllocate(nBytes, memory, deleteWhenDone, deleteFunction);
 }
 
 void CImage::DeAllocate()
@@ -138,6 +173,13 @@ void CImage::SetSubImage(int xO, int yO, int width, int height)
     origin[1] += y1;                            // adjust the origin
 }
 
+bool CImage::IsAligned(int alignment) const
+{
+    // Do all the rows start on a multiple of alignment (a power of 2)?
+    return ((size_t) m_memStart & (alignment - 1)) == 0 &&
+           (m_rowSize & (alignment - 1)) == 0;
+}
+
 void CImage::ClearPixels(void)
 {
     // Set all the pixels to 0
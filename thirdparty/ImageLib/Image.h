@@ -19,10 +19,22 @@
 //  "new Image" should not be used).  They can be freely returned from
 //  functions and put into other data structures.  Assignment and copy
 //  construction share memory (to copy pixel values from one image to
-//  another one, use CopyPixels()).
+//  another one, use CopyPixels()).  Moving an image (e.g., returning a
+//  local or std::move) transfers its memory without reference counting
+//  and leaves the source an empty image of the same pixel type.
+//
+//  Rows are not necessarily contiguous: the stride between them
+//  (RowStride) may include padding for alignment (see ImageMemory.h), and a
+//  sub-image keeps the stride of its parent.  Always address each row
+//  through PixelAddress or Pixel.
+//
+//  The arithmetic operators (img1 + img2 * 0.5f, Max(0.0f, img), etc.)
+//  build expressions that are evaluated in a single pass when they are
+//  assigned to an image, without temporary images (see ImageExpr.h).
 //
 // SEE ALSO
 //  Image.cpp           implementation
+//  ImageExpr.h         fused image arithmetic
 //  RefCntMem.h         reference-counted memory object used by CImage
 //
 // Copyright  Richard Szeliski, 2001.  See Copyright.h for more details
@@ -88,6 +100,30 @@ enum EBorderMode
     eBorderCyclic       = 3     // wrap pixel values
 };
 
+// Index 0 <= k < n of the pixel supplied for coordinate k (-1 for zero padding)
+
+inline int TrimIndex(int k, EBorderMode e, int n)
+{
+    while (k < 0 || k >= n)
+    {
+        switch (e)
+        {
+        case eBorderZero:       // zero padding
+            return -1;
+        case eBorderReplicate:  // replicate border values
+            return k = __max(0, __min(n-1, k));
+        case eBorderReflect:    // reflect border pixels
+            if (n == 1)
+                return 0;
+            k = (k < 0) ? -k : (k < n) ? k : 2*(n-1)-k;
+            break;              // may need to iterate if n < |k|
+        case eBorderCyclic:     // wrap pixel values
+            k = (k + n) % n;    // may need to iterate if k + n < 0
+        }
+    }
+    return k;
+}
+
 // Image attributes
 
 struct CImageAttributes
@@ -106,7 +142,11 @@ class CImage : public CImageAttributes
 public:
     CImage(void);               // default constructor
     CImage(CShape s, const type_info& ti, int bandSize);
-    // uses system-supplied copy constructor, assignment operator, and destructor
+    CImage(const CImage& ref) = default;                // shares memory
+    CImage& operator=(const CImage& ref) = default;     // shares memory
+    CImage(CImage&& ref) noexcept;                      // takes ref's memory
+    CImage& operator=(CImage&& ref) noexcept;           // takes ref's memory
+    // uses system-supplied destructor
 
     void ReAllocate(CShape s, const type_info& ti, int bandSize,
                     void *memory, bool deleteWhenDone, int rowSize);
@@ -120,6 +160,8 @@ public:
 
     void* PixelAddress(int x, int y, int band);
     const void* PixelAddress(int x, int y, int band) const;
+    int RowStride(void) const             { return m_rowSize; }   // in bytes
+    bool IsAligned(int alignment) const;  // rows start on alignment boundaries
 
     void SetSubImage(int xO, int yO, int width, int height);   // sub-image sharing memory
     void ClearPixels(void); // set all the pixels to 0
@@ -138,6 +180,9 @@ private:
 
 //  Strongly typed image
 
+template <class E>
+struct CImageExpr;      // arithmetic expression over images (ImageExpr.h)
+
 template <class T>
 class CImageOf : public CImage
 {
@@ -145,7 +190,11 @@ public:
     CImageOf(void);
     CImageOf(CShape s);
     CImageOf(int width, int height, int nBands);
-    // uses system-supplied copy constructor, assignment operator, and destructor
+    CImageOf(const CImageOf& ref) = default;
+    CImageOf& operator=(const CImageOf& ref) = default;
+    CImageOf(CImageOf&& ref) noexcept = default;
+    CImageOf& operator=(CImageOf&& ref) noexcept = default;
+    // uses system-supplied destructor
 
     void ReAllocate(CShape s, bool evenIfShapeDiffers = false);
     void ReAllocate(CShape s, T *memory, bool deleteWhenDone, int rowSize);
@@ -162,10 +211,21 @@ public:
 
     CImageOf<T>& operator-=(const T& scalar);
     CImageOf<T>& operator+=(const T& scalar);
+    CImageOf<T>& operator*=(const T& scalar);
     CImageOf<T>& operator/=(const T& scalar);
 
     CImageOf<T>& operator+=(const CImageOf<T>& other);
+    CImageOf<T>& operator-=(const CImageOf<T>& other);
+    CImageOf<T>& operator*=(const CImageOf<T>& other);
     CImageOf<T>& operator/=(const CImageOf<T>& other);
+
+    // Evaluation of arithmetic expressions (see ImageExpr.h)
+    template <class E> CImageOf(const CImageExpr<E>& expr);
+    template <class E> CImageOf<T>& operator=(const CImageExpr<E>& expr);
+    template <class E> CImageOf<T>& operator+=(const CImageExpr<E>& expr);
+    template <class E> CImageOf<T>& operator-=(const CImageExpr<E>& expr);
+    template <class E> CImageOf<T>& operator*=(const CImageExpr<E>& expr);
+    template <class E> CImageOf<T>& operator/=(const CImageExpr<E>& expr);
 };
 
 
@@ -199,5 +259,6 @@ struct CError : public exception
 
 
 #include "Image.inl"
+#include "ImageExpr.h"
 
 #endif
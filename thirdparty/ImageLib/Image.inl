@@ -106,100 +106,3 @@ CImageOf<T>::SubImage(int x, int y, int width, int height)
     retval.SetSubImage(x, y, width, height);
     return retval;
 }
-
-template <class T>
-inline
-void 
-CImageOf<T>::getRangeOfValues(T& minVal, T& maxVal) const
-{
-    minVal = MaxVal();
-    maxVal = MinVal();
-
-    CShape shape = this->Shape();
-    for(int y = 0; y < shape.height; y++) {
-        T* thisIt = (T*)this->PixelAddress(0, y, 0);
-        for(int x = 0; x < shape.width * shape.nBands; x++, thisIt++) {
-            minVal = min(minVal, *thisIt);
-            maxVal = max(maxVal, *thisIt);
-        }
-    }    
-}
-
-template <class T>
-inline
-CImageOf<T>& 
-CImageOf<T>::operator-=(const T& scalar)
-{
-    *this += -scalar;
-    return *this;
-}
-
-template <class T>
-inline
-CImageOf<T>& 
-CImageOf<T>::operator+=(const T& scalar)
-{
-    CShape shape = this->Shape();
-
-    for(int y = 0; y < shape.height; y++) {
-        T* thisIt = (T*)this->PixelAddress(0, y, 0);
-        for(int x = 0; x < shape.width * shape.nBands; x++, thisIt++) {
-            *thisIt += scalar;
-        }
-    }
-    return *this;
-}
-
-template <class T>
-inline
-CImageOf<T>& 
-CImageOf<T>::operator+=(const CImageOf<T>& other)
-{
-    if(this->Shape() != other.Shape()) throw CError("Images must have the same shape for operator+=");
-
-    CShape shape = this->Shape();
-
-    for(int y = 0; y < shape.height; y++) {
-        const T* otherIt = (const T*)other.PixelAddress(0, y, 0);
-        T* thisIt = (T*)this->PixelAddress(0, y, 0);
-        for(int x = 0; x < shape.width * shape.nBands; x++, thisIt++, otherIt++) {
-            *thisIt += *otherIt;
-        }
-    }
-    return *this;
-}
-
-template <class T>
-inline
-CImageOf<T>& 
-CImageOf<T>::operator/=(const CImageOf<T>& other)
-{
-    if(this->Shape() != other.Shape()) throw CError("Images must have the same shape for operator/=");
-
-    CShape shape = this->Shape();
-
-    for(int y = 0; y < shape.height; y++) {
-        const T* otherIt = (const T*)other.PixelAddress(0, y, 0);
-        T* thisIt = (T*)this->PixelAddress(0, y, 0);
-        for(int x = 0; x < shape.width * shape.nBands; x++, thisIt++, otherIt++) {
-            *thisIt /= *otherIt;
-        }
-    }
-    return *this;
-}
-
-template <class T>
-inline
-CImageOf<T>& 
-CImageOf<T>::operator/=(const T& scalar)
-{
-    CShape shape = this->Shape();
-
-    for(int y = 0; y < shape.height; y++) {
-        T* thisIt = (T*)this->PixelAddress(0, y, 0);
-        for(int x = 0; x < shape.width * shape.nBands; x++, thisIt++) {
-            *thisIt /= scalar;
-        }
-    }
-    return *this;
-}
@@ -0,0 +1,484 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ImageExpr.h -- lazily evaluated (fused) image arithmetic
+//
+// SPECIFICATION
+//  CImageOf<T> dst = expr;     dst = expr;
+//  dst += expr;  dst -= expr;  dst *= expr;  dst /= expr;
+//
+//  expr:  images, scalars, a + b, a - b, a * b, a / b, -a,
+//         Min(a, b), Max(a, b), Abs(a)
+//
+//  double Sum(expr);
+//  void   RangeOfValues(expr, V& minVal, V& maxVal);
+//
+// PARAMETERS
+//  dst                 destination image
+//  expr                arithmetic expression over images of one shape
+//  minVal, maxVal      smallest and largest value of expr
+//
+// DESCRIPTION
+//  The arithmetic operators on images do not compute anything: they
+//  build a small expression object that refers to the operand images.
+//  The work happens when the expression is assigned to an image (or
+//  reduced), in a single pass over the rows that evaluates the whole
+//  expression for each value, e.g.,
+//
+//      score = score + convolved - bias;
+//      CFloatImage pos = Max(0.0f, w - shift);
+//
+//  reads score, convolved and w once and writes each result once,
+//  without any intermediate images.  The inner loops only see raw row
+//  pointers and inlined operators, so they vectorize.
+//
+//  Expressions work value by value (all bands alike); the operands must
+//  all have the same shape, or CError is thrown.  A scalar is converted
+//  to the value type of the expression it is combined with, as in the
+//  scalar operators of CImageOf (so a double bias is subtracted from a
+//  float image in float).  Otherwise the usual C++ promotions apply:
+//  the sum of two uchar images is computed in int, and only converted
+//  (truncated, not clipped) when it is stored into a uchar image.
+//  Min and Max follow std::min and std::max: when the comparison fails
+//  (NaNs), they return their first argument, so Max(0.0f, x) maps NaNs
+//  to 0.  (They are capitalized so as not to collide with std::min and
+//  std::max, which Image.h brings into the global namespace.)
+//
+//  Assigning an expression gives dst freshly allocated memory of the
+//  shape of the expression (dst may appear in the expression; images
+//  that shared memory with dst are not affected), and keeps the
+//  attributes (origin, borderMode, ...) of dst.  The compound
+//  assignments update dst in place.
+//
+//  Sum adds all the values up in double precision; RangeOfValues
+//  returns the smallest and largest (NaNs are ignored).  Both keep
+//  several partial results so that their loops vectorize as well.
+//
+//  Expressions only hold references to their operand images, so they
+//  should be evaluated in the statement that builds them (don't keep
+//  one in an "auto" variable past the lifetime of its operands).
+//
+// SEE ALSO
+//  Image.h             image class definition
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGE_EXPR_H
+#define IMAGE_EXPR_H
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+//
+// Expression nodes.  Each one has a Shape(), tells whether it has one
+// (scalars don't), and returns a row object with operator[] for row y.
+//
+
+template <class E>
+struct CImageExpr
+{
+    const E& Self(void) const   { return static_cast<const E&>(*this); }
+};
+
+template <class T>
+class CImageTerm : public CImageExpr<CImageTerm<T> >
+{
+public:
+    typedef T ValueType;
+    typedef const T* Row;
+
+    explicit CImageTerm(const CImageOf<T>& img) : m_img(img) {}
+
+    bool HasShape(void) const   { return true; }
+    CShape Shape(void) const    { return m_img.Shape(); }
+    Row GetRow(int y) const     { return &m_img.Pixel(0, y, 0); }
+
+private:
+    const CImageOf<T>& m_img;
+};
+
+template <class V>
+class CScalarTerm : public CImageExpr<CScalarTerm<V> >
+{
+public:
+    typedef V ValueType;
+    struct Row
+    {
+        V v;
+        V operator[](int) const     { return v; }
+    };
+
+    explicit CScalarTerm(V v) : m_v(v) {}
+
+    bool HasShape(void) const   { return false; }
+    CShape Shape(void) const    { return CShape(); }
+    Row GetRow(int) const       { Row r = {m_v}; return r; }
+
+private:
+    V m_v;
+};
+
+template <class Op, class L, class R>
+class CBinaryExpr : public CImageExpr<CBinaryExpr<Op, L, R> >
+{
+public:
+    typedef decltype(Op::Apply(std::declval<typename L::ValueType>(),
+                               std::declval<typename R::ValueType>())) ValueType;
+    struct Row
+    {
+        typename L::Row l;
+        typename R::Row r;
+        ValueType operator[](int i) const   { return Op::Apply(l[i], r[i]); }
+    };
+
+    CBinaryExpr(const L& l, const R& r) : m_l(l), m_r(r)
+    {
+        if (l.HasShape() && r.HasShape() && l.Shape() != r.Shape())
+            throw CError("Image expression: operands have different shapes");
+    }
+
+    bool HasShape(void) const   { return m_l.HasShape() || m_r.HasShape(); }
+    CShape Shape(void) const    { return m_l.HasShape() ? m_l.Shape() : m_r.Shape(); }
+    Row GetRow(int y) const     { Row row = {m_l.GetRow(y), m_r.GetRow(y)}; return row; }
+
+private:
+    L m_l;
+    R m_r;
+};
+
+template <class Op, class E>
+class CUnaryExpr : public CImageExpr<CUnaryExpr<Op, E> >
+{
+public:
+    typedef decltype(Op::Apply(std::declval<typename E::ValueType>())) ValueType;
+    struct Row
+    {
+        typename E::Row e;
+        ValueType operator[](int i) const   { return Op::Apply(e[i]); }
+    };
+
+    explicit CUnaryExpr(const E& e) : m_e(e) {}
+
+    bool HasShape(void) const   { return m_e.HasShape(); }
+    CShape Shape(void) const    { return m_e.Shape(); }
+    Row GetRow(int y) const     { Row row = {m_e.GetRow(y)}; return row; }
+
+private:
+    E m_e;
+};
+
+struct CExprAdd { template <class A, class B> static auto Apply(A a, B b) -> decltype(a + b) { return a + b; } };
+struct CExprSub { template <class A, class B> static auto Apply(A a, B b) -> decltype(a - b) { return a - b; } };
+struct CExprMul { template <class A, class B> static auto Apply(A a, B b) -> decltype(a * b) { return a * b; } };
+struct CExprDiv { template <class A, class B> static auto Apply(A a, B b) -> decltype(a / b) { return a / b; } };
+struct CExprMin { template <class A, class B> static typename std::common_type<A, B>::type Apply(A a, B b) { return (b < a) ? b : a; } };
+struct CExprMax { template <class A, class B> static typename std::common_type<A, B>::type Apply(A a, B b) { return (a < b) ? b : a; } };
+struct CExprNeg { template <class A> static auto Apply(A a) -> decltype(-a) { return -a; } };
+struct CExprAbs { template <class A> static auto Apply(A a) -> decltype(std::abs(a)) { return std::abs(a); } };
+
+//
+// Operands: images are wrapped in a CImageTerm, expressions are used as
+// they are, and scalars become a CScalarTerm of the other operand's type
+//
+
+template <class X, class Enable = void>
+struct CExprOperand
+{
+    static const bool isExpr = false;
+};
+
+template <class T>
+struct CExprOperand<CImageOf<T> >
+{
+    static const bool isExpr = true;
+    typedef CImageTerm<T> Type;
+    static Type Make(const CImageOf<T>& x)  { return Type(x); }
+};
+
+template <class X>
+struct CExprOperand<X, typename std::enable_if<std::is_base_of<CImageExpr<X>, X>::value>::type>
+{
+    static const bool isExpr = true;
+    typedef X Type;
+    static const X& Make(const X& x)        { return x; }
+};
+
+template <class L, class R, class Enable = void>
+struct CExprOperands {};        // (neither is an image: not an image expression)
+
+template <class L, class R>
+struct CExprOperands<L, R, typename std::enable_if<CExprOperand<L>::isExpr && CExprOperand<R>::isExpr>::type>
+{
+    typedef typename CExprOperand<L>::Type LType;
+    typedef typename CExprOperand<R>::Type RType;
+    static LType MakeL(const L& l)  { return CExprOperand<L>::Make(l); }
+    static RType MakeR(const R& r)  { return CExprOperand<R>::Make(r); }
+};
+
+template <class L, class R>
+struct CExprOperands<L, R, typename std::enable_if<CExprOperand<L>::isExpr && std::is_arithmetic<R>::value>::type>
+{
+    typedef typename CExprOperand<L>::Type LType;
+    typedef CScalarTerm<typename LType::ValueType> RType;
+    static LType MakeL(const L& l)  { return CExprOperand<L>::Make(l); }
+    static RType MakeR(const R& r)  { return RType((typename LType::ValueType) r); }
+};
+
+template <class L, class R>
+struct CExprOperands<L, R, typename std::enable_if<std::is_arithmetic<L>::value && CExprOperand<R>::isExpr>::type>
+{
+    typedef typename CExprOperand<R>::Type RType;
+    typedef CScalarTerm<typename RType::ValueType> LType;
+    static LType MakeL(const L& l)  { return LType((typename RType::ValueType) l); }
+    static RType MakeR(const R& r)  { return CExprOperand<R>::Make(r); }
+};
+
+#define IMAGE_EXPR_BINARY(fn, Op)                                               \
+template <class L, class R>                                                     \
+inline CBinaryExpr<Op, typename CExprOperands<L, R>::LType,                     \
+                   typename CExprOperands<L, R>::RType>                         \
+fn(const L& l, const R& r)                                                      \
+{                                                                               \
+    typedef CExprOperands<L, R> O;                                              \
+    return CBinaryExpr<Op, typename O::LType, typename O::RType>(O::MakeL(l), O::MakeR(r)); \
+}
+
+IMAGE_EXPR_BINARY(operator+, CExprAdd)
+IMAGE_EXPR_BINARY(operator-, CExprSub)
+IMAGE_EXPR_BINARY(operator*, CExprMul)
+IMAGE_EXPR_BINARY(operator/, CExprDiv)
+IMAGE_EXPR_BINARY(Min, CExprMin)
+IMAGE_EXPR_BINARY(Max, CExprMax)
+
+#undef IMAGE_EXPR_BINARY
+
+template <class X>
+inline CUnaryExpr<CExprNeg, typename CExprOperand<X>::Type> operator-(const X& x)
+{
+    return CUnaryExpr<CExprNeg, typename CExprOperand<X>::Type>(CExprOperand<X>::Make(x));
+}
+
+template <class X>
+inline CUnaryExpr<CExprAbs, typename CExprOperand<X>::Type> Abs(const X& x)
+{
+    return CUnaryExpr<CExprAbs, typename CExprOperand<X>::Type>(CExprOperand<X>::Make(x));
+}
+
+//
+// Evaluation
+//
+
+struct CExprStore       { template <class T, class V> static void Apply(T& d, V v) { d = (T) v; } };
+struct CExprStoreAdd    { template <class T, class V> static void Apply(T& d, V v) { d = (T) (d + v); } };
+struct CExprStoreSub    { template <class T, class V> static void Apply(T& d, V v) { d = (T) (d - v); } };
+struct CExprStoreMul    { template <class T, class V> static void Apply(T& d, V v) { d = (T) (d * v); } };
+struct CExprStoreDiv    { template <class T, class V> static void Apply(T& d, V v) { d = (T) (d / v); } };
+
+// Evaluates expr into dst, which must have its shape
+template <class Store, class T, class E>
+void EvaluateImageExpr(CImageOf<T>& dst, const E& expr)
+{
+    CShape shape = dst.Shape();
+    if (expr.HasShape() && expr.Shape() != shape)
+        throw CError("Image expression: destination has a different shape");
+    int n = shape.width * shape.nBands;
+    for (int y = 0; y < shape.height; y++)
+    {
+        T* d = &dst.Pixel(0, y, 0);
+        typename E::Row row = expr.GetRow(y);
+        for (int i = 0; i < n; i++)
+            Store::Apply(d[i], row[i]);
+    }
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>::CImageOf(const CImageExpr<E>& expr) : CImageOf()
+{
+    *this = expr;
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>& CImageOf<T>::operator=(const CImageExpr<E>& expr)
+{
+    CImageOf<T> result(expr.Self().Shape());
+    EvaluateImageExpr<CExprStore>(result, expr.Self());
+    (CImageAttributes&) result = *this;     // dst keeps its origin, etc.
+    return *this = std::move(result);
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>& CImageOf<T>::operator+=(const CImageExpr<E>& expr)
+{
+    EvaluateImageExpr<CExprStoreAdd>(*this, expr.Self());
+    return *this;
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>& CImageOf<T>::operator-=(const CImageExpr<E>& expr)
+{
+    EvaluateImageExpr<CExprStoreSub>(*this, expr.Self());
+    return *this;
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>& CImageOf<T>::operator*=(const CImageExpr<E>& expr)
+{
+    EvaluateImageExpr<CExprStoreMul>(*this, expr.Self());
+    return *this;
+}
+
+template <class T>
+template <class E>
+inline CImageOf<T>& CImageOf<T>::operator/=(const CImageExpr<E>& expr)
+{
+    EvaluateImageExpr<CExprStoreDiv>(*this, expr.Self());
+    return *this;
+}
+
+// The scalar and image versions are single-term expressions
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator+=(const T& scalar)
+{
+    EvaluateImageExpr<CExprStoreAdd>(*this, CScalarTerm<T>(scalar));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator-=(const T& scalar)
+{
+    EvaluateImageExpr<CExprStoreSub>(*this, CScalarTerm<T>(scalar));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator*=(const T& scalar)
+{
+    EvaluateImageExpr<CExprStoreMul>(*this, CScalarTerm<T>(scalar));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator/=(const T& scalar)
+{
+    EvaluateImageExpr<CExprStoreDiv>(*this, CScalarTerm<T>(scalar));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator+=(const CImageOf<T>& other)
+{
+    EvaluateImageExpr<CExprStoreAdd>(*this, CImageTerm<T>(other));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator-=(const CImageOf<T>& other)
+{
+    EvaluateImageExpr<CExprStoreSub>(*this, CImageTerm<T>(other));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator*=(const CImageOf<T>& other)
+{
+    EvaluateImageExpr<CExprStoreMul>(*this, CImageTerm<T>(other));
+    return *this;
+}
+
+template <class T>
+inline CImageOf<T>& CImageOf<T>::operator/=(const CImageOf<T>& other)
+{
+    EvaluateImageExpr<CExprStoreDiv>(*this, CImageTerm<T>(other));
+    return *this;
+}
+
+//
+// Reductions
+//
+
+static const int imageExprLanes = 8;    // partial results kept by the reductions
+
+// Updates minVal and maxVal with the values of expr
+template <class E, class V>
+void AccumulateRangeOfValues(const E& expr, V& minVal, V& maxVal)
+{
+    CShape shape = expr.Shape();
+    int n = shape.width * shape.nBands;
+    V lo[imageExprLanes], hi[imageExprLanes];
+    for (int k = 0; k < imageExprLanes; k++)
+        lo[k] = minVal, hi[k] = maxVal;
+    for (int y = 0; y < shape.height; y++)
+    {
+        typename E::Row row = expr.GetRow(y);
+        int i = 0;
+        for (; i + imageExprLanes <= n; i += imageExprLanes)
+            for (int k = 0; k < imageExprLanes; k++)
+            {
+                V v = (V) row[i + k];
+                lo[k] = (v < lo[k]) ? v : lo[k];
+                hi[k] = (hi[k] < v) ? v : hi[k];
+            }
+        for (; i < n; i++)
+        {
+            V v = (V) row[i];
+            lo[0] = (v < lo[0]) ? v : lo[0];
+            hi[0] = (hi[0] < v) ? v : hi[0];
+        }
+    }
+    for (int k = 0; k < imageExprLanes; k++)
+    {
+        minVal = (lo[k] < minVal) ? lo[k] : minVal;
+        maxVal = (maxVal < hi[k]) ? hi[k] : maxVal;
+    }
+}
+
+template <class X, class V>
+void RangeOfValues(const X& x, V& minVal, V& maxVal)
+{
+    minVal = std::numeric_limits<V>::max();
+    maxVal = std::numeric_limits<V>::lowest();
+    AccumulateRangeOfValues(CExprOperand<X>::Make(x), minVal, maxVal);
+}
+
+template <class X>
+double Sum(const X& x)
+{
+    typedef typename CExprOperand<X>::Type E;
+    const E& expr = CExprOperand<X>::Make(x);
+    CShape shape = expr.Shape();
+    int n = shape.width * shape.nBands;
+    double sum[imageExprLanes] = {0};
+    for (int y = 0; y < shape.height; y++)
+    {
+        typename E::Row row = expr.GetRow(y);
+        int i = 0;
+        for (; i + imageExprLanes <= n; i += imageExprLanes)
+            for (int k = 0; k < imageExprLanes; k++)
+                sum[k] += (double) row[i + k];
+        for (; i < n; i++)
+            sum[0] += (double) row[i];
+    }
+    double total = 0;
+    for (int k = 0; k < imageExprLanes; k++)
+        total += sum[k];
+    return total;
+}
+
+template <class T>
+inline void CImageOf<T>::getRangeOfValues(T& minVal, T& maxVal) const
+{
+    minVal = MaxVal();
+    maxVal = MinVal();
+    AccumulateRangeOfValues(CImageTerm<T>(*this), minVal, maxVal);
+}
+
+#endif // IMAGE_EXPR_H
@@ -10,10 +10,17 @@
 #include <vector>
 
 #include "Image.h"
+#include "ImageMemory.h"
 #include "FileIO.h"
 #include "Convert.h"
+#include "ConvertLine.h"
+#include "ColorConvert.h"
 #include "Transform.h"
 #include "WarpImage.h"
+#include "Resize.h"
 #include "Convolve.h"
 #include "Pyramid.h"
 #include "ImageProc.h"
+#include "IntegralImage.h"
+#include "Smooth.h"
+#include "Parallel.h"
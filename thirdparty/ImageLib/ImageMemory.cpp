@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ImageMemory.cpp -- pooled allocator for image pixel memory
+//
+// DESIGN NOTES
+//  Blocks are over-allocated from malloc and the returned pointer is
+//  rounded up to imageMemoryAlignment.  Just below it sits a small header
+//  holding the block's size, so that ImageMemoryRelease (which only gets
+//  the pointer from CRefCntMem) knows which free list to put it on, and
+//  the pointer malloc returned.
+//
+//  The free lists live in a thread_local object.  Images can outlive it
+//  (e.g., function-local statics are destroyed after the main thread's
+//  thread_local objects), so its destructor leaves a flag behind and any
+//  later release goes straight back to the system.
+//
+// SEE ALSO
+//  ImageMemory.h       longer description
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "ImageMemory.h"
+#include "Image.h"
+#include <stdlib.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct CBlockHeader
+{
+    void *base;             // pointer returned by malloc
+    int nBytes;             // usable size of the block
+};
+
+std::atomic<long long> g_systemAllocs(0);
+std::atomic<long long> g_poolHits(0);
+std::atomic<long long> g_systemFrees(0);
+std::atomic<long long> g_cachedBytes(0);
+std::atomic<long long> g_poolLimit(64 << 20);
+std::atomic<int> g_rowAlignment(8);      // quadwords, padding to 64 is opt-in
+
+inline CBlockHeader* Header(char *block)
+{
+    return (CBlockHeader *) block - 1;
+}
+
+void FreeBlock(char *block)
+{
+    g_systemFrees.fetch_add(1, std::memory_order_relaxed);
+    free(Header(block)->base);
+}
+
+struct CFreeLists
+{
+    std::unordered_map<int, std::vector<char *> > lists;    // blocks by size
+    long long nBytes;                                       // bytes in lists
+
+    CFreeLists() : nBytes(0) {}
+    ~CFreeLists();
+    void Trim();
+};
+
+thread_local CFreeLists *t_freeLists = 0;
+thread_local bool t_freeListsGone = false;
+
+CFreeLists::~CFreeLists()
+{
+    Trim();
+    t_freeLists = 0;
+    t_freeListsGone = true;
+}
+
+void CFreeLists::Trim()
+{
+    for (auto& list : lists)
+        for (char *block : list.second)
+            FreeBlock(block);
+    lists.clear();
+    g_cachedBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+    nBytes = 0;
+}
+
+CFreeLists* ThreadFreeLists()
+{
+    if (t_freeLists == 0 && ! t_freeListsGone)
+    {
+        static thread_local CFreeLists freeLists;
+        t_freeLists = &freeLists;
+    }
+    return t_freeLists;
+}
+
+}
+
+void* ImageMemoryAllocate(int nBytes)
+{
+    CFreeLists *fl = ThreadFreeLists();
+    if (fl)
+    {
+        auto it = fl->lists.find(nBytes);
+        if (it != fl->lists.end() && ! it->second.empty())
+        {
+            char *block = it->second.back();
+            it->second.pop_back();
+            fl->nBytes -= nBytes;
+            g_cachedBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+            g_poolHits.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+
+    const size_t extra = sizeof(CBlockHeader) + imageMemoryAlignment - 1;
+    char *base = (char *) malloc(extra + (size_t) nBytes);
+    if (base == 0)
+        throw CError("ImageMemoryAllocate: could not allocate %d bytes", nBytes);
+    char *block = (char *) (((size_t) base + extra) & ~(size_t) (imageMemoryAlignment - 1));
+    Header(block)->base   = base;
+    Header(block)->nBytes = nBytes;
+    g_systemAllocs.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+void ImageMemoryRelease(void *memory)
+{
+    if (memory == 0)
+        return;
+    char *block = (char *) memory;
+    int nBytes = Header(block)->nBytes;
+
+    CFreeLists *fl = ThreadFreeLists();
+    if (fl == 0 || fl->nBytes + nBytes > g_poolLimit.load(std::memory_order_relaxed))
+    {
+        FreeBlock(block);
+        return;
+    }
+    fl->lists[nBytes].push_back(block);
+    fl->nBytes += nBytes;
+    g_cachedBytes.fetch_add(nBytes, std::memory_order_relaxed);
+}
+
+CImageMemoryStats ImageMemoryStats()
+{
+    CImageMemoryStats stats;
+    stats.systemAllocs = g_systemAllocs.load(std::memory_order_relaxed);
+    stats.poolHits     = g_poolHits.load(std::memory_order_relaxed);
+    stats.systemFrees  = g_systemFrees.load(std::memory_order_relaxed);
+    stats.cachedBytes  = g_cachedBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ImageMemorySetPoolLimit(long long nBytesPerThread)
+{
+    g_poolLimit.store(nBytesPerThread, std::memory_order_relaxed);
+}
+
+void ImageMemoryTrim()
+{
+    CFreeLists *fl = ThreadFreeLists();
+    if (fl)
+        fl->Trim();
+}
+
+int ImageMemoryRowAlignment()
+{
+    return g_rowAlignment.load(std::memory_order_relaxed);
+}
+
+void ImageMemorySetRowAlignment(int alignment)
+{
+    if (alignment < 8 || alignment > imageMemoryAlignment || (alignment & (alignment - 1)))
+        throw CError("ImageMemorySetRowAlignment: invalid alignment %d", alignment);
+    g_rowAlignment.store(alignment, std::memory_order_relaxed);
+}
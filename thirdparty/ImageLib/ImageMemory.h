@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ImageMemory.h -- pooled allocator for image pixel memory
+//
+// SPECIFICATION
+//  void* ImageMemoryAllocate(int nBytes);
+//  void  ImageMemoryRelease(void *memory);
+//
+//  CImageMemoryStats ImageMemoryStats(void);
+//  void ImageMemorySetPoolLimit(long long nBytesPerThread);
+//  void ImageMemoryTrim(void);
+//
+//  int  ImageMemoryRowAlignment(void);
+//  void ImageMemorySetRowAlignment(int alignment);
+//
+// PARAMETERS
+//  nBytes              size of the requested block
+//  memory              block returned by ImageMemoryAllocate
+//  nBytesPerThread     maximum number of bytes kept in each thread's
+//                      free lists (0 disables pooling)
+//  alignment           row stride multiple for newly allocated images
+//                      (a power of two, 8 .. imageMemoryAlignment)
+//
+// DESCRIPTION
+//  CImage::ReAllocate draws its pixel memory from ImageMemoryAllocate and
+//  hands ImageMemoryRelease to CRefCntMem as the delete function, so a
+//  block goes back to the pool as soon as the last image sharing it is
+//  gone.
+//
+//  Released blocks are kept in free lists of the releasing thread, keyed
+//  by their exact size (i.e., by image shape and type, since that is all
+//  the size depends on).  A thread that processes many images of the
+//  same shape in a loop, such as batch feature extraction, therefore
+//  reuses the same few blocks and stops calling the system allocator
+//  after the first iteration.  No locking is involved; a block may be
+//  released by a different thread than the one that allocated it.
+//
+//  Every block starts on an imageMemoryAlignment (64) byte boundary, i.e.,
+//  on a cache line.  CImage::ReAllocate rounds the row stride of the
+//  images it allocates up to a multiple of ImageMemoryRowAlignment()
+//  bytes.  The default of 8 (quadwords, as ImageLib always did) adds at
+//  most 7 bytes per row.  Cache line padding is opt-in: a program whose
+//  kernels gain from every row starting on a cache line can set the row
+//  alignment to 64 around the allocations that benefit, at the cost of
+//  memory on narrow images and of a copy wherever the pixels are needed
+//  as one array.  Use CImage::IsAligned to check whether a given image
+//  (which may be a sub-image or wrap external memory) qualifies for an
+//  aligned code path.
+//
+//  The counters returned by ImageMemoryStats are process-wide.  Blocks
+//  that would push a thread's free lists above the pool limit are
+//  returned to the system, as is everything a thread holds when it exits
+//  or calls ImageMemoryTrim.
+//
+// SEE ALSO
+//  ImageMemory.cpp     implementation
+//  RefCntMem.h         reference counted memory that releases the blocks
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGE_MEMORY_H
+#define IMAGE_MEMORY_H
+
+static const int imageMemoryAlignment = 64;     // block alignment in bytes
+
+struct CImageMemoryStats
+{
+    long long systemAllocs;     // blocks obtained from the system allocator
+    long long poolHits;         // allocations served from a free list
+    long long systemFrees;      // blocks given back to the system allocator
+    long long cachedBytes;      // bytes currently held in free lists
+};
+
+void* ImageMemoryAllocate(int nBytes);
+void  ImageMemoryRelease(void *memory);
+
+CImageMemoryStats ImageMemoryStats(void);
+void ImageMemorySetPoolLimit(long long nBytesPerThread);
+void ImageMemoryTrim(void);
+
+int  ImageMemoryRowAlignment(void);
+void ImageMemorySetRowAlignment(int alignment);
+
+#endif // IMAGE_MEMORY_H
@@ -1,4 +1,5 @@
 #include "ImageProc.h"
+#include "ConvertLine.h"
 
 //
 // Miscellaneous utility routines
@@ -121,6 +122,33 @@ void TypeConvertTyped(const T1* src, T2* dst, int n,
     }
 }
 
+// The uchar and float combinations use the vectorized kernels (which
+// produce the same results)
+
+inline void TypeConvertTyped(const uchar* src, uchar* dst, int n, float scale, float offset,
+                             uchar minVal, uchar maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void TypeConvertTyped(const uchar* src, float* dst, int n, float scale, float offset,
+                             float minVal, float maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void TypeConvertTyped(const float* src, uchar* dst, int n, float scale, float offset,
+                             uchar minVal, uchar maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
+inline void TypeConvertTyped(const float* src, float* dst, int n, float scale, float offset,
+                             float minVal, float maxVal)
+{
+    ConvertLine(src, dst, n, scale, offset, minVal, maxVal);
+}
+
 // template <class T1, class T2>
 // void
 // TypeConvertLine(const T1* src, T2* dst,
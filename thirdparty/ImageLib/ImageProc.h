@@ -3,6 +3,9 @@
 #define IMAGE_PROC_H
 
 #include "Image.h"
+#include "Parallel.h"
+#include <string.h>
+#include <vector>
 
 //
 // Type and band conversion routines
@@ -48,6 +51,318 @@ void NeighborhoodProcessSeparable(CImage& src, CImage& dst, void* dataPtr,
                                           void* p1, int b1,
                                           void* p2, int b2));
 
+//
+// Templated point and neighborhood processing
+//
+//  Unlike the routines above, these take a functor (or lambda) that the
+//  compiler can inline, and run it over raw row pointers, so that simple
+//  per-pixel operations vectorize:
+//
+//  PointProcess(img, fn)               img(x,y,b) = fn(img(x,y,b))
+//  PointProcess(src, dst, fn)          dst(x,y,b) = fn(src(x,y,b))
+//  PointProcess(src1, src2, dst, fn)   dst(x,y,b) = fn(src1(x,y,b), src2(x,y,b))
+//
+//  NeighborhoodProcess(src, dst, halfWidth, halfHeight, fn)
+//      dst(x,y,b) = fn(nbhd), where nbhd(dx,dy) == src(x+dx,y+dy,b)
+//      for |dx| <= halfWidth and |dy| <= halfHeight
+//
+//  NeighborhoodProcessSeparable<A>(src, dst, halfWidth, halfHeight, fx, fy)
+//      tmp(x,y,b) = fx(nbhd), where nbhd(dx,0) == src(x+dx,y,b), then
+//      dst(x,y,b) = fy(nbhd), where nbhd(0,dy) == tmp(x,y+dy,b);  tmp has
+//      pixel type A (float unless given) and only 2*halfHeight+1 of its
+//      rows exist at any time
+//
+//  The results are cast to the pixel type of dst (the functors have to do
+//  any clipping), and dst is (re)allocated to the shape of src.  Pixels
+//  outside src are supplied according to src.borderMode (for the
+//  separable version, in both passes).  This is done once per source row,
+//  when the row is copied into a padded buffer, so the inner loops do no
+//  bounds checking.  The neighborhood routines work from a copy of src if
+//  dst shares its memory.
+//
+//  With parallel == true, bands of rows are processed by the threads of
+//  the pool in Parallel.h, so the functors must be safe to call
+//  concurrently.
+//
+
+template <class T>
+struct CNeighborhood
+{
+    const T* const* rows;   // rows[dy] is source row y+dy (padded)
+    int nBands;             // distance between horizontal neighbors
+    int index;              // current value, x * nBands + band
+
+    T operator()(int dx, int dy) const  { return rows[dy][index + dx * nBands]; }
+};
+
+//  Padded source rows, looked up by (border-resolved) source row index, so
+//  that each one is prepared once even though several output rows use it.
+template <class T>
+class CRowCache
+{
+public:
+    CRowCache(int nRows, int rowLength) :
+        m_tag(nRows, -1), m_buf(nRows * rowLength), m_rowLength(rowLength) {}
+
+    // Returns the slot holding row sy, or a free slot (fill = true) not used
+    // by any of the rows in needed[0..nNeeded)
+    T* Lookup(int sy, const int* needed, int nNeeded, bool& fill)
+    {
+        int n = (int) m_tag.size();
+        for (int i = 0; i < n; i++)
+            if (m_tag[i] == sy)
+            {
+                fill = false;
+                return &m_buf[i * m_rowLength];
+            }
+        for (int i = 0; i < n; i++)
+        {
+            bool inUse = false;
+            for (int k = 0; k < nNeeded; k++)
+                inUse |= (m_tag[i] >= 0 && m_tag[i] == needed[k]);
+            if (! inUse)
+            {
+                m_tag[i] = sy;
+                fill = true;
+                return &m_buf[i * m_rowLength];
+            }
+        }
+        throw CError("CRowCache: row cache is too small");
+    }
+
+private:
+    std::vector<int> m_tag;
+    std::vector<T> m_buf;
+    int m_rowLength;
+};
+
+// Calls fn(yBegin, yEnd) on all the rows, split across threads if parallel
+template <class F>
+void ProcessRows(int height, int rowLength, bool parallel, F fn)
+{
+    if (parallel)
+        ParallelFor(0, height, fn, __max(1, (1 << 15) / __max(1, rowLength)));
+    else if (height > 0)
+        fn(0, height);
+}
+
+template <class T, class F>
+void PointProcess(CImageOf<T>& img, F fn, bool parallel = false)
+{
+    CShape sh = img.Shape();
+    int n = sh.width * sh.nBands;
+    ProcessRows(sh.height, n, parallel, [&](int yBegin, int yEnd)
+    {
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            T* p = &img.Pixel(0, y, 0);
+            for (int i = 0; i < n; i++)
+                p[i] = (T) fn(p[i]);
+        }
+    });
+}
+
+template <class T1, class T2, class F>
+void PointProcess(const CImageOf<T1>& src, CImageOf<T2>& dst, F fn, bool parallel = false)
+{
+    CShape sh = src.Shape();
+    dst.ReAllocate(sh);
+    int n = sh.width * sh.nBands;
+    ProcessRows(sh.height, n, parallel, [&](int yBegin, int yEnd)
+    {
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            const T1* s = &src.Pixel(0, y, 0);
+            T2* d = &dst.Pixel(0, y, 0);
+            for (int i = 0; i < n; i++)
+                d[i] = (T2) fn(s[i]);
+        }
+    });
+}
+
+template <class T1, class T2, class T3, class F>
+void PointProcess(const CImageOf<T1>& src1, const CImageOf<T2>& src2, CImageOf<T3>& dst,
+                  F fn, bool parallel = false)
+{
+    CShape sh = src1.Shape();
+    if (src2.Shape() != sh)
+        throw CError("PointProcess: source images have different shapes");
+    dst.ReAllocate(sh);
+    int n = sh.width * sh.nBands;
+    ProcessRows(sh.height, n, parallel, [&](int yBegin, int yEnd)
+    {
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            const T1* s1 = &src1.Pixel(0, y, 0);
+            const T2* s2 = &src2.Pixel(0, y, 0);
+            T3* d = &dst.Pixel(0, y, 0);
+            for (int i = 0; i < n; i++)
+                d[i] = (T3) fn(s1[i], s2[i]);
+        }
+    });
+}
+
+// Copies a source row into buf, with pad extra pixels on either side
+// supplied according to border
+template <class T>
+void FillBorderRow(T* buf, const T* srcRow, int width, int nB, int pad, EBorderMode border)
+{
+    memcpy(buf + pad * nB, srcRow, width * nB * sizeof(T));
+    for (int x = -pad; x < width + pad; x++)
+    {
+        if (x == 0)
+            x = width;      // skip the interior
+        if (x >= width + pad)
+            break;
+        T* p = buf + (x + pad) * nB;
+        int sx = TrimIndex(x, border, width);
+        for (int b = 0; b < nB; b++)
+            p[b] = (sx < 0) ? T(0) : srcRow[sx * nB + b];
+    }
+}
+
+// Returns src, or a copy of it if dst shares its pixels
+template <class T1, class T2>
+CImageOf<T1> UnaliasedSource(const CImageOf<T1>& src, const CImageOf<T2>& dst)
+{
+    CShape sh = src.Shape();
+    if (sh.width * sh.height * sh.nBands == 0 || dst.Shape() != sh ||
+        dst.PixelAddress(0, 0, 0) != src.PixelAddress(0, 0, 0))
+        return src;
+    CImageOf<T1> copy(sh);
+    for (int y = 0; y < sh.height; y++)
+        memcpy(&copy.Pixel(0, y, 0), &src.Pixel(0, y, 0), sh.width * sh.nBands * sizeof(T1));
+    copy.borderMode = src.borderMode;
+    return copy;
+}
+
+template <class T1, class T2, class F>
+void NeighborhoodProcess(const CImageOf<T1>& src_, CImageOf<T2>& dst,
+                         int halfWidth, int halfHeight, F fn, bool parallel = false)
+{
+    CImageOf<T1> src = UnaliasedSource(src_, dst);
+    CShape sh = src.Shape();
+    dst.ReAllocate(sh);
+    if (sh.width * sh.height * sh.nBands == 0)
+        return;
+
+    int nB = sh.nBands;
+    int n  = sh.width * nB;
+    int kH = 2 * halfHeight + 1;
+    int rowLength = (sh.width + 2 * halfWidth) * nB;
+    EBorderMode border = src.borderMode;
+
+    ProcessRows(sh.height, n * kH, parallel, [&](int yBegin, int yEnd)
+    {
+        CRowCache<T1> cache(kH, rowLength);
+        std::vector<T1> zeroRow(rowLength, T1(0));
+        std::vector<int> needed(kH);
+        std::vector<const T1*> rows(kH);
+        CNeighborhood<T1> nbhd;
+        nbhd.rows = &rows[halfHeight];
+        nbhd.nBands = nB;
+
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            for (int k = 0; k < kH; k++)
+            {
+                int sy = y - halfHeight + k;
+                needed[k] = (sy >= 0 && sy < sh.height) ? sy : TrimIndex(sy, border, sh.height);
+            }
+            for (int k = 0; k < kH; k++)
+            {
+                bool fill = false;
+                const T1* row = (needed[k] < 0) ? &zeroRow[0] :
+                                cache.Lookup(needed[k], &needed[0], kH, fill);
+                if (fill)
+                    FillBorderRow((T1*) row, &src.Pixel(0, needed[k], 0),
+                                  sh.width, nB, halfWidth, border);
+                rows[k] = row + halfWidth * nB;
+            }
+
+            T2* d = &dst.Pixel(0, y, 0);
+            for (int i = 0; i < n; i++)
+            {
+                nbhd.index = i;
+                d[i] = (T2) fn(nbhd);
+            }
+        }
+    });
+}
+
+template <class A = float, class T1, class T2, class FX, class FY>
+void NeighborhoodProcessSeparable(const CImageOf<T1>& src_, CImageOf<T2>& dst,
+                                  int halfWidth, int halfHeight, FX fx, FY fy,
+                                  bool parallel = false)
+{
+    CImageOf<T1> src = UnaliasedSource(src_, dst);
+    CShape sh = src.Shape();
+    dst.ReAllocate(sh);
+    if (sh.width * sh.height * sh.nBands == 0)
+        return;
+
+    int nB = sh.nBands;
+    int n  = sh.width * nB;
+    int kH = 2 * halfHeight + 1;
+    EBorderMode border = src.borderMode;
+
+    ProcessRows(sh.height, n * kH, parallel, [&](int yBegin, int yEnd)
+    {
+        std::vector<T1> padded((sh.width + 2 * halfWidth) * nB);
+        CRowCache<A> cache(kH, n);          // horizontally filtered rows
+        std::vector<A> zeroRow(n, A(0));
+        std::vector<int> needed(kH);
+        std::vector<const A*> rows(kH);
+        const T1* paddedRow = &padded[halfWidth * nB];
+        CNeighborhood<T1> hNbhd;
+        hNbhd.rows = &paddedRow;
+        hNbhd.nBands = nB;
+        CNeighborhood<A> vNbhd;
+        vNbhd.rows = &rows[halfHeight];
+        vNbhd.nBands = nB;
+
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            for (int k = 0; k < kH; k++)
+            {
+                int sy = y - halfHeight + k;
+                needed[k] = (sy >= 0 && sy < sh.height) ? sy : TrimIndex(sy, border, sh.height);
+            }
+
+            // Horizontal pass over the rows that are not cached yet
+            for (int k = 0; k < kH; k++)
+            {
+                if (needed[k] < 0)
+                {
+                    rows[k] = &zeroRow[0];
+                    continue;
+                }
+                bool fill;
+                A* row = cache.Lookup(needed[k], &needed[0], kH, fill);
+                if (fill)
+                {
+                    FillBorderRow(&padded[0], &src.Pixel(0, needed[k], 0),
+                                  sh.width, nB, halfWidth, border);
+                    for (int i = 0; i < n; i++)
+                    {
+                        hNbhd.index = i;
+                        row[i] = (A) fx(hNbhd);
+                    }
+                }
+                rows[k] = row;
+            }
+
+            // Vertical pass
+            T2* d = &dst.Pixel(0, y, 0);
+            for (int i = 0; i < n; i++)
+            {
+                vNbhd.index = i;
+                d[i] = (T2) fy(vNbhd);
+            }
+        }
+    });
+}
+
 //
 // Miscellaneous utility routines
 //
@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  IntegralImage.cpp -- summed-area tables for constant time box sums
+//
+// DESIGN NOTES
+//  A row prefix sum is one long chain of dependent additions, which
+//  cannot be vectorized without changing the order of the additions (and
+//  hence the rounding of double sums).  Instead, double sums are computed
+//  for four rows in the same loop, so that four independent chains are in
+//  flight (a double addition takes several cycles; integer additions take
+//  one, and more streams only slow them down).  Serially, the sums of the
+//  row above are added in that same loop, in the shadow of the chains, so
+//  the table is written in a single pass, which is what bounds its speed.
+//
+//  In parallel, the rows are split among the threads, which only compute
+//  the row prefix sums; the column pass, adding each row of sums to the
+//  one below, is then split by column strips.  It is a plain vectorized
+//  loop compiled for several instruction sets (Vectorize.h).  Both ways
+//  perform the same additions in the same order, so the results agree
+//  bit for bit.
+//
+//  Boxes that leave the image are decomposed along each axis into runs
+//  of source columns (rows), each with a multiplicity: a replicated
+//  border is a single run of the edge column repeated, reflected and
+//  cyclic borders are runs of at most one image width.  The box sum is
+//  then the weighted sum of the rectangles formed by pairs of runs.
+//
+// SEE ALSO
+//  IntegralImage.h     longer description
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "ImageMemory.h"
+#include "IntegralImage.h"
+#include "Parallel.h"
+#include "Vectorize.h"
+#include <limits.h>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+template <bool squared, class S, class T>
+IMAGELIB_INLINE S SumValue(T v)
+{
+    return squared ? S(v) * S(v) : S(v);
+}
+
+// Sums of R rows of nB band pixels: the prefix sum of src[r] along the
+// row, plus (if above is given) the sums of the previous row
+template <bool squared, int nB, int R, class T, class S>
+IMAGELIB_INLINE void IntegralRows(const T* const* src, const S* above, S* const* dst, int width)
+{
+    S acc[R][nB];
+    for (int r = 0; r < R; r++)
+        for (int b = 0; b < nB; b++)
+            acc[r][b] = 0;
+    for (int x = 0; x < width; x++)
+        for (int r = 0; r < R; r++)
+            for (int b = 0; b < nB; b++)
+            {
+                int i = x * nB + b;
+                acc[r][b] += SumValue<squared, S>(src[r][i]);
+                if (above)
+                    dst[r][i] = ((r > 0) ? dst[r - 1][i] : above[i]) + acc[r][b];
+                else
+                    dst[r][i] = acc[r][b];
+            }
+}
+
+// Same, for one row with any number of bands
+template <bool squared, class T, class S>
+void IntegralRow(const T* src, const S* above, S* dst, int width, int nBands)
+{
+    int n = width * nBands;
+    for (int b = 0; b < nBands; b++)
+    {
+        S acc = 0;
+        for (int i = b; i < n; i += nBands)
+        {
+            acc += SumValue<squared, S>(src[i]);
+            dst[i] = (above) ? above[i] + acc : acc;
+        }
+    }
+}
+
+template <bool squared, int nB, class T, class S>
+void IntegralRowRange(const CImageOf<T>& src, CIntegralImageOf<S>& dst, int y0, int y1,
+                      bool addAbove)
+{
+    // Row y of src goes to row y + 1 of dst, from column 1 on
+    const int R = std::is_floating_point<S>::value ? 4 : 1;
+    int y = y0;
+    for (; y + R <= y1; y += R)
+    {
+        const T* s[R];
+        S* d[R];
+        for (int r = 0; r < R; r++)
+        {
+            s[r] = &src.Pixel(0, y + r, 0);
+            d[r] = dst.RowAddress(y + r + 1) + nB;
+        }
+        const S* above = (addAbove) ? dst.RowAddress(y) + nB : 0;
+        IntegralRows<squared, nB, R>(s, above, d, src.Shape().width);
+    }
+    for (; y < y1; y++)
+    {
+        const T* s = &src.Pixel(0, y, 0);
+        S* d = dst.RowAddress(y + 1) + nB;
+        const S* above = (addAbove) ? dst.RowAddress(y) + nB : 0;
+        IntegralRows<squared, nB, 1>(&s, above, &d, src.Shape().width);
+    }
+}
+
+// Computes rows y0 + 1 .. y1 of dst, either completely (addAbove) or
+// just the row prefix sums (the column pass is left to the caller)
+template <bool squared, class T, class S>
+void IntegralRowRange(const CImageOf<T>& src, CIntegralImageOf<S>& dst, int y0, int y1,
+                      bool addAbove)
+{
+    CShape shape = src.Shape();
+    switch (shape.nBands)
+    {
+    case 1:
+        IntegralRowRange<squared, 1>(src, dst, y0, y1, addAbove);
+        break;
+    case 3:
+        IntegralRowRange<squared, 3>(src, dst, y0, y1, addAbove);
+        break;
+    case 4:
+        IntegralRowRange<squared, 4>(src, dst, y0, y1, addAbove);
+        break;
+    default:
+        for (int y = y0; y < y1; y++)
+            IntegralRow<squared>(&src.Pixel(0, y, 0),
+                                 (addAbove) ? dst.RowAddress(y) + shape.nBands : 0,
+                                 dst.RowAddress(y + 1) + shape.nBands, shape.width, shape.nBands);
+    }
+}
+
+// row[i] += above[i]
+template <class S>
+IMAGELIB_INLINE void AddRowRun(const S* __restrict above, S* __restrict row, ptrdiff_t n)
+{
+    for (ptrdiff_t i = 0; i < n; i++)
+        row[i] += above[i];
+}
+
+IMAGELIB_TARGET_CLONES
+void AddRow(const uint32_t* above, uint32_t* row, ptrdiff_t n) { AddRowRun(above, row, n); }
+
+IMAGELIB_TARGET_CLONES
+void AddRow(const uint64_t* above, uint64_t* row, ptrdiff_t n) { AddRowRun(above, row, n); }
+
+IMAGELIB_TARGET_CLONES
+void AddRow(const double* above, double* row, ptrdiff_t n) { AddRowRun(above, row, n); }
+
+template <bool squared, class T, class S>
+void ComputeIntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst, bool parallel)
+{
+    CShape shape = src.Shape();
+    dst.ReAllocate(shape);
+    dst.borderMode = src.borderMode;
+    int height = shape.height;
+    ptrdiff_t n = (ptrdiff_t) shape.width * shape.nBands + shape.nBands;   // (including column 0)
+
+    if (! parallel || ParallelNumThreads() <= 1)
+    {
+        IntegralRowRange<squared>(src, dst, 0, height, true);
+        return;
+    }
+
+    ParallelFor(0, height, [&](int y0, int y1) {
+        IntegralRowRange<squared>(src, dst, y0, y1, false);
+    }, 16);
+
+    // Column strips of whole cache lines
+    const ptrdiff_t strip = 1024;
+    int nStrips = (int) ((n + strip - 1) / strip);
+    ParallelFor(0, nStrips, [&](int s0, int s1) {
+        ptrdiff_t i0 = s0 * strip, i1 = __min(s1 * strip, n);
+        for (int y = 0; y < height; y++)
+            AddRow(dst.RowAddress(y) + i0, dst.RowAddress(y + 1) + i0, i1 - i0);
+    });
+}
+
+// Run of source coordinates [start, end) that is summed mult times
+struct CAxisRun
+{
+    int start, end;
+    int mult;
+};
+
+// Splits [lo, hi) into runs of source coordinates 0 <= k < n
+void AxisRuns(int lo, int hi, int n, EBorderMode mode, std::vector<CAxisRun>& runs)
+{
+    runs.clear();
+    if (lo >= hi || n <= 0)
+        return;
+    if (mode == eBorderZero || mode == eBorderReplicate)
+    {
+        int inLo = __max(lo, 0), inHi = __min(hi, n);
+        if (mode == eBorderReplicate && lo < 0)
+        {
+            CAxisRun run = {0, 1, __min(hi, 0) - lo};
+            runs.push_back(run);
+        }
+        if (inLo < inHi)
+        {
+            CAxisRun run = {inLo, inHi, 1};
+            runs.push_back(run);
+        }
+        if (mode == eBorderReplicate && hi > n)
+        {
+            CAxisRun run = {n - 1, n, hi - __max(lo, n)};
+            runs.push_back(run);
+        }
+        return;
+    }
+    if (mode == eBorderReflect && n == 1)
+    {
+        CAxisRun run = {0, 1, hi - lo};
+        runs.push_back(run);
+        return;
+    }
+
+    // Reflected and cyclic coordinates repeat with this period
+    int period = (mode == eBorderReflect) ? 2 * (n - 1) : n;
+    for (int x = lo; x < hi; )
+    {
+        int p = (int) (((long long) x % period + period) % period);
+        int len;
+        CAxisRun run;
+        if (p < n && (mode == eBorderCyclic || p < n - 1))
+        {
+            // Ascending run starting at p
+            len = __min(hi - x, ((mode == eBorderCyclic) ? n : n - 1) - p);
+            run.start = p, run.end = p + len;
+        }
+        else
+        {
+            // Descending run (reflection) starting at k = period - p
+            int k = period - p;
+            len = __min(hi - x, k);
+            run.start = k - len + 1, run.end = k + 1;
+        }
+        run.mult = 1;
+        runs.push_back(run);
+        x += len;
+    }
+}
+
+}   // namespace
+
+template <class S>
+CIntegralImageOf<S>::CIntegralImageOf(void)
+    : borderMode(eBorderZero), m_rowSize(0), m_sums(0)
+{
+}
+
+template <class S>
+void CIntegralImageOf<S>::ReAllocate(CShape s)
+{
+    if (s.width < 0 || s.height < 0 || s.nBands < 0)
+        throw CError("IntegralImage: invalid image shape");
+
+    // Pad rows to whole cache lines, like the image rows
+    long long lineValues = imageMemoryAlignment / sizeof(S);
+    long long rowSize = ((long long) (s.width + 1) * s.nBands + lineValues - 1) / lineValues * lineValues;
+    long long nBytes = rowSize * (s.height + 1) * (long long) sizeof(S);
+    if (nBytes > INT_MAX)
+        throw CError("IntegralImage: the sums of a %d pixel wide image do not fit in memory", s.width);
+
+    m_shape = s;
+    m_rowSize = (ptrdiff_t) rowSize;
+    m_sums = (nBytes > 0) ? (S*) ImageMemoryAllocate((int) nBytes) : 0;
+    m_memory.ReAllocate((int) nBytes, m_sums, true, (nBytes > 0) ? ImageMemoryRelease : 0);
+
+    // The sums over empty areas
+    for (ptrdiff_t i = 0; i < m_rowSize && nBytes > 0; i++)
+        m_sums[i] = 0;
+    for (int y = 1; y <= s.height; y++)
+        for (int b = 0; b < s.nBands; b++)
+            RowAddress(y)[b] = 0;
+}
+
+template <class S>
+S CIntegralImageOf<S>::BorderBoxSum(int x0, int y0, int x1, int y1, int band) const
+{
+    std::vector<CAxisRun> xRuns, yRuns;
+    AxisRuns(x0, x1, m_shape.width, borderMode, xRuns);
+    AxisRuns(y0, y1, m_shape.height, borderMode, yRuns);
+
+    S sum = 0;
+    for (size_t j = 0; j < yRuns.size(); j++)
+        for (size_t i = 0; i < xRuns.size(); i++)
+        {
+            const CAxisRun& xr = xRuns[i];
+            const CAxisRun& yr = yRuns[j];
+            S rect = RectSum(xr.start, yr.start, xr.end, yr.end, band);
+            sum += (xr.mult == 1 && yr.mult == 1) ? rect : rect * S(xr.mult) * S(yr.mult);
+        }
+    return sum;
+}
+
+template <class T, class S>
+void IntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst, bool parallel)
+{
+    ComputeIntegralImage<false>(src, dst, parallel);
+}
+
+template <class T, class S>
+void SquaredIntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst, bool parallel)
+{
+    ComputeIntegralImage<true>(src, dst, parallel);
+}
+
+template class CIntegralImageOf<uint32_t>;
+template class CIntegralImageOf<uint64_t>;
+template class CIntegralImageOf<double>;
+
+template void IntegralImage<>(const CByteImage& src, CUInt32IntegralImage& dst, bool parallel);
+template void IntegralImage<>(const CByteImage& src, CUInt64IntegralImage& dst, bool parallel);
+template void IntegralImage<>(const CFloatImage& src, CDoubleIntegralImage& dst, bool parallel);
+template void SquaredIntegralImage<>(const CByteImage& src, CUInt32IntegralImage& dst, bool parallel);
+template void SquaredIntegralImage<>(const CByteImage& src, CUInt64IntegralImage& dst, bool parallel);
+template void SquaredIntegralImage<>(const CFloatImage& src, CDoubleIntegralImage& dst, bool parallel);
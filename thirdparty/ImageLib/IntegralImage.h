@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  IntegralImage.h -- summed-area tables for constant time box sums
+//
+// SPECIFICATION
+//  void IntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst,
+//                     bool parallel = false);
+//  void SquaredIntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst,
+//                            bool parallel = false);
+//
+//  S CIntegralImageOf<S>::Sum(int x, int y, int band) const;
+//  S CIntegralImageOf<S>::BoxSum(int x0, int y0, int x1, int y1, int band) const;
+//
+// PARAMETERS
+//  src                 source image
+//  dst                 integral image (sums) of src
+//  parallel            spread the work over the ImageLib thread pool
+//  x, y                corner of the summed area [0, x) x [0, y)
+//  x0, y0, x1, y1      summed box [x0, x1) x [y0, y1) (may exceed src)
+//  band                band of src to sum
+//
+// DESCRIPTION
+//  IntegralImage sums up the values of each band of src over every area
+//  [0, x) x [0, y), 0 <= x <= width, 0 <= y <= height, after which the
+//  sum over any box takes four lookups (BoxSum).  SquaredIntegralImage
+//  sums the squared values instead, so that box variances can be
+//  computed along with the means.  The supported types are
+//
+//      src         dst
+//      uchar       CUInt32IntegralImage, CUInt64IntegralImage
+//      float       CDoubleIntegralImage
+//
+//  Unsigned sums wrap around, but box sums are computed modulo the same
+//  power of two, so a box sum is exact as long as the TRUE sum of the box
+//  fits, however large the image is: with 32 bits, any uchar box of up to
+//  16843009 pixels (66051 pixels for squared sums).  Use the 64 bit sums
+//  beyond that.  double sums of floats are exact as long as they need no
+//  more than 53 significant bits (e.g., for integer valued pixels), and
+//  accurate to double precision otherwise.
+//
+//  BoxSum accepts any box (empty boxes sum to 0).  Pixels outside the
+//  source image are supplied according to borderMode (copied from src by
+//  the builders), as in Convolve: zero, replicated, reflected or cyclic
+//  (see TrimIndex in Image.h).  Boxes that stay inside the image take the
+//  inline fast path; the others are split into runs of source columns and
+//  rows that are summed separately.
+//
+//  The sums are computed in a single pass (double sums four rows at a
+//  time, to hide the latency of the additions).  With parallel = true the row prefix sums
+//  are spread over the thread pool (see Parallel.h), followed by a
+//  vectorized column pass split into column strips; the results are the
+//  same either way.  Sizes are computed in 64 bits:
+//  images whose sums would not fit in the memory an image can address
+//  are rejected with a CError rather than silently truncated.
+//
+//  Like images, integral images share their memory when copied.
+//
+// SEE ALSO
+//  IntegralImage.cpp   implementation
+//  Image.h             EBorderMode, TrimIndex
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+template <class S>
+class CIntegralImageOf
+{
+public:
+    CIntegralImageOf(void);
+
+    void ReAllocate(CShape s);      // shape of the SOURCE image; zeroes row and column 0
+
+    CShape Shape(void) const        { return m_shape; }     // shape of the source image
+
+    S* RowAddress(int y)            { return m_sums + (ptrdiff_t) y * m_rowSize; }
+    const S* RowAddress(int y) const { return m_sums + (ptrdiff_t) y * m_rowSize; }
+    ptrdiff_t RowSize(void) const   { return m_rowSize; }   // stride between rows (in values)
+
+    S Sum(int x, int y, int band) const;    // sum over [0, x) x [0, y)
+    S BoxSum(int x0, int y0, int x1, int y1, int band) const;   // sum over [x0, x1) x [y0, y1)
+
+    EBorderMode borderMode;         // border behavior of BoxSum
+
+private:
+    S RectSum(int x0, int y0, int x1, int y1, int band) const;
+    S BorderBoxSum(int x0, int y0, int x1, int y1, int band) const;
+
+    CShape m_shape;                 // source image shape
+    ptrdiff_t m_rowSize;            // stride between rows (in values)
+    S* m_sums;                      // sum for (x, y, band) at y * m_rowSize + x * nBands + band
+    CRefCntMem m_memory;            // reference counted memory
+};
+
+typedef CIntegralImageOf<uint32_t> CUInt32IntegralImage;
+typedef CIntegralImageOf<uint64_t> CUInt64IntegralImage;
+typedef CIntegralImageOf<double>   CDoubleIntegralImage;
+
+template <class T, class S>
+void IntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst, bool parallel = false);
+
+template <class T, class S>
+void SquaredIntegralImage(const CImageOf<T>& src, CIntegralImageOf<S>& dst, bool parallel = false);
+
+template <class S>
+inline S CIntegralImageOf<S>::Sum(int x, int y, int band) const
+{
+    return RowAddress(y)[x * m_shape.nBands + band];
+}
+
+template <class S>
+inline S CIntegralImageOf<S>::RectSum(int x0, int y0, int x1, int y1, int band) const
+{
+    const S* r0 = RowAddress(y0) + band;
+    const S* r1 = RowAddress(y1) + band;
+    int nB = m_shape.nBands;
+    return (r1[x1 * nB] - r1[x0 * nB]) - (r0[x1 * nB] - r0[x0 * nB]);
+}
+
+template <class S>
+inline S CIntegralImageOf<S>::BoxSum(int x0, int y0, int x1, int y1, int band) const
+{
+    if (x0 >= 0 && y0 >= 0 && x1 <= m_shape.width && y1 <= m_shape.height)
+        return (x0 < x1 && y0 < y1) ? RectSum(x0, y0, x1, y1, band) : S(0);
+    return BorderBoxSum(x0, y0, x1, y1, band);
+}
+
+#endif // INTEGRAL_IMAGE_H
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Parallel.cpp -- process-wide thread pool and parallel loop helper
+//
+// DESIGN NOTES
+//  Each ParallelFor call becomes a job on a shared queue.  Workers take
+//  the job at the head of the queue and claim chunks from it with an
+//  atomic counter until none are left.  A job is removed from the queue
+//  once all its chunks are claimed or once as many threads as allowed
+//  have joined it, so idle workers never spin on a job they cannot help.
+//
+// SEE ALSO
+//  Parallel.h          longer description
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct CParallelJob
+{
+    std::function<void(int, int)> fn;
+    int end, grain;
+    int slots;                      // workers still allowed to join (pool mutex)
+    std::atomic<int> next;          // first unclaimed index
+    std::atomic<int> remaining;     // indices not yet processed
+    std::mutex doneMutex;
+    std::condition_variable doneCond;
+    std::exception_ptr error;
+
+    void Run()
+    {
+        for (;;)
+        {
+            int b = next.fetch_add(grain);
+            if (b >= end)
+                return;
+            int e = std::min(end, b + grain);
+            try
+            {
+                fn(b, e);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (! error)
+                    error = std::current_exception();
+            }
+            if (remaining.fetch_sub(e - b) == e - b)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                doneCond.notify_all();
+            }
+        }
+    }
+};
+
+class CThreadPool
+{
+public:
+    CThreadPool() : m_stop(false)
+    {
+        int n = (int) std::thread::hardware_concurrency();
+        for (int i = 1; i < n; i++)
+            m_workers.push_back(std::thread(&CThreadPool::WorkerLoop, this));
+    }
+
+    ~CThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i].join();
+    }
+
+    int NWorkers() const { return (int) m_workers.size(); }
+
+    void Run(const std::shared_ptr<CParallelJob>& job)
+    {
+        if (job->slots > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(job);
+            }
+            m_cond.notify_all();
+        }
+
+        job->Run();
+
+        // Nobody else can pick up work from this job any more
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::deque<std::shared_ptr<CParallelJob> >::iterator it =
+                std::find(m_queue.begin(), m_queue.end(), job);
+            if (it != m_queue.end())
+                m_queue.erase(it);
+        }
+
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCond.wait(lock, [&] { return job->remaining.load() <= 0; });
+        if (job->error)
+            std::rethrow_exception(job->error);
+    }
+
+private:
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::shared_ptr<CParallelJob> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [&] { return m_stop || ! m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+                job = m_queue.front();
+                if (--job->slots <= 0 || job->next.load() >= job->end)
+                    m_queue.pop_front();
+            }
+            job->Run();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::shared_ptr<CParallelJob> > m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop;
+};
+
+CThreadPool& ThreadPool()
+{
+    static CThreadPool pool;
+    return pool;
+}
+
+std::atomic<int> g_numThreads(0);   // 0 = use every hardware thread
+
+}
+
+int ParallelNumThreads(void)
+{
+    int n = g_numThreads.load();
+    int available = ThreadPool().NWorkers() + 1;
+    return (n <= 0) ? available : std::min(n, available);
+}
+
+void ParallelSetNumThreads(int nThreads)
+{
+    g_numThreads.store(std::max(0, nThreads));
+}
+
+void ParallelForChunks(int begin, int end, int grain,
+                       const std::function<void(int, int)>& fn)
+{
+    std::shared_ptr<CParallelJob> job(new CParallelJob);
+    job->fn = fn;
+    job->end = end;
+    job->grain = grain;
+    job->next = begin;
+    job->remaining = end - begin;
+    int nChunks = (end - begin + grain - 1) / grain;
+    job->slots = std::min(ParallelNumThreads(), nChunks) - 1;
+    ThreadPool().Run(job);
+}
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Parallel.h -- process-wide thread pool and parallel loop helper
+//
+// SPECIFICATION
+//  void ParallelFor(int begin, int end, F fn, int grain = 1);
+//
+//  int  ParallelNumThreads(void);
+//  void ParallelSetNumThreads(int nThreads);
+//
+// PARAMETERS
+//  begin, end          half-open range of loop indices
+//  fn                  functor called as fn(chunkBegin, chunkEnd)
+//  grain               minimum number of indices handed out per chunk
+//  nThreads            maximum number of threads working on a loop
+//                      (0 = one per hardware core)
+//
+// DESCRIPTION
+//  ParallelFor splits [begin, end) into chunks of grain indices and
+//  hands them out to the worker threads of a persistent pool.  The
+//  calling thread works on the loop as well, so ParallelFor may be called
+//  from inside another ParallelFor (or from several threads at once)
+//  without deadlocking.  The call returns once every chunk is done.
+//  If fn throws, the first exception is re-thrown in the calling thread.
+//
+//  Loops that are too small to be worth distributing (a single chunk, or
+//  when ParallelNumThreads() == 1) run serially in the calling thread.
+//
+// SEE ALSO
+//  Parallel.cpp        implementation
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+int  ParallelNumThreads(void);
+void ParallelSetNumThreads(int nThreads);
+
+void ParallelForChunks(int begin, int end, int grain,
+                       const std::function<void(int, int)>& fn);
+
+template <class F>
+inline void ParallelFor(int begin, int end, F fn, int grain = 1)
+{
+    if (grain < 1)
+        grain = 1;
+    if (end - begin <= grain || ParallelNumThreads() <= 1)
+    {
+        if (begin < end)
+            fn(begin, end);
+        return;
+    }
+    ParallelForChunks(begin, end, grain, std::function<void(int, int)>(fn));
+}
+
+#endif // PARALLEL_H
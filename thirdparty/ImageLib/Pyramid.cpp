@@ -12,22 +12,28 @@
 
 #include "Image.h"
 #include <vector>
+#include <math.h>
 #include "Pyramid.h"
 #include "Convolve.h"
+#include "Smooth.h"
+#include "Resize.h"
+#include "Parallel.h"
 
 template <class T>
 CPyramidOf<T>::CPyramidOf()
 {
-    decimateKernel    = ConvolveKernel_14641;
-    interpolateKernel = ConvolveKernel_14641;
+    decimateKernel    = ConvolveKernel_14641();
+    interpolateKernel = ConvolveKernel_14641();
+    decimateSigma     = 0;
 }
 
 
 template <class T>
 CPyramidOf<T>::CPyramidOf(CImageOf<T> image)
 {
-    decimateKernel    = ConvolveKernel_14641;
-    interpolateKernel = ConvolveKernel_14641;
+    decimateKernel    = ConvolveKernel_14641();
+    interpolateKernel = ConvolveKernel_14641();
+    decimateSigma     = 0;
     m_image.push_back(image);
 }
 
@@ -59,7 +65,10 @@ void CPyramidOf<T>::UpLevel(int l, int n_levels)
         m_image.resize(l+2);
     CImageOf<T>& src = m_image[l];
     CImageOf<T>& dst = m_image[l+1];
-    ConvolveSeparable(src, dst, decimateKernel, decimateKernel, 2);
+    if (decimateSigma > 0)
+        GaussianSmooth(src, dst, decimateSigma, 2);
+    else
+        ConvolveSeparable(src, dst, decimateKernel, decimateKernel, 2);
 
     if (n_levels > 1)
         UpLevel(l+1, n_levels-1);
@@ -69,7 +78,37 @@ template <class T>
 void CPyramidOf<T>::DownLevel(int l, int n_levels)
 {
     // Interpolate finer levels
-    throw CError("CPyramidOf<T>:DownLevel is not yet implemented");
+    if (n_levels <= 0 || l <= 0)
+        return;
+
+    CImageOf<T> src = (*this)[l];
+    CImageOf<T>& dst = m_image[l-1];
+    CShape sShape = src.Shape();
+    CShape dShape = dst.Shape();
+    if (dShape.nBands == 0)         // un-initialized, use twice the size
+        dShape = CShape(2*sShape.width, 2*sShape.height, sShape.nBands);
+
+    // Zero-pad (insert a 0 between all the samples), then filter.  The
+    // interpolation kernel is doubled along each axis since only every
+    // other tap hits a sample.
+    CImageOf<T> padded(dShape);
+    padded.ClearPixels();
+    padded.borderMode = eBorderReflect;
+    for (int y = 0; y < sShape.height && 2*y < dShape.height; y++)
+        for (int x = 0; x < sShape.width && 2*x < dShape.width; x++)
+            for (int b = 0; b < sShape.nBands; b++)
+                padded.Pixel(2*x, 2*y, b) = src.Pixel(x, y, b);
+
+    CShape kShape = interpolateKernel.Shape();
+    CFloatImage kernel(kShape);
+    for (int k = 0; k < kShape.width; k++)
+        kernel.Pixel(k, 0, 0) = 2.0f * interpolateKernel.Pixel(k, 0, 0);
+    kernel.origin[0] = interpolateKernel.origin[0];
+
+    ConvolveSeparable(padded, dst, kernel, kernel, 1);
+
+    if (n_levels > 1)
+        DownLevel(l-1, n_levels-1);
 }
 
 template <class T>
@@ -87,6 +126,110 @@ CImageOf<T>& CPyramidOf<T>::operator[](int l)
     return img;
 }
 
+//
+//  Arbitrary ratio pyramid
+//
+
+template <class T>
+CScalePyramidOf<T>::CScalePyramidOf(int levelsPerOctave, int minSize)
+{
+    decimateKernel    = ConvolveKernel_14641();
+    interpolateKernel = ConvolveKernel_14641();
+    decimateSigma     = 0;
+    m_levelsPerOctave = __max(1, levelsPerOctave);
+    m_minSize         = __max(1, minSize);
+}
+
+template <class T>
+void CScalePyramidOf<T>::Build(CImageOf<T> image)
+{
+    // Compute the shape of every level: the first level of each octave
+    // has the (rounded up) half size of the previous one, as produced by
+    // ConvolveSeparable and GaussianSmooth, the others a fraction of it
+    int L = m_levelsPerOctave;
+    CShape base = image.Shape();
+    std::vector<CShape> shapes(1, base);
+    for (int l = 1; ; l++)
+    {
+        if (l % L == 0)
+            base = CShape((base.width + 1) / 2, (base.height + 1) / 2, base.nBands);
+        double f = pow(2.0, -double(l % L) / L);
+        CShape shape(__max(1, int(base.width  * f + 0.5)),
+                     __max(1, int(base.height * f + 0.5)), base.nBands);
+        if (__min(shape.width, shape.height) < m_minSize)
+            break;
+        shapes.push_back(shape);
+    }
+
+    // Re-use the level images of the previous frame when they fit.
+    // Reflecting the borders keeps the decimation from darkening them.
+    int nLevels = (int) shapes.size();
+    m_image.resize(nLevels);
+    m_image[0] = image;
+    for (int l = 1; l < nLevels; l++)
+        m_image[l].ReAllocate(shapes[l], false);
+    for (int l = 0; l < nLevels; l++)
+        m_image[l].borderMode = eBorderReflect;
+
+    // Decimate the octaves, coarsest last
+    for (int l = L; l < nLevels; l += L)
+    {
+        if (decimateSigma > 0)
+            GaussianSmooth(m_image[l-L], m_image[l], decimateSigma, 2, true);
+        else
+            ConvolveSeparable(m_image[l-L], m_image[l], decimateKernel, decimateKernel, 2);
+    }
+
+    // Intra-octave levels only depend on their octave, build them concurrently
+    std::vector<int> levels;
+    for (int l = 1; l < nLevels; l++)
+        if (l % L != 0)
+            levels.push_back(l);
+    ParallelFor(0, (int) levels.size(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            int l = levels[i];
+            Resize(m_image[l - l % L], m_image[l], eResizeLinear);
+        }
+    });
+}
+
+template <class T>
+void CScalePyramidOf<T>::DownLevel(int l, int n_levels)
+{
+    // Interpolate finer levels, keeping their current shape
+    for (; n_levels > 0 && l > 0 && l < NLevels(); l--, n_levels--)
+        Resize(m_image[l], m_image[l-1], eResizeLinear);
+}
+
+template <class T>
+int CScalePyramidOf<T>::NLevels() const
+{
+    return (int) m_image.size();
+}
+
+template <class T>
+int CScalePyramidOf<T>::LevelsPerOctave() const
+{
+    return m_levelsPerOctave;
+}
+
+template <class T>
+double CScalePyramidOf<T>::Scale(int l) const
+{
+    return pow(2.0, -double(l) / m_levelsPerOctave);
+}
+
+template <class T>
+CImageOf<T>& CScalePyramidOf<T>::operator[](int l)
+{
+    // Return image at level l
+    if (l < 0 || l >= NLevels())
+        throw CError("CScalePyramidOf<T>: level %d has not been built", l);
+    return m_image[l];
+}
+
 template <class T>
 void InstantiatePyramid(CPyramidOf<T> p)
 {
@@ -106,10 +249,11 @@ void InstantiatePyramids()
 }
 
 
-#if 0   // doesn't seem to do anything:
-
-//  Explicit template instantiation
-template<> class CPyramidOf<uchar> { };
-template<> class CPyramidOf<int>   { };
-template<> class CPyramidOf<float> { };
-#endif
\ No newline at end of file
+//  Explicit template instantiation (the calls above get inlined away in
+//  optimized builds)
+template class CPyramidOf<uchar>;
+template class CPyramidOf<int>;
+template class CPyramidOf<float>;
+template class CScalePyramidOf<uchar>;
+template class CScalePyramidOf<int>;
+template class CScalePyramidOf<float>;
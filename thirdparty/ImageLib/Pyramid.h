@@ -18,9 +18,27 @@
 //  Coarser levels can also be interpolated to finer (lower) levels,
 //  but this requires and explicit DownLevel() invocation.
 //
+//  CScalePyramidOf<T> generalizes this to levelsPerOctave levels per
+//  factor of 2, i.e., level l is 2^(-l/levelsPerOctave) times the size of
+//  level 0.  The first level of every octave is decimated from the first
+//  level of the previous octave (using decimateKernel), and the other
+//  levels of the octave are resampled from it with Resize() and an
+//  antialiasing linear filter.  All the levels are built at once by
+//  Build(), the intra-octave levels concurrently (see Parallel.h).  The
+//  level images are kept across calls, so building the pyramid of a new
+//  frame of the same size re-uses them instead of allocating new ones.
+//  (This means the images returned by operator[] are overwritten by the
+//  next Build()).
+//
+//  Both pyramids decimate with decimateKernel by default.  Setting
+//  decimateSigma > 0 decimates with GaussianSmooth of that sigma instead
+//  (e.g., 1.0, about as smooth as the 1 4 6 4 1 kernel), whose cost does
+//  not depend on sigma, so that strongly smoothed pyramids stay cheap.
+//
 // SEE ALSO
 //  Pyramid.cpp         implementation
 //  Image.h             image class definition
+//  Smooth.h            GaussianSmooth
 //
 // Copyright  Richard Szeliski, 2001.  See Copyright.h for more details
 //
@@ -30,6 +48,7 @@ struct CPyramidAttributes
 {
     CFloatImage decimateKernel;     // decimation kernel
     CFloatImage interpolateKernel;  // interpolation kernel
+    float decimateSigma;            // if > 0, decimate with GaussianSmooth instead
 };
 
 template <class T>
@@ -49,8 +68,31 @@ private:
     std::vector<CImageOf<T> > m_image;          // image at level l
 };
 
+template <class T>
+class CScalePyramidOf : public CPyramidAttributes
+{
+public:
+    CScalePyramidOf(int levelsPerOctave = 1, int minSize = 8);
+
+    void Build(CImageOf<T> image);              // (re-)build all levels from image
+    void DownLevel(int l, int n_levels);        // interpolate finer levels
+    int  NLevels() const;                       // number of levels built
+    int  LevelsPerOctave() const;               // levels per factor of 2
+    double Scale(int l) const;                  // nominal size of level l / size of level 0
+    CImageOf<T>& operator[](int level);         // return image at level l
+
+private:
+    int m_levelsPerOctave;                      // levels per factor of 2
+    int m_minSize;                              // smallest width or height of a level
+    std::vector<CImageOf<T> > m_image;          // image at level l
+};
+
 // Commonly used types (supported in current implementation):
 
 typedef CPyramidOf<uchar> CBytePyramid;
 typedef CPyramidOf<int>   CIntPyramid;
 typedef CPyramidOf<float> CFloatPyramid;
+
+typedef CScalePyramidOf<uchar> CByteScalePyramid;
+typedef CScalePyramidOf<int>   CIntScalePyramid;
+typedef CScalePyramidOf<float> CFloatScalePyramid;
@@ -30,20 +30,17 @@ CRefCntMem::~CRefCntMem()
 void CRefCntMem::DecrementCount()
 {
     // Decrement the reference count and delete if done
-    if (m_ptr)
+    // (only the thread that drops the last reference sees 1 here)
+    if (m_ptr && m_ptr->m_refCnt.fetch_sub(1, std::memory_order_acq_rel) == 1)
     {
-        m_ptr->m_refCnt -= 1;
-        if (m_ptr->m_refCnt == 0)
+        if (m_ptr->m_deleteWhenDone)
         {
-            if (m_ptr->m_deleteWhenDone)
-            {
-                if (m_ptr->m_delFn)
-                    m_ptr->m_delFn(m_ptr->m_memory);
-                else 
-                    delete m_ptr->m_memory;
-            }
-            delete m_ptr;
+            if (m_ptr->m_delFn)
+                m_ptr->m_delFn(m_ptr->m_memory);
+            else 
+                delete [] (double *) m_ptr->m_memory;
         }
+        delete m_ptr;
     }
 }
 
@@ -52,7 +49,7 @@ void CRefCntMem::IncrementCount()
     // Increment the reference count
     if (m_ptr)
     {
-        m_ptr->m_refCnt += 1;
+        m_ptr->m_refCnt.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
@@ -63,12 +60,33 @@ CRefCntMem::CRefCntMem(const CRefCntMem& ref)
     (*this) = ref;      // use assignment operator
 }
 
+CRefCntMem::CRefCntMem(CRefCntMem&& ref) noexcept
+{
+    // Move constructor: take over ref's reference
+    m_ptr = ref.m_ptr;
+    ref.m_ptr = 0;
+}
+
+CRefCntMem& CRefCntMem::operator=(CRefCntMem&& ref) noexcept
+{
+    // Move assignment: drop our reference, take over ref's
+    if (this != &ref)
+    {
+        DecrementCount();
+        m_ptr = ref.m_ptr;
+        ref.m_ptr = 0;
+    }
+    return *this;
+}
+
 CRefCntMem& CRefCntMem::operator=(const CRefCntMem& ref)
 {
-    // Assignment
+    // Assignment (take the new reference first, in case ref shares m_ptr)
+    CRefCntMemPtr *ptr = ref.m_ptr;
+    if (ptr)
+        ptr->m_refCnt.fetch_add(1, std::memory_order_relaxed);
     DecrementCount();   // if m_ptr exists, no longer pointing to it
-    m_ptr = ref.m_ptr;
-    IncrementCount();
+    m_ptr = ptr;
     return *this;
 }
 
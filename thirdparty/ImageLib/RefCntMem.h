@@ -13,6 +13,14 @@
 //  the including class to achieve a similar kind of memory sharing as
 //  is found in garbage collected languages such as Java and C#.
 //
+//  Moving from an object transfers its reference to the target without
+//  touching the count, and leaves the source empty.
+//
+//  The reference count is atomic, so copies of the same memory may be
+//  made and destroyed concurrently from different threads.  (As with
+//  std::shared_ptr, a single CRefCntMem object must still not be
+//  modified by one thread while another one uses it.)
+//
 // SEE ALSO
 //  RefCntMem.cpp       implementation
 //  Image.h             class that uses a CRefCntMem object
@@ -24,10 +32,12 @@
 #ifndef REF_CNT_MEM_H
 #define REF_CNT_MEM_H
 
+#include <atomic>
+
 struct CRefCntMemPtr         // shared component of reference counted memory
 {
     void *m_memory;         // allocated memory
-    int m_refCnt;           // reference count
+    std::atomic<int> m_refCnt;  // reference count
     int m_nBytes;           // number of bytes
     bool m_deleteWhenDone;  // delete memory when ref-count drops to 0
     void (*m_delFn)(void *ptr); // optional delete function
@@ -38,8 +48,10 @@ class CRefCntMem            // reference-counted memory allocator
 public:
     CRefCntMem(void);           // default constructor
     CRefCntMem(const CRefCntMem& ref);  // copy constructor
+    CRefCntMem(CRefCntMem&& ref) noexcept;  // move constructor
     ~CRefCntMem(void);          // destructor
     CRefCntMem& operator=(const CRefCntMem& ref);  // assignment
+    CRefCntMem& operator=(CRefCntMem&& ref) noexcept;  // move assignment
 
     void ReAllocate(int nBytes, void *memory, bool deleteWhenDone,
                     void (*deleteFunction)(void *ptr) = 0);
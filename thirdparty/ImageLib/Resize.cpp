@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Resize.cpp -- separable, antialiased image resizing
+//
+// DESIGN NOTES
+//  For each axis, output pixel i is a weighted sum of nTaps consecutive
+//  source pixels starting at first[i].  All the outputs of an axis use the
+//  same (maximum) tap count, with zero weights as padding, so the inner
+//  loops have a fixed trip count.  The tap tables are kept in a small
+//  cache keyed by (source size, destination size, filter); entries are
+//  handed out as shared pointers so that clearing the cache never pulls a
+//  table from under a running Resize.
+//
+//  The vertical pass runs first: it produces one float row of source
+//  width per output row from contiguous source rows (converting from T1
+//  on the fly), and vectorizes well.  The horizontal pass then gathers
+//  the taps of each output pixel from that row and converts to T2.
+//
+// SEE ALSO
+//  Resize.h            longer description
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "Resize.h"
+#include "Parallel.h"
+#include <math.h>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct CResizeTaps
+{
+    int nTaps;                      // taps per output pixel
+    std::vector<int> first;         // first source pixel of each output pixel
+    std::vector<float> weights;     // nTaps weights per output pixel
+};
+
+static const int resizeTapsCacheSize = 64;
+
+double Sinc(double x)
+{
+    if (x == 0)
+        return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+// Unnormalized weight of source pixel j for the output pixel covering the
+// source interval [x0, x1) (in pixel edge coordinates)
+double FilterWeight(EResizeFilter filter, int j, double x0, double x1, double radius)
+{
+    if (filter == eResizeBox)
+        return __max(0.0, __min(x1, j + 1.0) - __max(x0, double(j)));
+
+    double d = fabs(j + 0.5 - 0.5 * (x0 + x1)) / radius;
+    if (filter == eResizeLinear)
+        return __max(0.0, 1.0 - d);
+    if (d != 0 && d == floor(d))    // sin(k pi) is not exactly 0 in double
+        return 0.0;
+    return (d < 3.0) ? Sinc(d) * Sinc(d / 3.0) : 0.0;
+}
+
+std::shared_ptr<const CResizeTaps> ComputeResizeTaps(int srcN, int dstN, EResizeFilter filter)
+{
+    std::shared_ptr<CResizeTaps> taps(new CResizeTaps);
+    double scale  = double(dstN) / srcN;
+    double radius = __max(1.0, 1.0 / scale);        // filter stretch
+    double reach  = (filter == eResizeLanczos3) ? 3.0 * radius :
+                    (filter == eResizeLinear)   ? radius : 0.5 / __min(1.0, scale);
+
+    // Collect the (border folded) taps of each output pixel
+    std::vector<int> lo(dstN), hi(dstN);
+    std::vector<std::vector<double> > w(dstN);
+    int nTaps = 1;
+    for (int i = 0; i < dstN; i++)
+    {
+        double x0 = i / scale, x1 = (i + 1) / scale;
+        double c  = 0.5 * (x0 + x1);
+        int j0 = int(floor(c - reach)), j1 = int(ceil(c + reach));
+        lo[i] = __max(0, __min(srcN - 1, j0));
+        hi[i] = __max(0, __min(srcN - 1, j1));
+        w[i].assign(hi[i] - lo[i] + 1, 0.0);
+        double total = 0;
+        for (int j = j0; j <= j1; j++)
+        {
+            double wj = FilterWeight(filter, j, x0, x1, radius);
+            w[i][__max(0, __min(srcN - 1, j)) - lo[i]] += wj;
+            total += wj;
+        }
+        if (total == 0)     // can only happen for degenerate sizes
+            w[i][__max(0, __min(srcN - 1, int(floor(c)))) - lo[i]] = total = 1.0;
+        for (int k = 0; k < (int) w[i].size(); k++)
+            w[i][k] /= total;
+        nTaps = __max(nTaps, hi[i] - lo[i] + 1);
+    }
+
+    // Pad to nTaps weights per output, shifting windows that would run
+    // past the end of the source
+    taps->nTaps = nTaps;
+    taps->first.resize(dstN);
+    taps->weights.assign(dstN * nTaps, 0.0f);
+    for (int i = 0; i < dstN; i++)
+    {
+        int first = __min(lo[i], srcN - nTaps);
+        taps->first[i] = first;
+        for (int j = lo[i]; j <= hi[i]; j++)
+            taps->weights[i * nTaps + j - first] = (float) w[i][j - lo[i]];
+    }
+    return taps;
+}
+
+std::shared_ptr<const CResizeTaps> ResizeTaps(int srcN, int dstN, EResizeFilter filter)
+{
+    static std::mutex cacheMutex;
+    static std::map<std::pair<std::pair<int, int>, int>, std::shared_ptr<const CResizeTaps> > cache;
+
+    std::pair<std::pair<int, int>, int> key(std::make_pair(srcN, dstN), int(filter));
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return it->second;
+    }
+
+    // Compute outside of the lock, two threads may occasionally both do it
+    std::shared_ptr<const CResizeTaps> taps = ComputeResizeTaps(srcN, dstN, filter);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.size() >= resizeTapsCacheSize)
+        cache.clear();
+    cache[key] = taps;
+    return taps;
+}
+
+// The range of T as floats that convert back to T: CImageOf<int>::MinVal
+// and MaxVal are swapped, and INT_MAX rounds up to 2^31 as a float
+template <class T>
+inline void ClipRange(float& minVal, float& maxVal)
+{
+    minVal = (float) std::numeric_limits<T>::lowest();
+    maxVal = (float) std::numeric_limits<T>::max();
+    if ((double) maxVal > (double) std::numeric_limits<T>::max())
+        maxVal = nextafterf(maxVal, 0.0f);
+}
+
+// Rounds half up (also for negative values) and clips
+template <class T>
+inline T RoundAndClip(float v, float minVal, float maxVal)
+{
+    v = __max(minVal, __min(maxVal, v));
+    return (T) (std::numeric_limits<T>::is_integer ? floorf(v + 0.5f) : v);
+}
+
+}
+
+template <class T1, class T2>
+void Resize(const CImageOf<T1>& src, CImageOf<T2>& dst, EResizeFilter filter)
+{
+    CShape sShape = src.Shape();
+    CShape dShape = dst.Shape();
+    dShape.nBands = sShape.nBands;
+    dst.ReAllocate(dShape, false);
+    if (sShape.width == 0 || sShape.height == 0 || dShape.width == 0 ||
+        dShape.height == 0 || dShape.nBands == 0)
+        return;
+
+    std::shared_ptr<const CResizeTaps> xTaps = ResizeTaps(sShape.width,  dShape.width,  filter);
+    std::shared_ptr<const CResizeTaps> yTaps = ResizeTaps(sShape.height, dShape.height, filter);
+
+    int nB = dShape.nBands;
+    int sn = sShape.width * nB;
+    float minVal, maxVal;
+    ClipRange<T2>(minVal, maxVal);
+
+    int grain = __max(1, (1 << 14) / (dShape.width * nB));
+    ParallelFor(0, dShape.height, [&](int yBegin, int yEnd)
+    {
+        std::vector<float> row(sn);
+        int xN = xTaps->nTaps, yN = yTaps->nTaps;
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            // Vertical pass, converting the source pixels to float
+            const float* wy = &yTaps->weights[y * yN];
+            const T1* s = &src.Pixel(0, yTaps->first[y], 0);
+            for (int i = 0; i < sn; i++)
+                row[i] = wy[0] * s[i];
+            for (int k = 1; k < yN; k++)
+            {
+                const float wk = wy[k];
+                if (wk == 0)
+                    continue;
+                s = &src.Pixel(0, yTaps->first[y] + k, 0);
+                for (int i = 0; i < sn; i++)
+                    row[i] += wk * s[i];
+            }
+
+            // Horizontal pass
+            T2* d = &dst.Pixel(0, y, 0);
+            for (int x = 0; x < dShape.width; x++, d += nB)
+            {
+                const float* wx = &xTaps->weights[x * xN];
+                const float* r  = &row[xTaps->first[x] * nB];
+                for (int b = 0; b < nB; b++)
+                {
+                    float sum = 0;
+                    for (int k = 0; k < xN; k++)
+                        sum += wx[k] * r[k * nB + b];
+                    d[b] = RoundAndClip<T2>(sum, minVal, maxVal);
+                }
+            }
+        }
+    }, grain);
+}
+
+template void Resize<>(const CByteImage& src, CByteImage& dst, EResizeFilter filter);
+template void Resize<>(const CByteImage& src, CFloatImage& dst, EResizeFilter filter);
+template void Resize<>(const CIntImage& src, CIntImage& dst, EResizeFilter filter);
+template void Resize<>(const CFloatImage& src, CFloatImage& dst, EResizeFilter filter);
+template void Resize<>(const CFloatImage& src, CByteImage& dst, EResizeFilter filter);
@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Resize.h -- separable, antialiased image resizing
+//
+// SPECIFICATION
+//  void Resize(const CImageOf<T1>& src, CImageOf<T2>& dst,
+//              EResizeFilter filter);
+//
+// PARAMETERS
+//  src                 source image
+//  dst                 destination image, its width and height give the
+//                      size of the result
+//  filter              reconstruction filter (box, linear, Lanczos)
+//
+// DESCRIPTION
+//  Resize resamples src to the size of dst.  Output pixel centers are
+//  mapped to source coordinates as (x + 0.5) / scale - 0.5, so that the
+//  image corners line up.  When shrinking, the filter is stretched by the
+//  inverse of the scale factor, so every output pixel averages over its
+//  whole footprint in the source instead of aliasing.  eResizeBox weights
+//  the source pixels by how much of the output pixel they cover (i.e.,
+//  area averaging).  Taps falling outside the source are folded onto the
+//  border pixels.
+//
+//  The filter taps of every output column and row only depend on the
+//  source and destination sizes, so they are computed once per size pair
+//  and filter and cached (the cache is shared by all threads).  The image
+//  is filtered vertically, then horizontally, in float.  The source and
+//  destination pixel types may differ (e.g., uchar -> float), the
+//  conversion happens as part of the filtering.  Integer results are
+//  rounded and clipped to the destination range.  dst is re-allocated
+//  with the band count of src if necessary.  Large images are split into
+//  bands of rows over the ImageLib thread pool (see Parallel.h).
+//
+// SEE ALSO
+//  Resize.cpp          implementation
+//  WarpImage.h         general (affine / projective) resampling
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RESIZE_H
+#define RESIZE_H
+
+enum EResizeFilter
+{
+    eResizeBox      = 0,    // area averaging
+    eResizeLinear   = 1,    // tent (bi-linear when enlarging)
+    eResizeLanczos3 = 2     // 3 lobe Lanczos windowed sinc
+};
+
+template <class T1, class T2>
+void Resize(const CImageOf<T1>& src, CImageOf<T2>& dst,
+            EResizeFilter filter = eResizeLinear);
+
+#endif // RESIZE_H
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Smooth.h -- Gaussian and box smoothing in constant time per pixel
+//
+// SPECIFICATION
+//  void GaussianSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+//                      float sigma, int subsample = 1, bool parallel = false);
+//
+//  void BoxSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+//                 int radius, int nPasses = 1, int subsample = 1,
+//                 bool parallel = false);
+//
+//  void BoxGaussianSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+//                         float sigma, int nPasses = 3, int subsample = 1,
+//                         bool parallel = false);
+//
+// PARAMETERS
+//  src                 source image
+//  dst                 destination image
+//  sigma               standard deviation of the Gaussian, in pixels
+//                      (0 = no smoothing, otherwise at least 0.5)
+//  radius              the box is 2 * radius + 1 pixels wide
+//  nPasses             number of successive box filters
+//  subsample           keep every subsample'th row and column of the
+//                      result (as in ConvolveSeparable)
+//  parallel            spread the work over the ImageLib thread pool
+//
+// DESCRIPTION
+//  Separable smoothing filters whose cost per pixel does not depend on
+//  the amount of smoothing, unlike Convolve with an explicit kernel.
+//
+//  GaussianSmooth uses Deriche's recursive (IIR) Gaussian: second order
+//  filters run forwards and backwards along the rows and then along the
+//  columns.  Its impulse response is within 0.05% of the peak of a true
+//  Gaussian of the same sigma (the results are within 0.05 gray levels
+//  of ConvolveSeparable with a sampled Gaussian kernel).
+//
+//  BoxSmooth applies nPasses running box averages of 2 * radius + 1
+//  pixels along the rows and the columns.  BoxGaussianSmooth approximates
+//  a Gaussian with such a cascade (3 passes are within a few percent of
+//  it), picking box widths whose combined variance is as close to sigma^2
+//  as odd integer widths allow.  Box cascades are exact: they are the
+//  same as convolving with the equivalent (piecewise polynomial) kernel.
+//
+//  Pixels outside src are supplied according to src.borderMode, as in
+//  Convolve, i.e., the result is that of filtering the border-extended
+//  image with the whole filter.  This costs a margin of about 4 sigma
+//  (the support of the box cascade) per row and column.
+//
+//  The filtering is done in float.  Integer results are rounded to the
+//  nearest value and clipped (unlike Convolve, which truncates), since
+//  the recursive filter only reproduces a constant image to within float
+//  precision.  dst gets the shape of the (subsampled) result.  It may be
+//  src: src is read completely before dst is written.
+//
+//  The columns are filtered row vector by row vector, so that the loops
+//  vectorize across the columns.  For the rows, strips of 8 rows are
+//  transposed into a buffer where the same vectorized loops run across
+//  the 8 rows.  With parallel = true the strips, and then column ranges,
+//  are handed out to the thread pool (see Parallel.h).
+//
+// SEE ALSO
+//  Smooth.cpp          implementation
+//  Convolve.h          convolution with arbitrary kernels
+//  Pyramid.h           pyramids decimated with GaussianSmooth
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef SMOOTH_H
+#define SMOOTH_H
+
+template <class T>
+void GaussianSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+                    float sigma, int subsample = 1, bool parallel = false);
+
+template <class T>
+void BoxSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+               int radius, int nPasses = 1, int subsample = 1, bool parallel = false);
+
+template <class T>
+void BoxGaussianSmooth(const CImageOf<T>& src, CImageOf<T>& dst,
+                       float sigma, int nPasses = 3, int subsample = 1, bool parallel = false);
+
+#endif // SMOOTH_H
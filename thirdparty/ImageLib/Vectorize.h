@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  Vectorize.h -- helpers for the auto-vectorized pixel kernels
+//
+// DESCRIPTION
+//  IMAGELIB_TARGET_CLONES marks an exported kernel to be compiled once
+//  per instruction set (with GCC on x86-64 Linux: AVX2 and the baseline
+//  SSE2); the dynamic loader picks the best copy for the running CPU.
+//  FMA is deliberately not enabled, since contracting a * b + c would
+//  change the rounding of the results.  ThreadSanitizer builds get the
+//  baseline version only: the loader runs the clone resolvers before the
+//  sanitizer runtime is initialized, which crashes at startup.
+//
+//  IMAGELIB_INLINE forces the inner loops of such a kernel inline, so
+//  that each clone gets its own vectorized copy of them.
+//
+//  This is an internal header, included by the kernel .cpp files only.
+//
+// SEE ALSO
+//  ConvertLine.cpp     pixel type conversion kernels
+//  ColorConvert.cpp    color conversion kernels
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef VECTORIZE_H
+#define VECTORIZE_H
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) && \
+	!defined(__SANITIZE_THREAD__)
+#define IMAGELIB_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#define IMAGELIB_INLINE inline __attribute__((always_inline))
+#else
+#define IMAGELIB_TARGET_CLONES
+#define IMAGELIB_INLINE inline
+#endif
+
+#endif // VECTORIZE_H
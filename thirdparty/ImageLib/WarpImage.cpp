@@ -18,8 +18,9 @@
 //  degree of freedom:  the slope at (x=1), which we call "a".
 //
 //  For the implementation, we form a LUT for the cubic interpolation
-//  function, and initialize it at the beginning of each image warp
-//  (in case "a" has changed).
+//  function.  One table is built per distinct value of "a" and is never
+//  modified or freed afterwards, so warps running in different threads
+//  can share it without locking (only the lookup takes a mutex).
 //
 // Copyright ?Richard Szeliski, 2001.  See Copyright.h for more details
 //
@@ -29,9 +30,50 @@
 #include "Transform.h"
 #include "WarpImage.h"
 #include <math.h>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 
+//
+//  Piecewise-cubic interpolant with slope a at x=1
+//
+
+static float CubicKernel(float x, float a)
+{
+    x = fabs(x);
+    if (x <= 1.0f)
+        return ((a + 2.0f) * x - (a + 3.0f)) * x * x + 1.0f;
+    if (x < 2.0f)
+        return ((a * x - 5.0f * a) * x + 8.0f * a) * x - 4.0f * a;
+    return 0.0f;
+}
+
+const CCubicLUT& GetCubicLUT(float a)
+{
+    static std::mutex lutMutex;
+    static std::map<float, std::unique_ptr<CCubicLUT> > luts;
+
+    std::lock_guard<std::mutex> lock(lutMutex);
+    std::unique_ptr<CCubicLUT>& lut = luts[a];
+    if (! lut)
+    {
+        lut.reset(new CCubicLUT);
+        lut->a = a;
+        for (int i = 0; i < cubicLUTsize; i++)
+        {
+            float f = i / (float) cubicLUTsize;
+            lut->weights[i][0] = CubicKernel(1.0f + f, a);
+            lut->weights[i][1] = CubicKernel(f, a);
+            lut->weights[i][2] = CubicKernel(1.0f - f, a);
+            lut->weights[i][3] = CubicKernel(2.0f - f, a);
+        }
+    }
+    return *lut;
+}
+
+
 //
 //  Resample a complete image, given source pixel addresses
 //
@@ -50,9 +92,8 @@ void WarpLocal(CImageOf<T> src, CImageOf<T>& dst,
     std::vector<float> rowBuf;
     rowBuf.resize(n*2);
 
-    // Precompute the cubic interpolant
-    if (interp == eWarpInterpCubic)
-        InitializeCubicLUT(cubicA);
+    // Look up the cubic interpolant
+    const CCubicLUT* cubicLUT = (interp == eWarpInterpCubic) ? &GetCubicLUT(cubicA) : NULL;
 
     // Process each row
     for (int y = 0; y < sh.height; y++)
@@ -72,7 +113,7 @@ void WarpLocal(CImageOf<T> src, CImageOf<T>& dst,
         }
 
         // Resample the line
-        WarpLine(src, dstP, xyP, n, sh.nBands, interp, src.MinVal(), src.MaxVal());
+        WarpLine(src, dstP, xyP, n, sh.nBands, interp, src.MinVal(), src.MaxVal(), cubicLUT);
     }
 }
 
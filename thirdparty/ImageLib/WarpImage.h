@@ -37,6 +37,10 @@
 //  is specified by a simple matrix that can be used to represent rigid,
 //  affine, or perspective transforms.
 //
+//  All the functions are reentrant: the cubic interpolation tables are
+//  immutable once built (see GetCubicLUT), so different threads may warp
+//  concurrently, even with different values of cubicA.
+//
 //
 // SEE ALSO
 //  WarpImage.cpp       implementation
@@ -47,7 +51,9 @@
 ///////////////////////////////////////////////////////////////////////////
 
 #include<math.h>
+#include<string.h>
 #include<vector>
+#include "Parallel.h"
 
 enum EWarpInterpolationMode
 {
@@ -57,13 +63,22 @@ enum EWarpInterpolationMode
 };
 
 static const int cubicLUTsize = 256;
-static float cubicInterp[cubicLUTsize][4];
 
+struct CCubicLUT
+{
+    float a;                            // slope of the interpolant at x=1
+    float weights[cubicLUTsize][4];     // 4 tap weights per fractional offset
+};
+
+// Returns the (shared, never modified) table for parameter a
+const CCubicLUT& GetCubicLUT(float a);
 
-static inline float ResampleCubic(float v0, float v1, float v2, float v3, float f)
+
+static inline float ResampleCubic(float v0, float v1, float v2, float v3, float f,
+                                  const CCubicLUT& lut)
 {
     int fi = int(f*cubicLUTsize);
-    float *c = cubicInterp[fi];
+    const float *c = lut.weights[fi];
     float v = c[0]*v0 + c[1]*v1 + c[2]*v2 + c[3]*v3;
     return v;
 }
@@ -74,16 +89,17 @@ static inline float ResampleCubic(float v0, float v1, float v2, float v3, float
 //
 
 template <class T>
-static T ResampleBiCubic(T src[], int oH, int oV, float xf, float yf)
+static T ResampleBiCubic(T src[], int oH, int oV, float xf, float yf,
+                         const CCubicLUT& lut)
 {
     // Resample a pixel using bilinear interpolation
     float h[4];
     for (int i = 0; i < 4; i++)
     {
         int j = (i-1)*oV;
-        h[i] = ResampleCubic(src[j-oH], src[j], src[j+oH], src[j+2*oH], xf);
+        h[i] = ResampleCubic(src[j-oH], src[j], src[j+oH], src[j+2*oH], xf, lut);
     }
-    float  v = ResampleCubic(h[0], h[1], h[2], h[3], yf);
+    float  v = ResampleCubic(h[0], h[1], h[2], h[3], yf, lut);
     return (T) v;
 }
 
@@ -107,12 +123,6 @@ static inline T ResampleBiLinear(T src[], int oH, int oV, float xf, float yf)
     return (T) v;
 }
 
-static void InitializeCubicLUT(float a)
-{
-    float zero = 0.0;      // not implemented yet
-    float error = 1.0f / zero;
-}
-
 template <class T>
 void WarpLocal(CImageOf<T> src, CImageOf<T>& dst,
                CFloatImage uv, bool relativeCoords,
@@ -131,11 +141,16 @@ void WarpGlobal(CImageOf<T> src, CImageOf<T>& dst,
 
 //
 //  Resample a complete line, given the source pixel addresses
+//  (cubicLUT defaults to the table for cubicA = 1)
 //
 template <class T>
 void WarpLine(CImageOf<T> src, T* dstP, float *xyP, int n, int nBands,
-              EWarpInterpolationMode interp, T minVal, T maxVal)
+              EWarpInterpolationMode interp, T minVal, T maxVal,
+              const CCubicLUT* cubicLUT = NULL)
 {
+    if (interp == eWarpInterpCubic && cubicLUT == NULL)
+        cubicLUT = &GetCubicLUT(1.0f);
+
     // Determine the interpolator's "footprint"
     const int o0 = int(interp)/2;       // negative extent
     const int o1 = int(interp) - o0;    // positive extent
@@ -182,7 +197,121 @@ void WarpLine(CImageOf<T> src, T* dstP, float *xyP, int n, int nBands,
         {
             for (int j = 0; j < nBands; j++)
                 dstP[j] = __max(minVal, __min(maxVal,
-                    ResampleBiCubic(&srcP[j], oH, oV, xf, yf)));
+                    ResampleBiCubic(&srcP[j], oH, oV, xf, yf, *cubicLUT)));
+        }
+    }
+}
+
+
+//
+//  Resample a complete line whose source addresses were stepped along an
+//  affine transform, i.e., are monotone in x
+//
+//  The pixels whose interpolator footprint is in bounds then form a single
+//  span.  The span is found by scanning in from both ends, the pixels
+//  outside of it are zeroed wholesale and the ones inside are resampled
+//  without any bounds checks or per-pixel mode dispatch.  When all the
+//  source addresses are on the same row (scaling and translation), the two
+//  source rows are blended once and each output pixel only interpolates
+//  horizontally.
+//
+template <class T>
+void WarpLineAffine(CImageOf<T>& src, T* dstP, const float *xyP, int n, int nBands,
+                    bool sameRow, EWarpInterpolationMode interp,
+                    T minVal, T maxVal, std::vector<float>& rowBuf,
+                    const CCubicLUT* cubicLUT)
+{
+    const int o0 = int(interp)/2;       // negative extent
+    const int o1 = int(interp) - o0;    // positive extent
+    const int oH = nBands;              // horizonal offset between pixels
+    const int oV = &src.Pixel(0, 1, 0) -
+                   &src.Pixel(0, 0, 0); // vertical  offset between pixels
+    CShape sh = src.Shape();
+
+    auto inBounds = [&](int i)
+    {
+        int x = int(floor(xyP[2*i+0]));
+        int y = int(floor(xyP[2*i+1]));
+        return sh.InBounds(x-o0, y-o0) && sh.InBounds(x+o1, y+o1);
+    };
+    int xBegin = 0, xEnd = n;
+    while (xBegin < xEnd && ! inBounds(xBegin))
+        xBegin++;
+    while (xEnd > xBegin && ! inBounds(xEnd-1))
+        xEnd--;
+
+    // Zero the pixels sampling outside the source
+    memset(dstP, 0, xBegin * nBands * sizeof(T));
+    memset(dstP + xEnd * nBands, 0, (n - xEnd) * nBands * sizeof(T));
+    if (xBegin == xEnd)
+        return;
+
+    // Inside the span the coordinates are >= 0, so truncation rounds down
+    T* src0 = &src.Pixel(0, 0, 0);
+    dstP += xBegin * nBands;
+    xyP  += xBegin * 2;
+    int m = xEnd - xBegin;
+
+    if (interp == eWarpInterpNearest)
+    {
+        for (int i = 0; i < m; i++, dstP += nBands, xyP += 2)
+        {
+            const T* srcP = src0 + int(xyP[1]) * oV + int(xyP[0]) * oH;
+            for (int j = 0; j < nBands; j++)
+                dstP[j] = srcP[j];
+        }
+    }
+    else if (interp == eWarpInterpLinear && sameRow)
+    {
+        // Blend the two source rows over the columns used by the span
+        int y   = int(xyP[1]);
+        float yf = xyP[1] - y;
+        int c0  = __min(int(xyP[0]), int(xyP[2*(m-1)]));
+        int c1  = __max(int(xyP[0]), int(xyP[2*(m-1)])) + 1;
+        int len = (c1 - c0 + 1) * nBands;
+        rowBuf.resize(len);
+        const T* r0 = src0 + y * oV + c0 * oH;
+        const T* r1 = r0 + oV;
+        float* v = &rowBuf[0];
+        for (int i = 0; i < len; i++)
+            v[i] = ResampleLinear(r0[i], r1[i], yf);
+
+        for (int i = 0; i < m; i++, dstP += nBands, xyP += 2)
+        {
+            int x = int(xyP[0]);
+            float xf = xyP[0] - x;
+            const float* vP = v + (x - c0) * nBands;
+            for (int j = 0; j < nBands; j++)
+                dstP[j] = __max(minVal, __min(maxVal,
+                    (T) ResampleLinear(vP[j], vP[j+oH], xf)));
+        }
+    }
+    else if (interp == eWarpInterpLinear)
+    {
+        for (int i = 0; i < m; i++, dstP += nBands, xyP += 2)
+        {
+            int x = int(xyP[0]);
+            int y = int(xyP[1]);
+            float xf = xyP[0] - x;
+            float yf = xyP[1] - y;
+            T* srcP = src0 + y * oV + x * oH;
+            for (int j = 0; j < nBands; j++)
+                dstP[j] = __max(minVal, __min(maxVal,
+                    ResampleBiLinear(&srcP[j], oH, oV, xf, yf)));
+        }
+    }
+    else
+    {
+        for (int i = 0; i < m; i++, dstP += nBands, xyP += 2)
+        {
+            int x = int(xyP[0]);
+            int y = int(xyP[1]);
+            float xf = xyP[0] - x;
+            float yf = xyP[1] - y;
+            T* srcP = src0 + y * oV + x * oH;
+            for (int j = 0; j < nBands; j++)
+                dstP[j] = __max(minVal, __min(maxVal,
+                    ResampleBiCubic(&srcP[j], oH, oV, xf, yf, *cubicLUT)));
         }
     }
 }
@@ -200,51 +329,61 @@ void WarpGlobal(CImageOf<T> src, CImageOf<T>& dst,
     if (dst.Shape().width == 0)
         dst.ReAllocate(src.Shape());
     CShape sh = dst.Shape();
-
-    // Allocate a row buffer for coordinates
     int n = sh.width;
-    std::vector<float> rowBuf;
-    rowBuf.resize(n*2);
 
-    // Precompute the cubic interpolant
-    if (interp == eWarpInterpCubic)
-        InitializeCubicLUT(cubicA);
+    // Look up the cubic interpolant
+    const CCubicLUT* cubicLUT = (interp == eWarpInterpCubic) ? &GetCubicLUT(cubicA) : NULL;
 
-    // Process each row
-    for (int y = 0; y < sh.height; y++)
+    // When the homogeneous coordinate does not change along a row (affine
+    // transforms), the source address is an affine function of x
+    bool affine = (M[2][0] == 0.0);
+    T minVal = src.MinVal(), maxVal = src.MaxVal();
+
+    // Large images are split into bands of rows, one per thread
+    int grain = __max(1, (1 << 15) / __max(1, n));
+    ParallelFor(0, sh.height, [&](int yBegin, int yEnd)
     {
-        float *xyP  = &rowBuf[0];
-        T *dstP     = &dst.Pixel(0, y, 0);
-
-        // Compute pixel coordinates
-        float X0 = (float) (M[0][1]*y + M[0][2]);
-        float dX = (float) M[0][0];
-        float Y0 = (float) (M[1][1]*y + M[1][2]);
-        float dY = (float) M[1][0];
-        float Z0 = (float) (M[2][1]*y + M[2][2]);
-        float dZ = (float) M[2][0];
-        bool affine = (dZ == 0.0);
-        float Zi = 1.0f / Z0;           // TODO:  doesn't guard against divide by 0
-        if (affine)
-        {
-            X0 *= Zi, dX *= Zi, Y0 *= Zi, dY *= Zi;
-        }
-        for (int x = 0; x < n; x++)
+        // Allocate row buffers for coordinates and blended source rows
+        std::vector<float> rowBuf(n*2), blendBuf;
+
+        // Process each row
+        for (int y = yBegin; y < yEnd; y++)
         {
-            xyP[2*x+0] = X0 * Zi;
-            xyP[2*x+1] = Y0 * Zi;
-            X0 += dX;
-            Y0 += dY;
-            if (! affine)
+            float *xyP  = &rowBuf[0];
+            T *dstP     = &dst.Pixel(0, y, 0);
+
+            // Compute pixel coordinates
+            float X0 = (float) (M[0][1]*y + M[0][2]);
+            float dX = (float) M[0][0];
+            float Y0 = (float) (M[1][1]*y + M[1][2]);
+            float dY = (float) M[1][0];
+            float Z0 = (float) (M[2][1]*y + M[2][2]);
+            float dZ = (float) M[2][0];
+            float Zi = 1.0f / Z0;       // TODO:  doesn't guard against divide by 0
+            if (affine)
             {
-                Z0 += dZ;
-                Zi = 1.0f / Z0;
+                X0 *= Zi, dX *= Zi, Y0 *= Zi, dY *= Zi;
+                Zi = 1.0f;
+            }
+            for (int x = 0; x < n; x++)
+            {
+                xyP[2*x+0] = X0 * Zi;
+                xyP[2*x+1] = Y0 * Zi;
+                X0 += dX;
+                Y0 += dY;
+                if (! affine)
+                {
+                    Z0 += dZ;
+                    Zi = 1.0f / Z0;
+                }
             }
-        }
 
-        // Resample the line
-        WarpLine(src, dstP, xyP, n, sh.nBands, interp, src.MinVal(), src.MaxVal());
-    }
+            // Resample the line
+            if (affine)
+                WarpLineAffine(src, dstP, xyP, n, sh.nBands, dY == 0.0f, interp,
+                               minVal, maxVal, blendBuf, cubicLUT);
+            else
+                WarpLine(src, dstP, xyP, n, sh.nBands, interp, minVal, maxVal, cubicLUT);
+        }
+    }, grain);
 }
-
-
@@ -0,0 +1,303 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ColorConvertTest.cpp -- color conversions against the original formulas
+//
+// DESCRIPTION
+//  Runs the color conversion kernels (directly and through ConvertToGray,
+//  ConvertToRGBA and the ColorConvert.h image routines) on random pixels
+//  and on special float values (signed zeros, denormals, FLT_MAX,
+//  infinities, NaNs), for widths that exercise the vector loop tails, and
+//  checks that every output is bit for bit the one of the scalar code
+//  they replaced:
+//
+//      ConvertToGray           Y = 0.212671 R + 0.715160 G + 0.072169 B in
+//                              float, clipped, truncated for uchar
+//      ColorToGrayAverage      convertRGB2GrayImage: B / 3.0 + G / 3.0 +
+//                              R / 3.0 in double, truncated
+//      SwapRedBlue             the JPEG reader's band reversal
+//      ConvertToRGBA           gray copied to B, G, R, alpha = 255
+//
+//  The uchar ColorToGray kernel has no original counterpart: it is checked
+//  against the fixed-point formula of ColorToGray (see ColorConvert.h),
+//  and for keeping gray pixels unchanged.  Returns non-zero if any check
+//  fails.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "Convert.h"
+#include "ColorConvert.h"
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <limits>
+#include <random>
+#include <algorithm>
+
+static std::mt19937 generator(39);
+static int nChecks = 0, nFailed = 0;
+
+static const float specialValues[] = {
+	0.0f, -0.0f, 1.0f, -1.0f, 255.0f, 0.5f, 1e-40f, -1e-40f, FLT_MIN, FLT_MAX, -FLT_MAX,
+	1e38f, -1e38f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+	std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN()
+};
+static const int nSpecialValues = sizeof(specialValues) / sizeof(specialValues[0]);
+
+static void Randomize(CByteImage& img)
+{
+	std::uniform_int_distribution<int> value(0, 255);
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+			for (int b = 0; b < sh.nBands; b++)
+				img.Pixel(x, y, b) = (uchar) value(generator);
+}
+
+// Random values in the uchar range and beyond on the first rows, special
+// values mixed with them on the others
+static void Randomize(CFloatImage& img)
+{
+	std::uniform_real_distribution<float> value(-300.0f, 300.0f);
+	std::uniform_int_distribution<int> special(0, 4 * nSpecialValues - 1);
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+			for (int b = 0; b < sh.nBands; b++)
+			{
+				int s = (y < sh.height / 2) ? nSpecialValues : special(generator);
+				img.Pixel(x, y, b) = (s < nSpecialValues) ? specialValues[s] : value(generator);
+			}
+}
+
+template <class T>
+static void Expect(const char* what, int width, int nBands, CImageOf<T>& expected, CImageOf<T>& result)
+{
+	CShape sh = expected.Shape();
+	bool same = (result.Shape() == sh);
+	for (int y = 0; same && y < sh.height; y++)
+		same = (memcmp(&expected.Pixel(0, y, 0), &result.Pixel(0, y, 0), sh.width * sh.nBands * sizeof(T)) == 0);
+	nChecks++;
+	if (! same)
+	{
+		printf("FAILED: %s, width %d, %d bands\n", what, width, nBands);
+		nFailed++;
+	}
+}
+
+//
+//  The original scalar code
+//
+
+template <class T>
+static CImageOf<T> LegacyConvertToGray(CImageOf<T> src)
+{
+	CShape sShape = src.Shape();
+	CImageOf<T> dst(CShape(sShape.width, sShape.height, 1));
+	T minVal = dst.MinVal();
+	T maxVal = dst.MaxVal();
+	for (int y = 0; y < sShape.height; y++)
+	{
+		T* srcP = &src.Pixel(0, y, 0);
+		T* dstP = &dst.Pixel(0, y, 0);
+		for (int x = 0; x < sShape.width; x++, srcP += 3, dstP++)
+		{
+			RGBA<T>& p = *(RGBA<T> *) srcP;
+			float Y = 0.212671f * p.R + 0.715160f * p.G + 0.072169f * p.B;
+			*dstP = (T) __min(maxVal, __max(minVal, Y));
+		}
+	}
+	return dst;
+}
+
+template <class T>
+static void LegacyRGB2Gray(const CImageOf<T>& rgb, CImageOf<T>& gray)
+{
+	CShape shape = rgb.Shape();
+	shape.nBands = 1;
+	gray.ReAllocate(shape);
+	for (int i = 0; i < shape.height; i++)
+		for (int j = 0; j < shape.width; j++)
+		{
+			gray.Pixel(j, i, 0) = 0;
+			double val = 0.0;
+			for (int c = 0; c < rgb.Shape().nBands; c++)
+				val += rgb.Pixel(j, i, c) / 3.0;
+			gray.Pixel(j, i, 0) = std::min((double) gray.MaxVal(), (double) val);
+		}
+}
+
+template <class T>
+static void LegacyReverseBands(CImageOf<T>& src, CImageOf<T>& dst)
+{
+	CShape shape = src.Shape();
+	dst.ReAllocate(shape);
+	for (int y = 0; y < shape.height; y++)
+	{
+		T* auxIt = &src.Pixel(0, y, 0);
+		T* imgIt = &dst.Pixel(0, y, 0);
+		for (int x = 0; x < shape.width; x++, auxIt += shape.nBands, imgIt += shape.nBands)
+			for (int c = 0; c < shape.nBands; c++)
+				imgIt[c] = auxIt[shape.nBands - c - 1];
+	}
+}
+
+template <class T>
+static CImageOf<T> LegacyConvertToRGBA(CImageOf<T> src)
+{
+	CShape sShape = src.Shape();
+	CImageOf<T> dst(CShape(sShape.width, sShape.height, 4));
+	int aC = dst.alphaChannel;
+	for (int y = 0; y < sShape.height; y++)
+	{
+		T* srcP = &src.Pixel(0, y, 0);
+		T* dstP = &dst.Pixel(0, y, 0);
+		for (int x = 0; x < sShape.width; x++, srcP++)
+			for (int b = 0; b < 4; b++, dstP++)
+				*dstP = (b == aC) ? 255 : *srcP;
+	}
+	return dst;
+}
+
+// ColorToGray on uchar pixels, as specified in ColorConvert.h
+static CByteImage FixedPointGray(CByteImage& src, const CGrayWeights& w)
+{
+	const float one = (float) (1 << grayFixedBits);
+	int wr = (int) lrintf(w.r * one), wg = (int) lrintf(w.g * one), wb = (int) lrintf(w.b * one);
+	int err = (int) lrintf((w.r + w.g + w.b) * one) - (wr + wg + wb);
+	int* largest = (abs(wg) >= abs(wr) && abs(wg) >= abs(wb)) ? &wg : (abs(wr) >= abs(wb)) ? &wr : &wb;
+	*largest += err;
+
+	CShape sh = src.Shape();
+	CByteImage dst(CShape(sh.width, sh.height, 1));
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+		{
+			int Y = (wr * src.Pixel(x, y, 2) + wg * src.Pixel(x, y, 1) + wb * src.Pixel(x, y, 0) +
+					 (1 << (grayFixedBits - 1))) >> grayFixedBits;
+			dst.Pixel(x, y, 0) = (uchar) std::min(std::max(Y, 0), 255);
+		}
+	return dst;
+}
+
+//
+//  Checks
+//
+
+template <class T>
+static void CheckGray(int width, int height)
+{
+	CImageOf<T> rgb(width, height, 3), rgba(width, height, 4), gray, expected;
+	Randomize(rgb);
+	Randomize(rgba);
+
+	expected = LegacyConvertToGray(rgb);
+	gray = ConvertToGray(rgb);
+	Expect("ConvertToGray", width, 3, expected, gray);
+
+	// convertRGB2GrayImage, also in place
+	LegacyRGB2Gray(rgb, expected);
+	ColorToGrayAverage(rgb, gray);
+	Expect("ColorToGrayAverage", width, 3, expected, gray);
+	CImageOf<T> inPlace;
+	CopyPixels(rgb, inPlace);
+	ColorToGrayAverage(inPlace, inPlace);
+	Expect("ColorToGrayAverage in place", width, 3, expected, inPlace);
+
+	// 4-band sources: the alpha band is ignored
+	CImageOf<T> stripped;
+	StripAlpha(rgba, stripped);
+	LegacyRGB2Gray(stripped, expected);
+	ColorToGrayAverage(rgba, gray);
+	Expect("ColorToGrayAverage of BGRA", width, 4, expected, gray);
+	ColorToGray(stripped, expected);
+	ColorToGray(rgba, gray);
+	Expect("ColorToGray of BGRA", width, 4, expected, gray);
+}
+
+// The uchar to float kernel is the float formula of ConvertToGray
+static void CheckGrayToFloat(int width, int height)
+{
+	CByteImage rgb(width, height, 3);
+	CFloatImage rgbFloat(width, height, 3), result(width, height, 1);
+	Randomize(rgb);
+	CopyPixels(rgb, rgbFloat);
+	CFloatImage expected = LegacyConvertToGray(rgbFloat);
+	for (int y = 0; y < height; y++)
+		ColorToGrayLine(&rgb.Pixel(0, y, 0), 3, &result.Pixel(0, y, 0), width, grayWeightsLuminance);
+	Expect("ColorToGrayLine to float", width, 3, expected, result);
+}
+
+static void CheckFixedPointGray(int width, int height)
+{
+	const CGrayWeights weights[] = {
+		grayWeightsLuminance, grayWeightsAverage, {0.299f, 0.587f, 0.114f}, {1.5f, -0.25f, -0.25f}
+	};
+	CByteImage rgb(width, height, 3), gray;
+	Randomize(rgb);
+	for (int k = 0; k < 4; k++)
+	{
+		CByteImage expected = FixedPointGray(rgb, weights[k]);
+		ColorToGray(rgb, gray, weights[k]);
+		Expect("ColorToGray", width, 3, expected, gray);
+	}
+
+	// Gray pixels stay gray, for weights that add up to 1
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			rgb.Pixel(x, y, 0) = rgb.Pixel(x, y, 1) = rgb.Pixel(x, y, 2) = (uchar) ((x + 7 * y) & 255);
+	CByteImage expected(width, height, 1);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			expected.Pixel(x, y, 0) = rgb.Pixel(x, y, 0);
+	for (int k = 0; k < 3; k++)
+	{
+		ColorToGray(rgb, gray, weights[k]);
+		Expect("ColorToGray of gray pixels", width, 3, expected, gray);
+	}
+}
+
+template <class T>
+static void CheckBands(int width, int height)
+{
+	CImageOf<T> rgb(width, height, 3), gray(width, height, 1), expected, result;
+	Randomize(rgb);
+	Randomize(gray);
+
+	// The JPEG reader's band reversal, for the 1 and 3 band files it reads
+	LegacyReverseBands(rgb, expected);
+	SwapRedBlue(rgb, result);
+	Expect("SwapRedBlue", width, 3, expected, result);
+	LegacyReverseBands(gray, expected);
+	SwapRedBlue(gray, result);
+	Expect("SwapRedBlue", width, 1, expected, result);
+
+	expected = LegacyConvertToRGBA(gray);
+	result = ConvertToRGBA(gray);
+	Expect("ConvertToRGBA", width, 1, expected, result);
+
+	// InsertAlpha and StripAlpha undo each other
+	CImageOf<T> rgba, back;
+	InsertAlpha(rgb, rgba, (T) 255);
+	StripAlpha(rgba, back);
+	Expect("InsertAlpha then StripAlpha", width, 3, rgb, back);
+}
+
+int main(void)
+{
+	const int widths[] = { 1, 2, 7, 15, 16, 17, 31, 33, 64, 101 };
+	for (int w = 0; w < 10; w++)
+	{
+		CheckGray<uchar>(widths[w], 5);
+		CheckGray<float>(widths[w], 5);
+		CheckGrayToFloat(widths[w], 5);
+		CheckFixedPointGray(widths[w], 5);
+		CheckBands<uchar>(widths[w], 5);
+		CheckBands<float>(widths[w], 5);
+	}
+
+	printf("%d of %d color conversions match the original formulas\n", nChecks - nFailed, nChecks);
+	return nFailed > 0;
+}
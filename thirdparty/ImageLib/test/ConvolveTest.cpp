@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ConvolveTest.cpp -- Convolve against the original implementation
+//
+// DESCRIPTION
+//  Convolves random 8-bit, int and float images with a set of kernels
+//  (box, Gaussian, derivative and random ones, with various sizes and
+//  origins) and checks that the output is bit for bit the one of the
+//  original per pixel loop (LegacyConvolve.h).  Returns non-zero if any
+//  pixel differs.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "Convolve.h"
+#include "LegacyConvolve.h"
+#include <stdio.h>
+#include <string.h>
+#include <random>
+
+static std::mt19937 generator(29);
+
+static void Randomize(CByteImage& img)
+{
+	std::uniform_int_distribution<int> value(0, 255);
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+			for (int b = 0; b < sh.nBands; b++)
+				img.Pixel(x, y, b) = (uchar) value(generator);
+}
+
+static void Randomize(CIntImage& img)
+{
+	std::uniform_int_distribution<int> value(-100000, 100000);
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+			for (int b = 0; b < sh.nBands; b++)
+				img.Pixel(x, y, b) = value(generator);
+}
+
+static void Randomize(CFloatImage& img)
+{
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+		for (int x = 0; x < sh.width; x++)
+			for (int b = 0; b < sh.nBands; b++)
+				img.Pixel(x, y, b) = value(generator);
+}
+
+static CFloatImage BoxKernel(int width, int height)
+{
+	CFloatImage kernel(width, height, 1);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			kernel.Pixel(x, y, 0) = 1.0f / (width * height);
+	kernel.origin[0] = width / 2;
+	kernel.origin[1] = height / 2;
+	return kernel;
+}
+
+static CFloatImage RandomKernel(int width, int height)
+{
+	std::uniform_real_distribution<float> tap(-1.0f, 1.0f);
+	CFloatImage kernel(width, height, 1);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			kernel.Pixel(x, y, 0) = tap(generator);
+	kernel.origin[0] = std::uniform_int_distribution<int>(-1, width)(generator);
+	kernel.origin[1] = std::uniform_int_distribution<int>(-1, height)(generator);
+	return kernel;
+}
+
+template <class T>
+static int CountDifferences(CImageOf<T>& a, CImageOf<T>& b)
+{
+	CShape sh = a.Shape();
+	int n = 0;
+	for (int y = 0; y < sh.height; y++)
+		n += (memcmp(&a.Pixel(0, y, 0), &b.Pixel(0, y, 0), sh.width * sh.nBands * sizeof(T)) != 0);
+	return n;
+}
+
+template <class T>
+static int Check(const char* type, const char* name, CFloatImage kernel, int width, int height, int nBands)
+{
+	CImageOf<T> src(width, height, nBands), expected, result;
+	Randomize(src);
+	LegacyConvolve(src, expected, kernel);
+	Convolve(src, result, kernel);
+
+	int nRows = CountDifferences(expected, result);
+	if (nRows > 0)
+		printf("FAILED: %s %s on %dx%dx%d, %d rows differ\n", type, name, width, height, nBands, nRows);
+	return nRows > 0;
+}
+
+static int CheckAllTypes(const char* name, CFloatImage kernel, int width, int height, int nBands)
+{
+	return Check<uchar>("uchar", name, kernel, width, height, nBands) +
+		   Check<int>("int", name, kernel, width, height, nBands) +
+		   Check<float>("float", name, kernel, width, height, nBands);
+}
+
+int main(void)
+{
+	int nFailed = 0, nChecks = 0;
+	const int sizes[][3] = { {37, 23, 1}, {37, 23, 3}, {64, 48, 4}, {5, 2, 1} };
+	for (int s = 0; s < 4; s++)
+	{
+		int w = sizes[s][0], h = sizes[s][1], nB = sizes[s][2];
+		nFailed += CheckAllTypes("3x3 box", BoxKernel(3, 3), w, h, nB);
+		nFailed += CheckAllTypes("5x5 box", BoxKernel(5, 5), w, h, nB);
+		nFailed += CheckAllTypes("7x7 Gaussian", ConvolveKernel_7x7(), w, h, nB);
+		nFailed += CheckAllTypes("1-2-1", ConvolveKernel_121(), w, h, nB);
+		nFailed += CheckAllTypes("1-4-6-4-1", ConvolveKernel_14641(), w, h, nB);
+		nFailed += CheckAllTypes("8-tap low pass", ConvolveKernel_8tapLowPass(), w, h, nB);
+		nFailed += CheckAllTypes("Sobel x", ConvolveKernel_SobelX(), w, h, nB);
+		nFailed += CheckAllTypes("Sobel y", ConvolveKernel_SobelY(), w, h, nB);
+		nChecks += 8 * 3;
+
+		const int kSizes[][2] = { {5, 3}, {3, 5}, {1, 7}, {7, 1}, {4, 6}, {9, 9}, {1, 1} };
+		for (int k = 0; k < 7; k++)
+		{
+			char name[64];
+			sprintf(name, "random %dx%d", kSizes[k][0], kSizes[k][1]);
+			nFailed += CheckAllTypes(name, RandomKernel(kSizes[k][0], kSizes[k][1]), w, h, nB);
+			nChecks += 3;
+		}
+	}
+
+	printf("%d of %d convolutions match the original implementation\n", nChecks - nFailed, nChecks);
+	return nFailed > 0;
+}
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  LegacyConvolve.h -- the original, unoptimized 2D convolution
+//
+// DESCRIPTION
+//  Reference for ConvolveTest and ConvolveBenchmark: the per pixel loop
+//  Convolve used to run, bounds checking every tap and summing the kernel
+//  column by column in double.  Taps outside the image are skipped, which
+//  is what Convolve does with the default eBorderZero borderMode.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+
+template <class T>
+void LegacyConvolve(CImageOf<T> src, CImageOf<T>& dst, CFloatImage kernel)
+{
+	CShape kShape = kernel.Shape();
+	CShape sShape = src.Shape();
+	dst.ReAllocate(sShape, false);
+
+	for (int y = 0; y < sShape.height; y++)
+		for (int x = 0; x < sShape.width; x++)
+			for (int c = 0; c < sShape.nBands; c++)
+			{
+				double sum = 0;
+				for (int kx = 0; kx < kShape.width; kx++)
+					for (int ky = 0; ky < kShape.height; ky++)
+						if ((x-kernel.origin[0]+kx >= 0) && (x-kernel.origin[0]+kx < sShape.width) && (y-kernel.origin[1]+ky >= 0) && (y-kernel.origin[1]+ky < sShape.height))
+							sum += kernel.Pixel(kx,ky,0) * src.Pixel(x-kernel.origin[0]+kx,y-kernel.origin[1]+ky,c);
+				dst.Pixel(x,y,c) = (T) __max(dst.MinVal(), __min(dst.MaxVal(), sum));
+			}
+}
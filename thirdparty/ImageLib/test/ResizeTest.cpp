@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ResizeTest.cpp -- Resize on sizes whose pixel count products overflow
+//
+// DESCRIPTION
+//  Resizes constant images between sizes whose width * height products
+//  wrap around in 32 bit arithmetic (power of two shrinks, 256x256 and
+//  larger at the same size) as well as ordinary ones, with every filter,
+//  and checks that every output pixel has the constant value (for float,
+//  up to the rounding of the normalized filter taps).  Same size resizes of
+//  random images must return the input exactly.  Returns non-zero if any
+//  check fails.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "Image.h"
+#include "Resize.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+
+static int nChecks = 0, nFailed = 0;
+
+static const char* filterNames[] = { "box", "linear", "Lanczos3" };
+
+template <class T>
+static void Fill(CImageOf<T>& img, T value)
+{
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+	{
+		T* p = &img.Pixel(0, y, 0);
+		for (int i = 0; i < sh.width * sh.nBands; i++)
+			p[i] = value;
+	}
+}
+
+template <class T>
+static void CheckConstant(const char* type, T value, int sw, int sh, int dw, int dh, EResizeFilter filter)
+{
+	CImageOf<T> src(sw, sh, 1), dst(dw, dh, 1);
+	Fill(src, value);
+	Fill(dst, (T) 0);
+	Resize(src, dst, filter);
+
+	int nWrong = 0;
+	CShape dShape = dst.Shape();
+	for (int y = 0; y < dShape.height; y++)
+		for (int x = 0; x < dShape.width; x++)
+			nWrong += (fabs(dst.Pixel(x, y, 0) - (float) value) > 1e-5f * value);
+
+	nChecks++;
+	if (dShape.width != dw || dShape.height != dh || nWrong > 0)
+	{
+		printf("FAILED: %s %dx%d -> %dx%d (%s), %d pixels wrong\n", type, sw, sh, dw, dh,
+			   filterNames[filter], nWrong);
+		nFailed++;
+	}
+}
+
+template <class T>
+static void CheckSameSize(const char* type, int w, int h, EResizeFilter filter)
+{
+	std::mt19937 generator(33);
+	CImageOf<T> src(w, h, 3), dst(w, h, 3);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			for (int b = 0; b < 3; b++)
+				src.Pixel(x, y, b) = (T) (generator() & 255);
+	Resize(src, dst, filter);
+
+	bool same = true;
+	for (int y = 0; y < h; y++)
+		same &= (memcmp(&src.Pixel(0, y, 0), &dst.Pixel(0, y, 0), w * 3 * sizeof(T)) == 0);
+
+	nChecks++;
+	if (! same)
+	{
+		printf("FAILED: same size %s %dx%d (%s) changed the image\n", type, w, h, filterNames[filter]);
+		nFailed++;
+	}
+}
+
+int main(void)
+{
+	// width * height * width * height overflows for all but the last two
+	const int sizes[][4] = {
+		{1024, 1024, 512, 512}, {256, 256, 256, 256}, {512, 512, 256, 256},
+		{1024, 1024, 1024, 1024}, {2048, 64, 1024, 32}, {1024, 1024, 500, 500},
+		{64, 48, 32, 24}
+	};
+	for (int f = 0; f < 3; f++)
+	{
+		EResizeFilter filter = (EResizeFilter) f;
+		for (int s = 0; s < 7; s++)
+		{
+			CheckConstant<float>("float", 7.0f, sizes[s][0], sizes[s][1], sizes[s][2], sizes[s][3], filter);
+			CheckConstant<uchar>("uchar", (uchar) 7, sizes[s][0], sizes[s][1], sizes[s][2], sizes[s][3], filter);
+		}
+		CheckSameSize<float>("float", 256, 256, filter);
+		CheckSameSize<uchar>("uchar", 256, 256, filter);
+		CheckSameSize<uchar>("uchar", 37, 23, filter);
+	}
+
+	printf("%d of %d resizes are correct\n", nChecks - nFailed, nChecks);
+	return nFailed > 0;
+}
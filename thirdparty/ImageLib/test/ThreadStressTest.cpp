@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// NAME
+//  ThreadStressTest.cpp -- ImageLib used from many threads at once
+//
+// DESCRIPTION
+//  Starts nThreads threads together (so that the first calls to the
+//  default kernels race) which, for nIterations, copy and release an image
+//  shared by all of them, warp it with cubic tables for several values of
+//  cubicA, convolve it and build pyramids from it.  Every thread must get
+//  the same results as the others, and the shared image must come out
+//  unchanged.
+//
+//  The data races it is meant to reveal are only reported reliably when
+//  built with ThreadSanitizer, see IMAGELIB_THREAD_SANITIZER in
+//  CMakeLists.txt.  Usage: imagelib_stress_test [nThreads [nIterations]]
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include "ImageLib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <algorithm>
+
+static const float cubicAs[] = { -0.5f, -0.75f, -1.0f, 0.5f, 1.0f };
+static const int nCubicAs = sizeof(cubicAs) / sizeof(cubicAs[0]);
+
+// FNV-1a hash of the pixels of an image
+template <class T>
+static unsigned long long Checksum(CImageOf<T>& img, unsigned long long h = 14695981039346656037ULL)
+{
+	CShape sh = img.Shape();
+	for (int y = 0; y < sh.height; y++)
+	{
+		const unsigned char* p = (const unsigned char*) &img.Pixel(0, y, 0);
+		for (int i = 0; i < sh.width * sh.nBands * (int) sizeof(T); i++)
+			h = (h ^ p[i]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+struct CStressResult
+{
+	const CFloatImage* kernels[6];
+	const CCubicLUT* luts[nCubicAs];
+	unsigned long long checksums[nCubicAs];    // of the results with each cubicA
+	int nErrors;
+};
+
+static void Stress(CByteImage shared, int thread, int nIterations,
+				   std::atomic<int>& nWaiting, CStressResult& result)
+{
+	// Wait for all the threads so that the kernels are first built concurrently
+	nWaiting--;
+	while (nWaiting > 0)
+		std::this_thread::yield();
+
+	result.kernels[0] = &ConvolveKernel_121();
+	result.kernels[1] = &ConvolveKernel_14641();
+	result.kernels[2] = &ConvolveKernel_7x7();
+	result.kernels[3] = &ConvolveKernel_8tapLowPass();
+	result.kernels[4] = &ConvolveKernel_SobelX();
+	result.kernels[5] = &ConvolveKernel_SobelY();
+	for (int j = 0; j < nCubicAs; j++)
+	{
+		int k = (j + thread) % nCubicAs;
+		result.luts[k] = &GetCubicLUT(cubicAs[k]);
+	}
+
+	std::fill(result.checksums, result.checksums + nCubicAs, 0);
+	result.nErrors = 0;
+	for (int it = 0; it < nIterations; it++)
+	{
+		// Copies of the shared image, handed between threads' copies
+		std::vector<CByteImage> copies(8, shared);
+		CByteImage moved = std::move(copies.back());
+		copies.pop_back();
+		copies[thread % copies.size()] = moved;
+		for (size_t c = 0; c < copies.size(); c++)
+			if (&copies[c].Pixel(0, 0, 0) != &shared.Pixel(0, 0, 0))
+				result.nErrors++;
+		copies.clear();
+
+		// Cubic warps, each iteration with another parameter
+		int k = (it + thread) % nCubicAs;
+		float a = cubicAs[k];
+		if (GetCubicLUT(a).a != a)
+			result.nErrors++;
+		CByteImage warped;
+		CTransform3x3 M = CTransform3x3::Translation(0.25f, 0.75f) * CTransform3x3::Rotation(5.0f);
+		WarpGlobal(shared, warped, M, eWarpInterpCubic, a);
+		unsigned long long h = Checksum(warped);
+
+		// Convolutions with the default kernels
+		CByteImage smoothed;
+		Convolve(shared, smoothed, ConvolveKernel_7x7());
+		h = Checksum(smoothed, h);
+		CFloatImage gradient, floatImage(shared.Shape());
+		CopyPixels(shared, floatImage);
+		Convolve(floatImage, gradient, ConvolveKernel_SobelX());
+		h = Checksum(gradient, h);
+
+		// Pyramids
+		CBytePyramid pyramid(shared);
+		pyramid.UpLevel(0, 3);
+		h = Checksum(pyramid[3], h);
+		CFloatScalePyramid scalePyramid(3);
+		scalePyramid.Build(floatImage);
+		h = Checksum(scalePyramid[scalePyramid.NLevels() - 1], h);
+
+		if (result.checksums[k] != 0 && result.checksums[k] != h)
+			result.nErrors++;
+		result.checksums[k] = h;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int nThreads    = (argc > 1) ? atoi(argv[1]) : 8;
+	int nIterations = (argc > 2) ? atoi(argv[2]) : 20;
+	nIterations = __max(nIterations, nCubicAs);     // every cubicA in every thread
+
+	CByteImage shared(97, 61, 3);
+	std::mt19937 generator(34);
+	for (int y = 0; y < 61; y++)
+		for (int x = 0; x < 97; x++)
+			for (int b = 0; b < 3; b++)
+				shared.Pixel(x, y, b) = (uchar) (generator() & 255);
+	unsigned long long before = Checksum(shared);
+
+	std::vector<CStressResult> results(nThreads);
+	std::vector<std::thread> threads;
+	std::atomic<int> nWaiting(nThreads);
+	for (int t = 0; t < nThreads; t++)
+		threads.push_back(std::thread(Stress, shared, t, nIterations,
+									  std::ref(nWaiting), std::ref(results[t])));
+	for (int t = 0; t < nThreads; t++)
+		threads[t].join();
+
+	int nFailed = 0;
+	for (int t = 0; t < nThreads; t++)
+	{
+		CStressResult& r = results[t];
+		bool same = (r.nErrors == 0);
+		for (int k = 0; k < 6; k++)
+			same &= (r.kernels[k] == results[0].kernels[k]);
+		for (int k = 0; k < nCubicAs; k++)
+			same &= (r.luts[k] == results[0].luts[k] && r.checksums[k] == results[0].checksums[k]);
+		if (! same)
+		{
+			printf("FAILED: thread %d does not agree with thread 0\n", t);
+			nFailed++;
+		}
+	}
+	if (Checksum(shared) != before)
+	{
+		printf("FAILED: the shared image was modified\n");
+		nFailed++;
+	}
+
+	printf("%d threads x %d iterations: %s\n", nThreads, nIterations, nFailed ? "FAILED" : "OK");
+	return nFailed > 0;
+}
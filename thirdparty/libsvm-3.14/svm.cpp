@@ -7,6 +7,14 @@
 #include <stdarg.h>
 #include <limits.h>
 #include <locale.h>
+#include <mutex>
+#include <atomic>
+#if defined(_WIN32) || defined(_WIN64)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 #include "svm.h"
 int libsvm_version = LIBSVM_VERSION;
 typedef float Qfloat;
@@ -38,6 +46,93 @@ static inline double powi(double base, int times)
 #define TAU 1e-12
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 
+//
+// Dense vectors (svm_dense_node, see svm.h)
+//
+// The dense loops keep 8 partial sums so that they vectorize; with GCC on
+// x86-64 Linux they are also compiled for AVX2, picked at load time.
+// Products of floats are exact in double, so only the order of the
+// additions differs from the sparse dot product.
+//
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define SVM_TARGET_CLONES __attribute__((target_clones("avx2","default")))
+#else
+#define SVM_TARGET_CLONES
+#endif
+
+//
+// Loops run on the caller's threads (see svm_set_parallel_function)
+//
+static void (*svm_parallel_for)(int begin, int end, int grain,
+	void (*fn)(int, int, void *), void *arg) = NULL;
+
+template <class F> static void call_range(int begin, int end, void *fn)
+{
+	(*(const F *)fn)(begin,end);
+}
+
+// calls fn(b, e) on subranges covering [begin, end), in parallel if a
+// parallel function is set and there are at least two grains of work
+template <class F> static void parallel_range(int begin, int end, int grain, const F& fn)
+{
+	if(svm_parallel_for == NULL || end-begin < 2*grain)
+	{
+		if(begin < end)
+			fn(begin,end);
+	}
+	else
+		svm_parallel_for(begin,end,grain,&call_range<F>,(void *)&fn);
+}
+
+static inline const svm_dense_node *dense(const svm_node *x)
+{
+	return (x->index == SVM_DENSE_INDEX) ? (const svm_dense_node *)x : NULL;
+}
+
+SVM_TARGET_CLONES
+static double dense_dot(const float *px, const float *py, int n)
+{
+	double sum[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	int k = 0;
+	for(; k+8<=n; k+=8)
+		for(int j=0;j<8;j++)
+			sum[j] += (double)px[k+j] * (double)py[k+j];
+	double total = ((sum[0]+sum[1])+(sum[2]+sum[3]))+((sum[4]+sum[5])+(sum[6]+sum[7]));
+	for(; k<n; k++)
+		total += (double)px[k] * (double)py[k];
+	return total;
+}
+
+// squared distance
+SVM_TARGET_CLONES
+static double dense_distance(const float *px, const float *py, int n)
+{
+	double sum[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	int k = 0;
+	for(; k+8<=n; k+=8)
+		for(int j=0;j<8;j++)
+		{
+			double d = (double)px[k+j] - (double)py[k+j];
+			sum[j] += d*d;
+		}
+	double total = ((sum[0]+sum[1])+(sum[2]+sum[3]))+((sum[4]+sum[5])+(sum[6]+sum[7]));
+	for(; k<n; k++)
+	{
+		double d = (double)px[k] - (double)py[k];
+		total += d*d;
+	}
+	return total;
+}
+
+static double dense_sparse_dot(const svm_dense_node *px, const svm_node *py)
+{
+	double sum = 0;
+	for(; py->index != -1; ++py)
+		if(py->index >= 0 && py->index < px->dim)
+			sum += px->values[py->index] * py->value;
+	return sum;
+}
+
 static void print_string_stdout(const char *s)
 {
 	fputs(s,stdout);
@@ -67,7 +162,7 @@ static void info(const char *fmt,...) {}
 class Cache
 {
 public:
-	Cache(int l,long int size);
+	Cache(int l,double size);	// size in bytes
 	~Cache();
 
 	// request data [0,len)
@@ -75,35 +170,151 @@ public:
 	// (p >= len if nothing needs to be filled)
 	int get_data(const int index, Qfloat **data, int len);
 	void swap_index(int i, int j);	
+	// the columns will be requested with this length (while no data
+	// returned before is in use)
+	void set_column_length(int len);
 private:
 	int l;
-	long int size;
 	struct head_t
 	{
 		head_t *prev, *next;	// a circular list
 		Qfloat *data;
 		int len;		// data[0,len) is cached in this entry
+		bool hot;		// requested again since it was computed
 	};
 
+	// The slab is allocated once, and divided into nr_slots slots of
+	// stride values.  The stride follows the length of the columns: as
+	// the solver shrinks the active set, the slots are made shorter (and
+	// the columns moved together) so that more of them fit.  Columns
+	// longer than the stride in between (e.g., for updating G_bar) are
+	// kept in two spare full length columns, starting from the part of
+	// them that is in the slab.
+	Qfloat *slab;
+	size_t slab_size;	// in values
+	int full_stride, min_stride;
+	int stride, nr_slots, max_slots;
+	head_t **owner;		// of each slot, NULL if free
+	int *free_slots;	// stack of the free slots
+	int nr_free;
+	Qfloat *spare[2];
+	int spare_index[2];	// column in the spare, -1 if none
+	int spare_len[2];
+	int last_spare;		// returned last of the spares
+
+	// Segmented LRU: columns start in the cold list and move to the hot
+	// list when they are requested again.  Evictions take the least
+	// recently used cold column, so that the sweeps over all columns
+	// (initializing and reconstructing the gradient) cannot flush the
+	// columns that the solver keeps coming back to.
 	head_t *head;
-	head_t lru_head;
+	head_t cold_head, hot_head;
+	int nr_hot, max_hot;
+	head_t *last;		// returned last, the caller may still use it
+	long long hits, misses, evictions;
+
 	void lru_delete(head_t *h);
 	void lru_insert(head_t *h);
+	void set_owner(head_t *h);
+	void release(head_t *h);
+	head_t *victim();
+	void allocate(head_t *h);
+	int get_long(const int index, Qfloat **data, int len);
+	void restride(int new_stride);
 };
 
-Cache::Cache(int l_,long int size_):l(l_),size(size_)
+static svm_cache_stats cache_stats;	// of the caches freed since svm_get_cache_stats
+static std::mutex cache_stats_lock;	// several models may be trained at once
+static std::atomic<int> nr_caches(0);	// alive or about to be built
+
+// physical memory available now, in bytes (0 if unknown)
+static double available_memory()
+{
+	double bytes = 0;
+#if defined(_WIN32) || defined(_WIN64)
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if(GlobalMemoryStatusEx(&status))
+		bytes = (double)status.ullAvailPhys;
+#else
+	// MemAvailable includes the page cache that can be reclaimed
+	FILE *fp = fopen("/proc/meminfo","r");
+	if(fp != NULL)
+	{
+		char line[256];
+		double kb;
+		while(fgets(line,sizeof(line),fp) != NULL)
+			if(sscanf(line,"MemAvailable: %lf kB",&kb) == 1)
+				bytes = kb*1024;
+		fclose(fp);
+	}
+#ifdef _SC_AVPHYS_PAGES
+	if(bytes == 0 && sysconf(_SC_AVPHYS_PAGES) > 0)
+		bytes = (double)sysconf(_SC_AVPHYS_PAGES)*sysconf(_SC_PAGESIZE);
+#endif
+#endif
+	return bytes;
+}
+
+// cache_size in bytes, 0 MB standing for a quarter of the available memory
+// (100 MB if that is unknown), shared with the caches of the other trainings
+// running at the same time. Counts the cache it is sized for among those in
+// the same step, ~Cache gives the slot back.
+static double cache_bytes(const svm_parameter& param)
+{
+	int n = nr_caches++;
+	if(param.cache_size > 0)
+		return param.cache_size*(1<<20);
+	double bytes = available_memory()/4/(n+1);
+	return bytes > 0 ? bytes : 100.0*(1<<20);
+}
+
+Cache::Cache(int l_,double size):l(l_)
 {
 	head = (head_t *)calloc(l,sizeof(head_t));	// initialized to 0
-	size /= sizeof(Qfloat);
-	size -= l * sizeof(head_t) / sizeof(Qfloat);
-	size = max(size, 2 * (long int) l);	// cache must be large enough for two columns
-	lru_head.next = lru_head.prev = &lru_head;
+	size -= l * sizeof(head_t);
+
+	// slots of whole cache lines, at most 64 per full column
+	full_stride = (l + 15) & ~15;
+	min_stride = max(16, (full_stride/64 + 15) & ~15);
+	double column_size = sizeof(Qfloat)*full_stride + (double)(sizeof(head_t *) + sizeof(int))*full_stride/min_stride;
+	double columns = size / column_size - 2;	// and two spares
+	int nr_columns = (int)max(2.0, min(columns, (double)l));	// cache must be large enough for two columns
+	while((slab = Malloc(Qfloat,(size_t)(nr_columns+2)*full_stride)) == NULL && nr_columns > 2)
+		nr_columns = max(2, nr_columns/2);	// e.g., short of address space
+	slab_size = (size_t)nr_columns*full_stride;
+	spare[0] = slab + slab_size;
+	spare[1] = spare[0] + full_stride;
+	spare_index[0] = spare_index[1] = -1;
+	spare_len[0] = spare_len[1] = 0;
+	last_spare = -1;
+	max_slots = (int)min(slab_size/min_stride, (size_t)l);
+	owner = Malloc(head_t *,max_slots);
+	free_slots = Malloc(int,max_slots);
+	for(int s=0;s<max_slots;s++)
+		owner[s] = NULL;
+	cold_head.next = cold_head.prev = &cold_head;
+	hot_head.next = hot_head.prev = &hot_head;
+	nr_hot = 0;
+	last = NULL;
+	hits = misses = evictions = 0;
+	stride = full_stride;
+	nr_slots = 0;
+	restride(full_stride);	// all slots free
 }
 
 Cache::~Cache()
 {
-	for(head_t *h = lru_head.next; h != &lru_head; h=h->next)
-		free(h->data);
+	nr_caches--;
+	std::lock_guard<std::mutex> guard(cache_stats_lock);
+	cache_stats.hits += hits;
+	cache_stats.misses += misses;
+	cache_stats.evictions += evictions;
+	cache_stats.columns = max(cache_stats.columns, (int)(slab_size/full_stride));
+	cache_stats.size = max(cache_stats.size, (double)sizeof(Qfloat)*(slab_size+2*full_stride)/(1<<20));
+	free(free_slots);
+	free(owner);
+	free(slab);
 	free(head);
 }
 
@@ -112,43 +323,187 @@ void Cache::lru_delete(head_t *h)
 	// delete from current location
 	h->prev->next = h->next;
 	h->next->prev = h->prev;
+	if(h->hot) nr_hot--;
 }
 
 void Cache::lru_insert(head_t *h)
 {
-	// insert to last position
-	h->next = &lru_head;
-	h->prev = lru_head.prev;
+	// insert to last position of its list, making room in the hot list
+	// by moving its least recently used columns to the cold list
+	head_t *list = &cold_head;
+	if(h->hot)
+	{
+		while(nr_hot >= max_hot)
+		{
+			head_t *old = hot_head.next;
+			lru_delete(old);
+			old->hot = false;
+			lru_insert(old);
+		}
+		list = &hot_head;
+		nr_hot++;
+	}
+	h->next = list;
+	h->prev = list->prev;
 	h->prev->next = h;
 	h->next->prev = h;
 }
 
+void Cache::set_owner(head_t *h)
+{
+	if(h->data != 0)
+		owner[(h->data - slab)/stride] = h;
+}
+
+void Cache::release(head_t *h)
+{
+	lru_delete(h);
+	int s = (int)((h->data - slab)/stride);
+	owner[s] = NULL;
+	free_slots[nr_free++] = s;
+	h->data = 0;
+	h->len = 0;
+	h->hot = false;
+}
+
+Cache::head_t *Cache::victim()
+{
+	// the least recently used column, cold first, but never the column
+	// returned last (there are at least two slots)
+	for(head_t *list = &cold_head; ; list = &hot_head)
+		for(head_t *h = list->next; h != list; h = h->next)
+			if(h != last)
+				return h;
+}
+
+// a slot for h (which has none)
+void Cache::allocate(head_t *h)
+{
+	if(nr_free == 0)
+	{
+		release(victim());
+		evictions++;
+	}
+	int s = free_slots[--nr_free];
+	owner[s] = h;
+	h->data = slab + (size_t)s*stride;
+}
+
+// moves the columns in the slab to slots of new_stride, truncating them or
+// evicting the least recently used ones as needed
+void Cache::restride(int new_stride)
+{
+	int new_nr_slots = (int)min(slab_size/new_stride, (size_t)max_slots);
+	int nr_used = 0;
+	for(int s=0;s<nr_slots;s++)
+		if(owner[s] != NULL)
+			nr_used++;
+	for(;nr_used > new_nr_slots;nr_used--)
+	{
+		release(victim());
+		evictions++;
+	}
+
+	// to the front in order, which never overwrites a column not yet
+	// moved, then (if the slots get longer) spread out in reverse order
+	int k = 0;
+	int shorter = min(stride,new_stride);
+	for(int s=0;s<nr_slots;s++)
+	{
+		head_t *h = owner[s];
+		if(h == NULL)
+			continue;
+		h->len = min(h->len,shorter);
+		Qfloat *data = slab + (size_t)k*shorter;
+		if(data != h->data)
+			memmove(data,h->data,sizeof(Qfloat)*h->len);
+		h->data = data;
+		owner[k++] = h;
+	}
+	if(new_stride > stride)
+		for(int s=k-1;s>0;s--)
+		{
+			head_t *h = owner[s];
+			Qfloat *data = slab + (size_t)s*new_stride;
+			memmove(data,h->data,sizeof(Qfloat)*h->len);
+			h->data = data;
+		}
+
+	stride = new_stride;
+	nr_slots = new_nr_slots;
+	nr_free = 0;
+	for(int s=nr_slots-1;s>=k;s--)
+	{
+		owner[s] = NULL;
+		free_slots[nr_free++] = s;
+	}
+	max_hot = nr_slots - max(1, nr_slots/4);
+}
+
+void Cache::set_column_length(int len)
+{
+	// longer slots as needed, shorter ones if the cache is full and they
+	// hold at least 1/8 more columns
+	int new_stride = min(max((len + 15) & ~15, min_stride), full_stride);
+	last = NULL;
+	last_spare = -1;
+	if(new_stride > stride || (nr_free == 0 && new_stride <= stride - stride/8))
+		restride(new_stride);
+}
+
+// a column longer than the slots, in a spare
+int Cache::get_long(const int index, Qfloat **data, int len)
+{
+	int k = spare_index[0] == index ? 0 : spare_index[1] == index ? 1 : -1;
+	if(k >= 0 && spare_len[k] >= len)
+		hits++;
+	else
+	{
+		misses++;
+		if(k < 0)
+		{
+			// not the one returned last
+			k = last_spare == 0 ? 1 : 0;
+			if(spare_index[k] >= 0)
+				evictions++;
+			head_t *h = &head[index];
+			if(h->len)
+				memcpy(spare[k],h->data,sizeof(Qfloat)*h->len);
+			spare_index[k] = index;
+			spare_len[k] = h->len;
+		}
+		swap(spare_len[k],len);
+	}
+	last_spare = k;
+	*data = spare[k];
+	return len;
+}
+
 int Cache::get_data(const int index, Qfloat **data, int len)
 {
+	if(len > stride)
+		return get_long(index,data,len);
+
 	head_t *h = &head[index];
-	if(h->len) lru_delete(h);
+	if(h->len)
+	{
+		lru_delete(h);
+		h->hot = true;
+	}
 	int more = len - h->len;
 
 	if(more > 0)
 	{
-		// free old space
-		while(size < more)
-		{
-			head_t *old = lru_head.next;
-			lru_delete(old);
-			free(old->data);
-			size += old->len;
-			old->data = 0;
-			old->len = 0;
-		}
-
-		// allocate new space
-		h->data = (Qfloat *)realloc(h->data,sizeof(Qfloat)*len);
-		size -= more;
+		misses++;
+		if(h->data == 0)
+			allocate(h);
 		swap(h->len,len);
 	}
+	else
+		hits++;
 
 	lru_insert(h);
+	last = h;
 	*data = h->data;
 	return len;
 }
@@ -161,27 +516,38 @@ void Cache::swap_index(int i, int j)
 	if(head[j].len) lru_delete(&head[j]);
 	swap(head[i].data,head[j].data);
 	swap(head[i].len,head[j].len);
+	swap(head[i].hot,head[j].hot);
+	set_owner(&head[i]);
+	set_owner(&head[j]);
 	if(head[i].len) lru_insert(&head[i]);
 	if(head[j].len) lru_insert(&head[j]);
+	last = NULL;
 
 	if(i>j) swap(i,j);
-	for(head_t *h = lru_head.next; h!=&lru_head; h=h->next)
+	for(int k=0;k<2;k++)
 	{
-		if(h->len > i)
+		if(spare_index[k] == i) spare_index[k] = j;
+		else if(spare_index[k] == j) spare_index[k] = i;
+		if(spare_len[k] > j)
+			swap(spare[k][i],spare[k][j]);
+		else if(spare_len[k] > i)
+			spare_len[k] = i;
+	}
+	head_t *lists[2] = { &cold_head, &hot_head };
+	for(int k=0;k<2;k++)
+		for(head_t *h = lists[k]->next, *next; h!=lists[k]; h=next)
 		{
-			if(h->len > j)
-				swap(h->data[i],h->data[j]);
-			else
+			next = h->next;
+			if(h->len > i)
 			{
-				// give up
-				lru_delete(h);
-				free(h->data);
-				size += h->len;
-				h->data = 0;
-				h->len = 0;
+				if(h->len > j)
+					swap(h->data[i],h->data[j]);
+				else if(i > 0)
+					h->len = i;	// keep the part before i
+				else
+					release(h);
 			}
 		}
-	}
 }
 
 //
@@ -196,6 +562,12 @@ public:
 	virtual Qfloat *get_Q(int column, int len) const = 0;
 	virtual double *get_QD() const = 0;
 	virtual void swap_index(int i, int j) const = 0;
+	// the columns will be requested with length len (from now until the
+	// next call, while no column returned before is in use)
+	virtual void set_column_length(int /*len*/) const {}
+	// out[i] = sum_j Q(i,j)*coef[j] for all i, where that can be done
+	// without the columns of Q (returns false otherwise)
+	virtual bool combine(const double * /*coef*/, double * /*out*/) const { return false; }
 	virtual ~QMatrix() {}
 };
 
@@ -217,7 +589,17 @@ protected:
 
 	double (Kernel::*kernel_function)(int i, int j) const;
 
+	// calls fill(begin, end) on subranges covering [start, len), in
+	// parallel if a parallel function is set
+	template <class F> static void fill_range(int start, int len, const F& fill);
+
+	// out[i] = y[i]*sum_j y[j]*coef[j]*K(i,j) (y = NULL for all 1), through
+	// the weight vector sum_j y[j]*coef[j]*x[j] of the linear kernel on
+	// dense vectors (false for the other kernels)
+	bool linear_combination(const schar *y, const double *coef, double *out) const;
+
 private:
+	int l;
 	const svm_node **x;
 	double *x_square;
 
@@ -248,10 +630,21 @@ private:
 	{
 		return x[i][(int)(x[j][0].value)].value;
 	}
+	double kernel_precomputed_dense(int i, int j) const
+	{
+		const svm_dense_node *di = (const svm_dense_node *)x[i];
+		const svm_dense_node *dj = (const svm_dense_node *)x[j];
+		return di->values[(int)dj->values[0]];
+	}
 };
 
+template <class F> void Kernel::fill_range(int start, int len, const F& fill)
+{
+	parallel_range(start,len,64,fill);	// (64 kernel evaluations outweigh handing them out)
+}
+
 Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
-:kernel_type(param.kernel_type), degree(param.degree),
+:l(l), kernel_type(param.kernel_type), degree(param.degree),
  gamma(param.gamma), coef0(param.coef0)
 {
 	switch(kernel_type)
@@ -269,7 +662,10 @@ Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
 			kernel_function = &Kernel::kernel_sigmoid;
 			break;
 		case PRECOMPUTED:
-			kernel_function = &Kernel::kernel_precomputed;
+			if(l > 0 && dense(x_[0]))
+				kernel_function = &Kernel::kernel_precomputed_dense;
+			else
+				kernel_function = &Kernel::kernel_precomputed;
 			break;
 	}
 
@@ -291,8 +687,57 @@ Kernel::~Kernel()
 	delete[] x_square;
 }
 
+bool Kernel::linear_combination(const schar *y, const double *coef, double *out) const
+{
+	if(kernel_type != LINEAR)
+		return false;
+	int dim = 0;
+	for(int i=0;i<l;i++)
+	{
+		const svm_dense_node *d = dense(x[i]);
+		if(d == NULL)
+			return false;
+		dim = max(dim,d->dim);
+	}
+
+	double *w = new double[dim];
+	for(int k=0;k<dim;k++)
+		w[k] = 0;
+	for(int j=0;j<l;j++)
+		if(coef[j] != 0)
+		{
+			const svm_dense_node *d = dense(x[j]);
+			double c = y ? y[j]*coef[j] : coef[j];
+			for(int k=0;k<d->dim;k++)
+				w[k] += c*d->values[k];
+		}
+	float *w_float = new float[dim];
+	for(int k=0;k<dim;k++)
+		w_float[k] = (float)w[k];
+
+	fill_range(0,l,[&](int begin, int end) {
+		for(int i=begin;i<end;i++)
+		{
+			const svm_dense_node *d = dense(x[i]);
+			double sum = dense_dot(w_float,d->values,d->dim);
+			out[i] = y ? y[i]*sum : sum;
+		}
+	});
+	delete[] w;
+	delete[] w_float;
+	return true;
+}
+
 double Kernel::dot(const svm_node *px, const svm_node *py)
 {
+	const svm_dense_node *dx = dense(px), *dy = dense(py);
+	if(dx && dy)
+		return dense_dot(dx->values,dy->values,min(dx->dim,dy->dim));
+	if(dx)
+		return dense_sparse_dot(dx,py);
+	if(dy)
+		return dense_sparse_dot(dy,px);
+
 	double sum = 0;
 	while(px->index != -1 && py->index != -1)
 	{
@@ -324,6 +769,19 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 			return powi(param.gamma*dot(x,y)+param.coef0,param.degree);
 		case RBF:
 		{
+			const svm_dense_node *dx = dense(x), *dy = dense(y);
+			if(dx && dy)
+			{
+				// the longer vector is padded with zeros
+				if(dx->dim > dy->dim)
+					swap(dx,dy);
+				double sum = dense_distance(dx->values,dy->values,dx->dim) +
+					dense_dot(dy->values+dx->dim,dy->values+dx->dim,dy->dim-dx->dim);
+				return exp(-param.gamma*sum);
+			}
+			if(dx || dy)
+				return exp(-param.gamma*(dot(x,x)+dot(y,y)-2*dot(x,y)));
+
 			double sum = 0;
 			while(x->index != -1 && y->index !=-1)
 			{
@@ -366,7 +824,11 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 		case SIGMOID:
 			return tanh(param.gamma*dot(x,y)+param.coef0);
 		case PRECOMPUTED:  //x: test (validation), y: SV
-			return x[(int)(y->value)].value;
+		{
+			const svm_dense_node *dx = dense(x), *dy = dense(y);
+			int serial = dy ? (int)dy->values[0] : (int)(y->value);
+			return dx ? dx->values[serial] : x[serial].value;
+		}
 		default:
 			return 0;  // Unreachable 
 	}
@@ -423,6 +885,25 @@ protected:
 	int l;
 	bool unshrink;	// XXX
 
+	// the loops over the active set run in blocks of block_size (held in
+	// the cache while they are worked on), and in parallel in chunks of at
+	// least parallel_grain variables (see parallel_range)
+	enum { block_size = 256, parallel_grain = 4096 };
+
+	// maximal violators max { -y_t*grad(f)_t | t in I_up(\alpha) } for
+	// y_t = +1 (p) and -1 (n); ties go to the last index, idx = -1 if none
+	struct Violators {
+		double Gmaxp, Gmaxn;
+		int Gmaxp_idx, Gmaxn_idx;
+		void init() { Gmaxp = Gmaxn = -INF; Gmaxp_idx = Gmaxn_idx = -1; }
+		void merge(const Violators& v);
+	};
+	Violators violators;	// of the current gradient, found while updating it
+	bool violators_valid;	// false once the active set changed
+	void get_violators(Violators& v);
+	void scan_violators(int begin, int end, Violators& v) const;
+	void update_gradient(const Qfloat *Q_i, const Qfloat *Q_j, double delta_alpha_i, double delta_alpha_j);
+
 	double get_C(int i)
 	{
 		return (y[i] > 0)? Cp : Cn;
@@ -468,8 +949,10 @@ void Solver::reconstruct_gradient()
 	int i,j;
 	int nr_free = 0;
 
-	for(j=active_size;j<l;j++)
-		G[j] = G_bar[j] + p[j];
+	parallel_range(active_size,l,parallel_grain,[&](int begin, int end) {
+		for(int k=begin;k<end;k++)
+			G[k] = G_bar[k] + p[k];
+	});
 
 	for(j=0;j<active_size;j++)
 		if(is_free(j))
@@ -480,13 +963,34 @@ void Solver::reconstruct_gradient()
 
 	if (nr_free*l > 2*active_size*(l-active_size))
 	{
+		// alpha of the free variables, 0 for the others, summed up in
+		// blocks so that the sums do not depend on the threads
+		double *alpha_free = new double[active_size];
+		for(j=0;j<active_size;j++)
+			alpha_free[j] = is_free(j) ? alpha[j] : 0;
+		int nr_blocks = (active_size+parallel_grain-1)/parallel_grain;
+		double *sums = new double[nr_blocks];
 		for(i=active_size;i<l;i++)
 		{
 			const Qfloat *Q_i = Q->get_Q(i,active_size);
-			for(j=0;j<active_size;j++)
-				if(is_free(j))
-					G[i] += alpha[j] * Q_i[j];
+			parallel_range(0,nr_blocks,1,[&](int begin, int end) {
+				for(int b=begin;b<end;b++)
+				{
+					int k = b*parallel_grain, k_end = min(k+parallel_grain,active_size);
+					double sum[4] = {0,0,0,0};
+					for(;k+4<=k_end;k+=4)
+						for(int m=0;m<4;m++)
+							sum[m] += alpha_free[k+m] * Q_i[k+m];
+					for(;k<k_end;k++)
+						sum[0] += alpha_free[k] * Q_i[k];
+					sums[b] = (sum[0]+sum[1]) + (sum[2]+sum[3]);
+				}
+			});
+			for(int b=0;b<nr_blocks;b++)
+				G[i] += sums[b];
 		}
+		delete[] sums;
+		delete[] alpha_free;
 	}
 	else
 	{
@@ -495,12 +999,128 @@ void Solver::reconstruct_gradient()
 			{
 				const Qfloat *Q_i = Q->get_Q(i,l);
 				double alpha_i = alpha[i];
-				for(j=active_size;j<l;j++)
-					G[j] += alpha_i * Q_i[j];
+				parallel_range(active_size,l,parallel_grain,[&](int begin, int end) {
+					for(int k=begin;k<end;k++)
+						G[k] += alpha_i * Q_i[k];
+				});
 			}
 	}
 }
 
+void Solver::Violators::merge(const Violators& v)
+{
+	if(v.Gmaxp > Gmaxp || (v.Gmaxp == Gmaxp && v.Gmaxp_idx > Gmaxp_idx))
+	{
+		Gmaxp = v.Gmaxp;
+		Gmaxp_idx = v.Gmaxp_idx;
+	}
+	if(v.Gmaxn > Gmaxn || (v.Gmaxn == Gmaxn && v.Gmaxn_idx > Gmaxn_idx))
+	{
+		Gmaxn = v.Gmaxn;
+		Gmaxn_idx = v.Gmaxn_idx;
+	}
+}
+
+// returns the block maximum of v[0..n), and in last the last index holding
+// it if it is at least bound (-1 otherwise)
+static inline double block_max(const double *v, int n, double bound, int& last)
+{
+	double m[4] = {-INF,-INF,-INF,-INF};
+	int k;
+	for(k=0;k+4<=n;k+=4)
+		for(int r=0;r<4;r++)
+			m[r] = v[k+r] > m[r] ? v[k+r] : m[r];
+	for(;k<n;k++)
+		m[0] = v[k] > m[0] ? v[k] : m[0];
+	double vmax = max(max(m[0],m[1]),max(m[2],m[3]));
+	last = -1;
+	if(vmax >= bound && vmax > -INF)
+		for(k=n-1;last<0;k--)
+			if(v[k] == vmax)
+				last = k;
+	return vmax;
+}
+
+// the maximal violators among the active variables [begin, end), merged into v
+void Solver::scan_violators(int begin, int end, Violators& v) const
+{
+	double vp[block_size], vn[block_size];
+	for(int b=begin;b<end;b+=block_size)
+	{
+		int n = min((int)block_size,end-b);
+		const double *G_b = G+b;
+		const schar *y_b = y+b;
+		const char *status_b = alpha_status+b;
+		for(int k=0;k<n;k++)
+		{
+			// -y_t*G_t in I_up, -INF otherwise (written to vectorize:
+			// unconditional loads, & rather than &&)
+			double g = G_b[k];
+			int status = status_b[k];
+			int pos = y_b[k] > 0;
+			int up_p = pos & (status != UPPER_BOUND);
+			int up_n = (1-pos) & (status != LOWER_BOUND);
+			vp[k] = up_p ? -g : -INF;
+			vn[k] = up_n ? g : -INF;
+		}
+		int last;
+		double vmax = block_max(vp,n,v.Gmaxp,last);
+		if(last >= 0)
+		{
+			v.Gmaxp = vmax;
+			v.Gmaxp_idx = b+last;
+		}
+		vmax = block_max(vn,n,v.Gmaxn,last);
+		if(last >= 0)
+		{
+			v.Gmaxn = vmax;
+			v.Gmaxn_idx = b+last;
+		}
+	}
+}
+
+void Solver::get_violators(Violators& v)
+{
+	if(violators_valid)
+		v = violators;
+	else
+	{
+		std::mutex lock;
+		v.init();
+		parallel_range(0,active_size,parallel_grain,[&](int begin, int end) {
+			Violators chunk;
+			chunk.init();
+			scan_violators(begin,end,chunk);
+			std::lock_guard<std::mutex> guard(lock);
+			v.merge(chunk);
+		});
+	}
+	violators_valid = false;	// used up by the selection
+}
+
+// G_k += Q_ik*delta_alpha_i + Q_jk*delta_alpha_j over the active set, and the
+// maximal violators of the new gradient while its blocks are in the cache
+// (so that the next selection does not make another pass over G)
+void Solver::update_gradient(const Qfloat *Q_i, const Qfloat *Q_j, double delta_alpha_i, double delta_alpha_j)
+{
+	std::mutex lock;
+	violators.init();
+	parallel_range(0,active_size,parallel_grain,[&](int begin, int end) {
+		Violators chunk;
+		chunk.init();
+		for(int b=begin;b<end;b+=block_size)
+		{
+			int b_end = min(b+(int)block_size,end);
+			for(int k=b;k<b_end;k++)
+				G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
+			scan_violators(b,b_end,chunk);
+		}
+		std::lock_guard<std::mutex> guard(lock);
+		violators.merge(chunk);
+	});
+	violators_valid = true;
+}
+
 void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		   double *alpha_, double Cp, double Cn, double eps,
 		   SolutionInfo* si, int shrinking)
@@ -541,18 +1161,51 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 			G[i] = p[i];
 			G_bar[i] = 0;
 		}
+
+		// G from sum_j Q(i,j)*alpha[j] and G_bar from sum_j Q(i,j)*C_j
+		// (for the alphas at their upper bound) if Q can do that at once,
+		// which saves computing the columns of all support vectors (e.g.,
+		// when warm started)
+		int nr_nonzero = 0, nr_upper = 0;
 		for(i=0;i<l;i++)
+		{
+			if(!is_lower_bound(i)) nr_nonzero++;
+			if(is_upper_bound(i)) nr_upper++;
+		}
+		bool combined = false;
+		if(nr_nonzero > 0)
+		{
+			double *coef = new double[l];
+			double *sum = new double[l];
+			for(i=0;i<l;i++)
+				coef[i] = is_lower_bound(i) ? 0 : alpha[i];
+			if(Q.combine(coef,sum))
+			{
+				for(i=0;i<l;i++)
+				{
+					G[i] += sum[i];
+					coef[i] = is_upper_bound(i) ? get_C(i) : 0;
+				}
+				combined = nr_upper == 0 || Q.combine(coef,G_bar);
+			}
+			delete[] coef;
+			delete[] sum;
+		}
+		for(i=0;i<l && !combined;i++)
 			if(!is_lower_bound(i))
 			{
 				const Qfloat *Q_i = Q.get_Q(i,l);
 				double alpha_i = alpha[i];
-				int j;
-				for(j=0;j<l;j++)
-					G[j] += alpha_i*Q_i[j];
-				if(is_upper_bound(i))
-					for(j=0;j<l;j++)
-						G_bar[j] += get_C(i) * Q_i[j];
+				double C_i = is_upper_bound(i) ? get_C(i) : 0;
+				parallel_range(0,l,parallel_grain,[&](int begin, int end) {
+					for(int j=begin;j<end;j++)
+						G[j] += alpha_i*Q_i[j];
+					if(C_i != 0)
+						for(int j=begin;j<end;j++)
+							G_bar[j] += C_i * Q_i[j];
+				});
 			}
+		violators_valid = false;
 	}
 
 	// optimization step
@@ -568,7 +1221,12 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		if(--counter == 0)
 		{
 			counter = min(l,1000);
-			if(shrinking) do_shrinking();
+			if(shrinking)
+			{
+				do_shrinking();
+				Q.set_column_length(active_size);
+			}
+			violators_valid = false;
 			info(".");
 		}
 
@@ -579,6 +1237,8 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 			reconstruct_gradient();
 			// reset active set size and check
 			active_size = l;
+			Q.set_column_length(l);
+			violators_valid = false;
 			info("*");
 			if(select_working_set(i,j)!=0)
 				break;
@@ -686,45 +1346,37 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 			}
 		}
 
-		// update G
+		// update alpha_status, then G (which needs the new status to find
+		// the violators for the next selection) and G_bar
 
 		double delta_alpha_i = alpha[i] - old_alpha_i;
 		double delta_alpha_j = alpha[j] - old_alpha_j;
-		
-		for(int k=0;k<active_size;k++)
-		{
-			G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
-		}
 
-		// update alpha_status and G_bar
+		bool ui = is_upper_bound(i);
+		bool uj = is_upper_bound(j);
+		update_alpha_status(i);
+		update_alpha_status(j);
+
+		update_gradient(Q_i,Q_j,delta_alpha_i,delta_alpha_j);
 
+		if(ui != is_upper_bound(i))
 		{
-			bool ui = is_upper_bound(i);
-			bool uj = is_upper_bound(j);
-			update_alpha_status(i);
-			update_alpha_status(j);
-			int k;
-			if(ui != is_upper_bound(i))
-			{
-				Q_i = Q.get_Q(i,l);
-				if(ui)
-					for(k=0;k<l;k++)
-						G_bar[k] -= C_i * Q_i[k];
-				else
-					for(k=0;k<l;k++)
-						G_bar[k] += C_i * Q_i[k];
-			}
+			Q_i = Q.get_Q(i,l);
+			double C = ui ? -C_i : C_i;
+			parallel_range(0,l,parallel_grain,[&](int begin, int end) {
+				for(int k=begin;k<end;k++)
+					G_bar[k] += C * Q_i[k];
+			});
+		}
 
-			if(uj != is_upper_bound(j))
-			{
-				Q_j = Q.get_Q(j,l);
-				if(uj)
-					for(k=0;k<l;k++)
-						G_bar[k] -= C_j * Q_j[k];
-				else
-					for(k=0;k<l;k++)
-						G_bar[k] += C_j * Q_j[k];
-			}
+		if(uj != is_upper_bound(j))
+		{
+			Q_j = Q.get_Q(j,l);
+			double C = uj ? -C_j : C_j;
+			parallel_range(0,l,parallel_grain,[&](int begin, int end) {
+				for(int k=begin;k<end;k++)
+					G_bar[k] += C * Q_j[k];
+			});
 		}
 	}
 
@@ -791,88 +1443,80 @@ int Solver::select_working_set(int &out_i, int &out_j)
 	//    (if quadratic coefficeint <= 0, replace it with tau)
 	//    -y_j*grad(f)_j < -y_i*grad(f)_i, j in I_low(\alpha)
 	
-	double Gmax = -INF;
+	Violators up;
+	get_violators(up);
+	bool from_n = up.Gmaxn > up.Gmaxp || (up.Gmaxn == up.Gmaxp && up.Gmaxn_idx > up.Gmaxp_idx);
+	double Gmax = from_n ? up.Gmaxn : up.Gmaxp;
+	int Gmax_idx = from_n ? up.Gmaxn_idx : up.Gmaxp_idx;
 	double Gmax2 = -INF;
-	int Gmax_idx = -1;
 	int Gmin_idx = -1;
 	double obj_diff_min = INF;
 
-	for(int t=0;t<active_size;t++)
-		if(y[t]==+1)	
-		{
-			if(!is_upper_bound(t))
-				if(-G[t] >= Gmax)
-				{
-					Gmax = -G[t];
-					Gmax_idx = t;
-				}
-		}
-		else
-		{
-			if(!is_lower_bound(t))
-				if(G[t] >= Gmax)
-				{
-					Gmax = G[t];
-					Gmax_idx = t;
-				}
-		}
-
 	int i = Gmax_idx;
 	const Qfloat *Q_i = NULL;
 	if(i != -1) // NULL Q_i not accessed: Gmax=-INF if i=-1
 		Q_i = Q->get_Q(i,active_size);
 
-	for(int j=0;j<active_size;j++)
-	{
-		if(y[j]==+1)
-		{
-			if (!is_lower_bound(j))
+	double two_y_i = (i != -1) ? 2.0*y[i] : 0;
+	std::mutex lock;
+	parallel_range(0,active_size,parallel_grain,[&](int begin, int end) {
+		double chunk_Gmax2 = -INF;
+		int chunk_Gmin_idx = -1;
+		double chunk_obj_diff_min = INF;
+		double g2[block_size], obj[block_size];
+		for(int b=begin;b<end;b+=block_size)
+		{
+			int n = min((int)block_size,end-b);
+			for(int k=0;k<n;k++)
 			{
-				double grad_diff=Gmax+G[j];
-				if (G[j] >= Gmax2)
-					Gmax2 = G[j];
-				if (grad_diff > 0)
-				{
-					double obj_diff; 
-					double quad_coef = QD[i]+QD[j]-2.0*y[i]*Q_i[j];
-					if (quad_coef > 0)
-						obj_diff = -(grad_diff*grad_diff)/quad_coef;
-					else
-						obj_diff = -(grad_diff*grad_diff)/TAU;
-
-					if (obj_diff <= obj_diff_min)
-					{
-						Gmin_idx=j;
-						obj_diff_min = obj_diff;
-					}
-				}
+				// y_j*grad(f)_j for j in I_low, -INF otherwise
+				int j = b+k;
+				double g = G[j];
+				int status = alpha_status[j];
+				int pos = y[j] > 0;
+				int low = (pos & (status != LOWER_BOUND)) | ((1-pos) & (status != UPPER_BOUND));
+				double yG = pos ? g : -g;
+				g2[k] = low ? yG : -INF;
 			}
-		}
-		else
-		{
-			if (!is_upper_bound(j))
+			// the decrease of the objective is -obj[k], obj[k] = -INF if
+			// grad_diff <= 0 (masked afterwards: computing the candidates
+			// only would put the arithmetic under a branch, which does not
+			// vectorize)
+			if(Q_i != NULL)
 			{
-				double grad_diff= Gmax-G[j];
-				if (-G[j] >= Gmax2)
-					Gmax2 = -G[j];
-				if (grad_diff > 0)
+				for(int k=0;k<n;k++)
 				{
-					double obj_diff; 
-					double quad_coef = QD[i]+QD[j]+2.0*y[i]*Q_i[j];
-					if (quad_coef > 0)
-						obj_diff = -(grad_diff*grad_diff)/quad_coef;
-					else
-						obj_diff = -(grad_diff*grad_diff)/TAU;
-
-					if (obj_diff <= obj_diff_min)
-					{
-						Gmin_idx=j;
-						obj_diff_min = obj_diff;
-					}
+					int j = b+k;
+					double grad_diff = Gmax + g2[k];
+					double quad_coef = QD[i]+QD[j]-(two_y_i*y[j])*Q_i[j];
+					if (quad_coef <= 0)
+						quad_coef = TAU;
+					obj[k] = (grad_diff*grad_diff)/quad_coef;
 				}
+				for(int k=0;k<n;k++)
+					obj[k] = Gmax + g2[k] > 0 ? obj[k] : -INF;
+			}
+			else
+				for(int k=0;k<n;k++)
+					obj[k] = -INF;
+			int last;
+			double vmax = block_max(g2,n,-INF,last);
+			chunk_Gmax2 = max(chunk_Gmax2,vmax);
+			vmax = block_max(obj,n,-chunk_obj_diff_min,last);
+			if(last >= 0)
+			{
+				chunk_obj_diff_min = -vmax;
+				chunk_Gmin_idx = b+last;
 			}
 		}
-	}
+		std::lock_guard<std::mutex> guard(lock);
+		Gmax2 = max(Gmax2,chunk_Gmax2);
+		if(chunk_obj_diff_min < obj_diff_min || (chunk_obj_diff_min == obj_diff_min && chunk_Gmin_idx > Gmin_idx))
+		{
+			obj_diff_min = chunk_obj_diff_min;
+			Gmin_idx = chunk_Gmin_idx;
+		}
+	});
 
 	if(Gmax+Gmax2 < eps)
 		return 1;
@@ -1034,37 +1678,20 @@ int Solver_NU::select_working_set(int &out_i, int &out_j)
 	//    (if quadratic coefficeint <= 0, replace it with tau)
 	//    -y_j*grad(f)_j < -y_i*grad(f)_i, j in I_low(\alpha)
 
-	double Gmaxp = -INF;
+	Violators up;
+	get_violators(up);
+
+	double Gmaxp = up.Gmaxp;
 	double Gmaxp2 = -INF;
-	int Gmaxp_idx = -1;
+	int Gmaxp_idx = up.Gmaxp_idx;
 
-	double Gmaxn = -INF;
+	double Gmaxn = up.Gmaxn;
 	double Gmaxn2 = -INF;
-	int Gmaxn_idx = -1;
+	int Gmaxn_idx = up.Gmaxn_idx;
 
 	int Gmin_idx = -1;
 	double obj_diff_min = INF;
 
-	for(int t=0;t<active_size;t++)
-		if(y[t]==+1)
-		{
-			if(!is_upper_bound(t))
-				if(-G[t] >= Gmaxp)
-				{
-					Gmaxp = -G[t];
-					Gmaxp_idx = t;
-				}
-		}
-		else
-		{
-			if(!is_lower_bound(t))
-				if(G[t] >= Gmaxn)
-				{
-					Gmaxn = G[t];
-					Gmaxn_idx = t;
-				}
-		}
-
 	int ip = Gmaxp_idx;
 	int in = Gmaxn_idx;
 	const Qfloat *Q_ip = NULL;
@@ -1270,7 +1897,7 @@ public:
 	:Kernel(prob.l, prob.x, param)
 	{
 		clone(y,y_,prob.l);
-		cache = new Cache(prob.l,(long int)(param.cache_size*(1<<20)));
+		cache = new Cache(prob.l,cache_bytes(param));
 		QD = new double[prob.l];
 		for(int i=0;i<prob.l;i++)
 			QD[i] = (this->*kernel_function)(i,i);
@@ -1279,11 +1906,13 @@ public:
 	Qfloat *get_Q(int i, int len) const
 	{
 		Qfloat *data;
-		int start, j;
+		int start;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
+			fill_range(start,len,[&](int begin, int end) {
+				for(int j=begin;j<end;j++)
+					data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
+			});
 		}
 		return data;
 	}
@@ -1301,6 +1930,16 @@ public:
 		swap(QD[i],QD[j]);
 	}
 
+	void set_column_length(int len) const
+	{
+		cache->set_column_length(len);
+	}
+
+	bool combine(const double *coef, double *out) const
+	{
+		return linear_combination(y,coef,out);
+	}
+
 	~SVC_Q()
 	{
 		delete[] y;
@@ -1319,7 +1958,7 @@ public:
 	ONE_CLASS_Q(const svm_problem& prob, const svm_parameter& param)
 	:Kernel(prob.l, prob.x, param)
 	{
-		cache = new Cache(prob.l,(long int)(param.cache_size*(1<<20)));
+		cache = new Cache(prob.l,cache_bytes(param));
 		QD = new double[prob.l];
 		for(int i=0;i<prob.l;i++)
 			QD[i] = (this->*kernel_function)(i,i);
@@ -1328,11 +1967,13 @@ public:
 	Qfloat *get_Q(int i, int len) const
 	{
 		Qfloat *data;
-		int start, j;
+		int start;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(this->*kernel_function)(i,j);
+			fill_range(start,len,[&](int begin, int end) {
+				for(int j=begin;j<end;j++)
+					data[j] = (Qfloat)(this->*kernel_function)(i,j);
+			});
 		}
 		return data;
 	}
@@ -1349,6 +1990,16 @@ public:
 		swap(QD[i],QD[j]);
 	}
 
+	void set_column_length(int len) const
+	{
+		cache->set_column_length(len);
+	}
+
+	bool combine(const double *coef, double *out) const
+	{
+		return linear_combination(NULL,coef,out);
+	}
+
 	~ONE_CLASS_Q()
 	{
 		delete cache;
@@ -1366,7 +2017,7 @@ public:
 	:Kernel(prob.l, prob.x, param)
 	{
 		l = prob.l;
-		cache = new Cache(l,(long int)(param.cache_size*(1<<20)));
+		cache = new Cache(l,cache_bytes(param));
 		QD = new double[2*l];
 		sign = new schar[2*l];
 		index = new int[2*l];
@@ -1397,8 +2048,10 @@ public:
 		int j, real_i = index[i];
 		if(cache->get_data(real_i,&data,l) < l)
 		{
-			for(j=0;j<l;j++)
-				data[j] = (Qfloat)(this->*kernel_function)(real_i,j);
+			fill_range(0,l,[&](int begin, int end) {
+				for(int k=begin;k<end;k++)
+					data[k] = (Qfloat)(this->*kernel_function)(real_i,k);
+			});
 		}
 
 		// reorder and copy
@@ -1439,7 +2092,8 @@ private:
 //
 static void solve_c_svc(
 	const svm_problem *prob, const svm_parameter* param,
-	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn)
+	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn,
+	const double *init_alpha)
 {
 	int l = prob->l;
 	double *minus_ones = new double[l];
@@ -1449,7 +2103,7 @@ static void solve_c_svc(
 
 	for(i=0;i<l;i++)
 	{
-		alpha[i] = 0;
+		alpha[i] = init_alpha ? init_alpha[i] : 0;
 		minus_ones[i] = -1;
 		if(prob->y[i] > 0) y[i] = +1; else y[i] = -1;
 	}
@@ -1644,16 +2298,17 @@ struct decision_function
 	double rho;	
 };
 
+// init_alpha: a feasible starting point for C_SVC (NULL for all zeros)
 static decision_function svm_train_one(
 	const svm_problem *prob, const svm_parameter *param,
-	double Cp, double Cn)
+	double Cp, double Cn, const double *init_alpha = NULL)
 {
 	double *alpha = Malloc(double,prob->l);
 	Solver::SolutionInfo si;
 	switch(param->svm_type)
 	{
 		case C_SVC:
-			solve_c_svc(prob,param,alpha,&si,Cp,Cn);
+			solve_c_svc(prob,param,alpha,&si,Cp,Cn,init_alpha);
 			break;
 		case NU_SVC:
 			solve_nu_svc(prob,param,alpha,&si);
@@ -2072,6 +2727,12 @@ static void svm_group_classes(const svm_problem *prob, int *nr_class_ret, int **
 // Interface functions
 //
 svm_model* svm_train(const svm_problem *prob, const svm_parameter *param)
+{
+	return svm_train_warm_start(prob,param,NULL);
+}
+
+svm_model* svm_train_warm_start(const svm_problem *prob, const svm_parameter *param,
+	const svm_model *init)
 {
 	svm_model *model = Malloc( svm_model,1);
 	model->param = *param;
@@ -2157,6 +2818,47 @@ svm_model* svm_train(const svm_problem *prob, const svm_parameter *param)
 				weighted_C[j] *= param->weight[i];
 		}
 
+		// starting point: the solution of init (instance i of its problem
+		// standing for instance i of prob), scaled from its C to param->C,
+		// for two classes only. Instances of init beyond l are left out,
+		// and the larger of the sums of alpha of the two classes is scaled
+		// down to the other one, which keeps the starting point feasible.
+
+		double *init_alpha = NULL;
+		if(init != NULL && init->sv_indices != NULL && param->svm_type == C_SVC &&
+		   init->param.svm_type == C_SVC && nr_class == 2 && init->nr_class == 2 &&
+		   init->label[0] == label[0] && init->label[1] == label[1])
+		{
+			int *position = Malloc(int,l);	// of each instance in x
+			for(i=0;i<l;i++)
+				position[perm[i]] = i;
+			init_alpha = Malloc(double,l);
+			for(i=0;i<l;i++)
+				init_alpha[i] = 0;
+			double scale = param->C / init->param.C;
+			double sum[2] = { 0, 0 };
+			for(i=0;i<init->l;i++)
+			{
+				int index = init->sv_indices[i] - 1;
+				if(index >= l)
+					continue;
+				int k = position[index];
+				int c = k < count[0] ? 0 : 1;
+				init_alpha[k] = min(fabs(init->sv_coef[0][i]) * scale, weighted_C[c]);
+				sum[c] += init_alpha[k];
+			}
+			int larger = sum[0] > sum[1] ? 0 : 1;
+			if(sum[larger] > sum[1-larger])
+			{
+				double ratio = sum[1-larger] / sum[larger];
+				int begin = larger == 0 ? 0 : count[0];
+				int end = larger == 0 ? count[0] : l;
+				for(i=begin;i<end;i++)
+					init_alpha[i] *= ratio;
+			}
+			free(position);
+		}
+
 		// train k*(k-1)/2 models
 		
 		bool *nonzero = Malloc(bool,l);
@@ -2196,7 +2898,7 @@ svm_model* svm_train(const svm_problem *prob, const svm_parameter *param)
 				if(param->probability)
 					svm_binary_svc_probability(&sub_prob,param,weighted_C[i],weighted_C[j],probA[p],probB[p]);
 
-				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j]);
+				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j],init_alpha);
 				for(k=0;k<ci;k++)
 					if(!nonzero[si+k] && fabs(f[p].alpha[k]) > 0)
 						nonzero[si+k] = true;
@@ -2307,6 +3009,7 @@ svm_model* svm_train(const svm_problem *prob, const svm_parameter *param)
 		free(start);
 		free(x);
 		free(weighted_C);
+		free(init_alpha);
 		free(nonzero);
 		for(i=0;i<nr_class*(nr_class-1)/2;i++)
 			free(f[i].alpha);
@@ -2705,7 +3408,13 @@ int svm_save_model_fp(FILE* fp, const svm_model *model)
 		const svm_node *p = SV[i];
 
 		if(param.kernel_type == PRECOMPUTED)
-			fprintf(fp,"0:%d ",(int)(p->value));
+			fprintf(fp,"0:%d ",dense(p) ? (int)dense(p)->values[0] : (int)(p->value));
+		else if(dense(p))
+		{
+			const svm_dense_node *d = dense(p);
+			for(int k=0;k<d->dim;k++)
+				fprintf(fp,"%d:%.8g ",k,d->values[k]);
+		}
 		else
 			while(p->index != -1)
 			{
@@ -3043,10 +3752,20 @@ const char *svm_check_parameter(const svm_problem *prob, const svm_parameter *pa
 	if(param->degree < 0)
 		return "degree of polynomial kernel < 0";
 
+	if(kernel_type == PRECOMPUTED)
+		for(int i=0;i<prob->l;i++)
+		{
+			const svm_dense_node *d = dense(prob->x[i]);
+			if((d != NULL) != (dense(prob->x[0]) != NULL))
+				return "precomputed kernel rows are not all dense or all sparse";
+			if(d != NULL && !(d->dim > 1 && d->values[0] >= 1 && d->values[0] < d->dim))
+				return "dense precomputed kernel row without a valid serial number";
+		}
+
 	// cache_size,eps,C,nu,p,shrinking
 
-	if(param->cache_size <= 0)
-		return "cache_size <= 0";
+	if(param->cache_size < 0)
+		return "cache_size < 0";
 
 	if(param->eps <= 0)
 		return "eps <= 0";
@@ -3144,6 +3863,19 @@ int svm_check_probability_model(const svm_model *model)
 		 model->probA!=NULL);
 }
 
+void svm_set_parallel_function(void (*parallel_for)(int begin, int end, int grain,
+	void (*fn)(int, int, void *), void *arg))
+{
+	svm_parallel_for = parallel_for;
+}
+
+void svm_get_cache_stats(struct svm_cache_stats *stats)
+{
+	std::lock_guard<std::mutex> guard(cache_stats_lock);
+	*stats = cache_stats;
+	memset(&cache_stats,0,sizeof(cache_stats));
+}
+
 void svm_set_print_string_function(void (*print_func)(const char *))
 {
 	if(print_func == NULL)
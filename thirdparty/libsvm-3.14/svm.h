@@ -15,6 +15,21 @@ struct svm_node
 	double value;
 };
 
+/*
+ * A dense vector: a single svm_dense_node, passed (cast to svm_node *)
+ * wherever a vector is expected.  values[k] is the value of index k,
+ * k = 0, ..., dim-1.  The values are not copied; they must stay valid as
+ * long as the problem or a model trained on it is used.
+ */
+#define SVM_DENSE_INDEX (-2)
+
+struct svm_dense_node
+{
+	int index;		/* SVM_DENSE_INDEX */
+	int dim;
+	const float *values;
+};
+
 struct svm_problem
 {
 	int l;
@@ -34,7 +49,7 @@ struct svm_parameter
 	double coef0;	/* for poly/sigmoid */
 
 	/* these are for training only */
-	double cache_size; /* in MB */
+	double cache_size; /* in MB, 0 for a quarter of the available memory */
 	double eps;	/* stopping criteria */
 	double C;	/* for C_SVC, EPSILON_SVR and NU_SVR */
 	int nr_weight;		/* for C_SVC */
@@ -72,6 +87,8 @@ struct svm_model
 };
 
 struct svm_model *svm_train(const struct svm_problem *prob, const struct svm_parameter *param);
+struct svm_model *svm_train_warm_start(const struct svm_problem *prob, const struct svm_parameter *param,
+	const struct svm_model *init);
 void svm_cross_validation(const struct svm_problem *prob, const struct svm_parameter *param, int nr_fold, double *target);
 
 int svm_save_model(const char *model_file_name, const struct svm_model *const model);
@@ -98,6 +115,19 @@ const char *svm_check_parameter(const struct svm_problem *prob, const struct svm
 int svm_check_probability_model(const struct svm_model *model);
 
 void svm_set_print_string_function(void (*print_func)(const char *));
+void svm_set_parallel_function(void (*parallel_for)(int begin, int end, int grain,
+	void (*fn)(int, int, void *), void *arg));
+
+struct svm_cache_stats
+{
+	long long hits;		/* kernel columns found in the cache */
+	long long misses;	/* columns (or parts of them) computed */
+	long long evictions;	/* columns dropped to make room */
+	int columns;		/* full length columns in the largest cache */
+	double size;		/* MB of the largest cache */
+};
+
+void svm_get_cache_stats(struct svm_cache_stats *stats);
 
 #ifdef __cplusplus
 }